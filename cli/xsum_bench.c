@@ -25,8 +25,10 @@
 
 #include "xsum_output.h"  /* XSUM_logLevel */
 #include "xsum_bench.h"
+#include "xsum_arch.h"    /* XSUM_ARCH, XSUM_CC_VERSION */
 #include "xsum_sanity_check.h" /* XSUM_fillTestBuffer */
-#include "xsum_os_specific.h"  /* XSUM_getFileSize */
+#include "xsum_os_specific.h"  /* XSUM_getFileSize, XSUM_openDirect, XSUM_dropFileCache */
+#include "xsum_pool.h"         /* XSUM_pool_create */
 #ifndef XXH_STATIC_LINKING_ONLY
 #  define XXH_STATIC_LINKING_ONLY
 #endif
@@ -38,14 +40,13 @@
 #include <stdlib.h>  /* malloc, free */
 #include <assert.h>
 #include <string.h>  /* strlen, memcpy */
-#include <time.h>   /* clock_t, clock, CLOCKS_PER_SEC */
 #include <errno.h>  /* errno */
 
 #define TIMELOOP_S 1
-#define TIMELOOP  (TIMELOOP_S * CLOCKS_PER_SEC)   /* target timing per iteration */
-#define TIMELOOP_MIN (TIMELOOP / 2)               /* minimum timing to validate a result */
+#define TIMELOOP_NS  (TIMELOOP_S * 1000000000.)   /* target timing per iteration */
+#define TIMELOOP_MIN_NS (TIMELOOP_NS / 2)         /* minimum timing to validate a result */
 
-/* Each benchmark iteration attempts to match TIMELOOP (1 second).
+/* Each benchmark iteration attempts to match TIMELOOP_NS (1 second).
  * The nb of loops is adjusted at each iteration to reach that target.
  * However, initially, there is no information, so 1st iteration blindly targets an arbitrary speed.
  * If it's too small, it will be adjusted, and a new attempt will be made.
@@ -59,9 +60,54 @@
 
 #define MAX_MEM    (2 GB - 64 MB)
 
-static clock_t XSUM_clockSpan( clock_t start )
+/*
+ * Cycle counter, for cycles/byte.
+ * x86's time stamp counter ticks at a constant rate on current CPUs: it counts
+ * reference cycles, which differ from core cycles when the core runs faster
+ * (turbo) or slower than its nominal frequency.
+ * Rounds last about a second, so rdtsc needs no serialization (rdtscp, fences).
+ */
+#if (defined(__GNUC__) || defined(_MSC_VER)) && !defined(__EMSCRIPTEN__) && !defined(_M_ARM64EC) \
+ && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#  if defined(_MSC_VER)
+#    include <intrin.h>      /* __rdtsc */
+#  else
+#    include <x86intrin.h>   /* __rdtsc */
+#  endif
+#  define XSUM_HAS_CYCLES 1
+static XSUM_U64 XSUM_readCycles(void) { return (XSUM_U64)__rdtsc(); }
+#else
+#  define XSUM_HAS_CYCLES 0
+static XSUM_U64 XSUM_readCycles(void) { return 0; }
+#endif
+
+#define XSUM_CYCLES_CALIBRATION_NS 20000000   /* 20 ms */
+
+/* Frequency of the cycle counter in GHz, measured once; 0 without cycle counter */
+static double XSUM_cyclesPerNs(void)
+{
+    static double cyclesPerNs = -1.;
+    if (cyclesPerNs < 0.) {
+        XSUM_U64 const startNs = XSUM_clockNs();
+        XSUM_U64 const startCycles = XSUM_readCycles();
+        XSUM_U64 nbNs;
+        while ((nbNs = XSUM_clockNs() - startNs) < XSUM_CYCLES_CALIBRATION_NS) {}
+        cyclesPerNs = (double)(XSUM_readCycles() - startCycles) / (double)nbNs;
+    }
+    return cyclesPerNs;
+}
+
+/* Sorts `values` in place (they are few), and returns their median */
+static double XSUM_median(double* values, int nbValues)
 {
-    return clock() - start;   /* works even if overflow; Typical max span ~ 30 mn */
+    int i, j;
+    for (i = 1; i < nbValues; i++) {
+        double const v = values[i];
+        for (j = i; j > 0 && values[j-1] > v; j--) values[j] = values[j-1];
+        values[j] = v;
+    }
+    if (nbValues % 2) return values[nbValues / 2];
+    return (values[nbValues/2 - 1] + values[nbValues/2]) / 2;
 }
 
 static size_t XSUM_findMaxMem(XSUM_U64 requiredMem)
@@ -224,95 +270,175 @@ const char k_testIDs_default[NB_TESTFUNC] = { 0,
         1 /*XXH128*/ };
 
 int g_nbIterations = NBLOOPS_DEFAULT;
+int g_benchFormat = XSUM_benchFormat_text;
 #define HASHNAME_MAX 29
+#define XSUM_BENCHNAME_SIZE 49   /* longest name, with " unaligned" */
+
+/*
+ * Results of XSUM_benchHash(), kept for XSUM_benchReport().
+ * `hashPerSecond` and `cyclesPerByte` come from the fastest round.
+ * `noise` is the relative standard deviation of the durations of rounds.
+ */
+typedef struct {
+    int    testID;
+    char   name[XSUM_BENCHNAME_SIZE];
+    size_t size;
+    double hashPerSecond;
+    double medianHashPerSecond;
+    double cyclesPerByte;   /* 0 without cycle counter */
+    double noise;
+    int    nbRounds;
+} XSUM_benchResult;
+
+typedef struct {
+    XSUM_benchResult* results;
+    size_t nbResults;
+    size_t capacity;
+} XSUM_benchResults;
+
+static XSUM_benchResults g_benchResults = { NULL, 0, 0 };
+static XSUM_benchResults g_benchBaseline = { NULL, 0, 0 };
+static int g_hasBaseline = 0;
+
+static XSUM_benchResult* XSUM_benchAddResult(XSUM_benchResults* list)
+{
+    if (list->nbResults == list->capacity) {
+        size_t const capacity = list->capacity ? 2 * list->capacity : 32;
+        XSUM_benchResult* const results = (XSUM_benchResult*)realloc(list->results, capacity * sizeof(*results));
+        if (results == NULL) {
+            XSUM_log("\nError: Out of memory.\n");
+            exit(12);
+        }
+        list->results = results;
+        list->capacity = capacity;
+    }
+    memset(list->results + list->nbResults, 0, sizeof(*list->results));
+    return list->results + list->nbResults++;
+}
+/* Square root of x >= 0, without libm */
+static double XSUM_sqrt(double x)
+{
+    double r = (x > 1.) ? x : 1.;
+    int i;
+    if (x <= 0.) return 0.;
+    for (i = 0; i < 100; i++) {
+        double const next = (r + x / r) / 2;
+        if (next >= r) break;   /* converged: Newton's method decreases from above */
+        r = next;
+    }
+    return r;
+}
+
 static void XSUM_benchHash(hashFunction h, const char* hName, int testID,
                            const void* buffer, size_t bufferSize)
 {
     XSUM_U32 nbh_perIteration = (XSUM_U32)((XXH_1ST_SPEED_TARGET MB) / (bufferSize+1)) + 1;
-    int iterationNb, nbIterations = g_nbIterations + !g_nbIterations /* min 1 */;
-    double fastestH = 100000000.;
+    int const nbIterations = g_nbIterations + !g_nbIterations /* min 1 */;
+    double* const nsPerHash = (double*)malloc((size_t)nbIterations * sizeof(double));
+    double fastestH = 100000000.;   /* ns per hash */
+    double fastestCycles = 0.;      /* cycles per hash, during the fastest round */
+    int warmup = (g_nbIterations > 0);
+    int nbRounds = 0;
     assert(HASHNAME_MAX > 2);
+    if (nsPerHash == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        exit(12);
+    }
     XSUM_logVerbose(2, "\r%80s\r", "");       /* Clean display line */
 
-    for (iterationNb = 1; iterationNb <= nbIterations; iterationNb++) {
+    while (nbRounds < nbIterations) {
         XSUM_U32 r=0;
-        clock_t cStart;
+        XSUM_U64 startNs, startCycles, nbNs, nbCycles;
+        double nbh_perSecond;
 
         XSUM_logVerbose(2, "%2i-%-*.*s : %10u ->\r",
-                        iterationNb,
+                        nbRounds + 1,
                         HASHNAME_MAX, HASHNAME_MAX, hName,
                         (unsigned)bufferSize);
-        cStart = clock();
-        while (clock() == cStart);   /* starts clock() at its exact beginning */
-        cStart = clock();
-
+        startNs = XSUM_clockNs();
+        startCycles = XSUM_readCycles();
         {   XSUM_U32 u;
             for (u=0; u<nbh_perIteration; u++)
                 r += h(buffer, bufferSize, u);
         }
+        nbCycles = XSUM_readCycles() - startCycles;
+        nbNs = XSUM_clockNs() - startNs;
         if (r==0) XSUM_logVerbose(3,".\r");  /* do something with r to defeat compiler "optimizing" hash away */
 
-        {   clock_t const nbTicks = XSUM_clockSpan(cStart);
-            double const ticksPerHash = ((double)nbTicks / TIMELOOP) / nbh_perIteration;
-            /*
-             * clock() is the only decent portable timer, but it isn't very
-             * precise.
-             *
-             * Sometimes, this lack of precision is enough that the benchmark
-             * finishes before there are enough ticks to get a meaningful result.
-             *
-             * For example, on a Core 2 Duo (without any sort of Turbo Boost),
-             * the imprecise timer caused peculiar results like so:
-             *
-             *    XXH3_64b                   4800.0 MB/s // conveniently even
-             *    XXH3_64b unaligned         4800.0 MB/s
-             *    XXH3_64b seeded            9600.0 MB/s // magical 2x speedup?!
-             *    XXH3_64b seeded unaligned  4800.0 MB/s
-             *
-             * If we sense a suspiciously low number of ticks, we increase the
-             * iterations until we can get something meaningful.
-             */
-            if (nbTicks < TIMELOOP_MIN) {
-                /* Not enough time spent in benchmarking, risk of rounding bias */
-                if (nbTicks == 0) { /* faster than resolution timer */
-                    nbh_perIteration *= 100;
-                } else {
-                    /*
-                     * update nbh_perIteration so that the next round lasts
-                     * approximately 1 second.
-                     */
-                    double nbh_perSecond = (1 / ticksPerHash) + 1;
-                    if (nbh_perSecond > (double)(4000U<<20)) nbh_perSecond = (double)(4000U<<20);   /* avoid overflow */
-                    nbh_perIteration = (XSUM_U32)nbh_perSecond;
-                }
-                /* g_nbIterations==0 => quick evaluation, no claim of accuracy */
-                if (g_nbIterations>0) {
-                    iterationNb--;   /* new round for a more accurate speed evaluation */
-                    continue;
-                }
-            }
-            if (ticksPerHash < fastestH) fastestH = ticksPerHash;
-            if (fastestH>0.) { /* avoid div by zero */
-                XSUM_logVerbose(2, "%2i-%-*.*s : %10u -> %8.0f it/s (%7.1f MB/s) \r",
-                            iterationNb,
+        /* update nbh_perIteration so that the next round lasts approximately TIMELOOP_S */
+        if (nbNs == 0) { /* faster than resolution timer */
+            nbh_perSecond = (double)nbh_perIteration * 100;
+        } else {
+            nbh_perSecond = TIMELOOP_NS * nbh_perIteration / (double)nbNs + 1;
+        }
+        if (nbh_perSecond > (double)(4000U<<20)) nbh_perSecond = (double)(4000U<<20);   /* avoid overflow */
+
+        /*
+         * The first round, and rounds too short to be measured accurately,
+         * are warmup: they let the CPU reach a steady frequency, fill caches
+         * and branch predictors, and calibrate nbh_perIteration.
+         * g_nbIterations==0 => quick evaluation, no warmup, no claim of accuracy
+         */
+        if (g_nbIterations > 0 && (warmup || (double)nbNs < TIMELOOP_MIN_NS)) {
+            warmup = 0;
+            nbh_perIteration = (XSUM_U32)nbh_perSecond;
+            continue;
+        }
+
+        nsPerHash[nbRounds] = (nbNs ? (double)nbNs : 1.) / nbh_perIteration;
+        if (nsPerHash[nbRounds] < fastestH) {
+            fastestH = nsPerHash[nbRounds];
+            fastestCycles = (double)nbCycles / nbh_perIteration;
+        }
+        nbRounds++;
+        XSUM_logVerbose(2, "%2i-%-*.*s : %10u -> %8.0f it/s (%7.1f MB/s) \r",
+                        nbRounds,
+                        HASHNAME_MAX, HASHNAME_MAX, hName,
+                        (unsigned)bufferSize,
+                        1000000000. / fastestH,
+                        ((double)bufferSize / (1 MB)) / (fastestH / 1000000000.));
+        nbh_perIteration = (XSUM_U32)nbh_perSecond;
+    }
+
+    {   XSUM_benchResult* const result = XSUM_benchAddResult(&g_benchResults);
+        double mean = 0., variance = 0.;
+        int n;
+        for (n = 0; n < nbRounds; n++) mean += nsPerHash[n];
+        mean /= nbRounds;
+        for (n = 0; n < nbRounds; n++) variance += (nsPerHash[n] - mean) * (nsPerHash[n] - mean);
+        if (nbRounds > 1) variance /= nbRounds - 1;
+
+        result->testID = testID;
+        strncpy(result->name, hName, sizeof(result->name) - 1);
+        result->size = bufferSize;
+        result->hashPerSecond = 1000000000. / fastestH;
+        result->medianHashPerSecond = 1000000000. / XSUM_median(nsPerHash, nbRounds);
+        result->cyclesPerByte = (XSUM_HAS_CYCLES && bufferSize) ? fastestCycles / (double)bufferSize : 0.;
+        result->noise = XSUM_sqrt(variance) / mean;
+        result->nbRounds = nbRounds;
+
+        if (XSUM_HAS_CYCLES) {
+            XSUM_logVerbose(1, "%2i#%-*.*s : %10u -> %8.0f it/s (%7.1f MB/s, %6.3f cycles/B) +/-%4.1f%% \n",
+                            testID,
                             HASHNAME_MAX, HASHNAME_MAX, hName,
                             (unsigned)bufferSize,
-                            (double)1 / fastestH,
-                            ((double)bufferSize / (1 MB)) / fastestH);
-        }   }
-        {   double nbh_perSecond = (1 / fastestH) + 1;
-            if (nbh_perSecond > (double)(4000U<<20)) nbh_perSecond = (double)(4000U<<20);   /* avoid overflow */
-            nbh_perIteration = (XSUM_U32)nbh_perSecond;
+                            result->hashPerSecond,
+                            result->hashPerSecond * (double)bufferSize / (1 MB),
+                            result->cyclesPerByte,
+                            100. * result->noise);
+        } else {
+            XSUM_logVerbose(1, "%2i#%-*.*s : %10u -> %8.0f it/s (%7.1f MB/s) +/-%4.1f%% \n",
+                            testID,
+                            HASHNAME_MAX, HASHNAME_MAX, hName,
+                            (unsigned)bufferSize,
+                            result->hashPerSecond,
+                            result->hashPerSecond * (double)bufferSize / (1 MB),
+                            100. * result->noise);
         }
+        if (XSUM_logLevel<1)
+            XSUM_logVerbose(0, "%u, ", (unsigned)result->hashPerSecond);
     }
-    XSUM_logVerbose(1, "%2i#%-*.*s : %10u -> %8.0f it/s (%7.1f MB/s) \n",
-                    testID,
-                    HASHNAME_MAX, HASHNAME_MAX, hName,
-                    (unsigned)bufferSize,
-                    (double)1 / fastestH,
-                    ((double)bufferSize / (1 MB)) / fastestH);
-    if (XSUM_logLevel<1)
-        XSUM_logVerbose(0, "%u, ", (unsigned)((double)1 / fastestH));
+    free(nsPerHash);
 }
 
 
@@ -352,6 +478,8 @@ static void XSUM_benchMem(const void* buffer, size_t bufferSize)
 {
     assert((((size_t)buffer) & 15) == 0);  /* ensure alignment */
     XSUM_fillTestBuffer(g_benchSecretBuf, sizeof(g_benchSecretBuf));
+    if (XSUM_HAS_CYCLES)
+        XSUM_logVerbose(2, "Cycle counter at %.3f GHz: cycles/B are reference cycles \n", XSUM_cyclesPerNs());
     {   int i;
         for (i = 1; i < (int)NB_TESTFUNC; i++) {
             int const hashFuncID = (i-1) / 2;
@@ -372,6 +500,261 @@ static void XSUM_benchMem(const void* buffer, size_t bufferSize)
     }   }
 }
 
+/*
+ * Reports in CSV or JSON, and comparison with a baseline
+ */
+#define XSUM_BASELINE_THRESHOLD 0.03   /* smallest slowdown considered significant */
+
+static void XSUM_benchJsonString(const char* s)
+{
+    XSUM_output("\"");
+    for (; *s; s++) {
+        unsigned char const c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            XSUM_output("\\%c", c);
+        } else if (c < 0x20) {
+            XSUM_output("\\u%04x", c);
+        } else {
+            XSUM_output("%c", c);
+    }   }
+    XSUM_output("\"");
+}
+
+static void XSUM_benchPrintResults(void)
+{
+    XSUM_hostInfo host;
+    char compiler[256];
+    size_t n;
+    XSUM_getHostInfo(&host);
+    sprintf(compiler, XSUM_CC_VERSION_FMT, XSUM_CC_VERSION);
+    fflush(stderr);   /* progress lines, on a terminal */
+
+    if (g_benchFormat == XSUM_benchFormat_csv) {
+        XSUM_output("# xxhsum=%s\n# compiler=%s\n# arch=%s\n# host=%s\n# os=%s\n# cpu=%s\n"
+                    "# cycle_counter_ghz=%.3f\n# iterations=%i\n",
+                    XSUM_PROGRAM_VERSION, compiler, XSUM_ARCH, host.host, host.os, host.cpu,
+                    XSUM_HAS_CYCLES ? XSUM_cyclesPerNs() : 0., g_nbIterations);
+        XSUM_output("id,name,size,hashes_per_s,mb_per_s,median_hashes_per_s,cycles_per_byte,rounds,noise\n");
+        for (n = 0; n < g_benchResults.nbResults; n++) {
+            const XSUM_benchResult* const r = g_benchResults.results + n;
+            XSUM_output("%i,%s,%llu,%.1f,%.1f,%.1f,%.4f,%i,%.4f\n",
+                        r->testID, r->name, (unsigned long long)r->size, r->hashPerSecond,
+                        r->hashPerSecond * (double)r->size / (1 MB), r->medianHashPerSecond,
+                        r->cyclesPerByte, r->nbRounds, r->noise);
+        }
+        return;
+    }
+
+    XSUM_output("{\"xxhsum\": \"%s\", \"compiler\": ", XSUM_PROGRAM_VERSION);
+    XSUM_benchJsonString(compiler);
+    XSUM_output(", \"arch\": \"%s\", \"host\": ", XSUM_ARCH);
+    XSUM_benchJsonString(host.host);
+    XSUM_output(", \"os\": ");
+    XSUM_benchJsonString(host.os);
+    XSUM_output(", \"cpu\": ");
+    XSUM_benchJsonString(host.cpu);
+    if (XSUM_HAS_CYCLES) {
+        XSUM_output(", \"cycle_counter_ghz\": %.3f", XSUM_cyclesPerNs());
+    } else {
+        XSUM_output(", \"cycle_counter_ghz\": null");
+    }
+    XSUM_output(", \"iterations\": %i, \"results\": [", g_nbIterations);
+    for (n = 0; n < g_benchResults.nbResults; n++) {
+        const XSUM_benchResult* const r = g_benchResults.results + n;
+        XSUM_output("%s\n  {\"id\": %i, \"name\": \"%s\", \"size\": %llu, \"hashes_per_s\": %.1f, "
+                    "\"mb_per_s\": %.1f, \"median_hashes_per_s\": %.1f, ",
+                    n ? "," : "", r->testID, r->name, (unsigned long long)r->size, r->hashPerSecond,
+                    r->hashPerSecond * (double)r->size / (1 MB), r->medianHashPerSecond);
+        if (XSUM_HAS_CYCLES) {
+            XSUM_output("\"cycles_per_byte\": %.4f, ", r->cyclesPerByte);
+        } else {
+            XSUM_output("\"cycles_per_byte\": null, ");
+        }
+        XSUM_output("\"rounds\": %i, \"noise\": %.4f}", r->nbRounds, r->noise);
+    }
+    XSUM_output("\n]}\n");
+}
+
+/*
+ * Columns of --format=csv read back by --baseline. Files are parsed by their
+ * `id,name,...` header, so older files, without median_hashes_per_s or
+ * cycles_per_byte, are still accepted: their hashes_per_s is compared.
+ */
+typedef enum {
+    XSUM_col_ignored, XSUM_col_id, XSUM_col_name, XSUM_col_size, XSUM_col_hashes,
+    XSUM_col_median, XSUM_col_cycles, XSUM_col_rounds, XSUM_col_noise
+} XSUM_baselineColumn;
+#define XSUM_BASELINE_COLUMNS_MAX 32
+
+static XSUM_baselineColumn XSUM_baselineColumnOf(const char* name)
+{
+    if (!strcmp(name, "id")) return XSUM_col_id;
+    if (!strcmp(name, "name")) return XSUM_col_name;
+    if (!strcmp(name, "size")) return XSUM_col_size;
+    if (!strcmp(name, "hashes_per_s")) return XSUM_col_hashes;
+    if (!strcmp(name, "median_hashes_per_s")) return XSUM_col_median;
+    if (!strcmp(name, "cycles_per_byte")) return XSUM_col_cycles;
+    if (!strcmp(name, "rounds")) return XSUM_col_rounds;
+    if (!strcmp(name, "noise")) return XSUM_col_noise;
+    return XSUM_col_ignored;
+}
+
+/*
+ * Splits `line` in place on commas, removing the end of line.
+ * Returns the number of fields, or 0 if there are more than `maxFields`.
+ */
+static size_t XSUM_splitCsvLine(char* line, char* fields[], size_t maxFields)
+{
+    size_t nbFields = 0;
+    line[strcspn(line, "\r\n")] = '\0';
+    for (;;) {
+        char* const comma = strchr(line, ',');
+        if (nbFields == maxFields) return 0;
+        fields[nbFields++] = line;
+        if (comma == NULL) return nbFields;
+        *comma = '\0';
+        line = comma + 1;
+    }
+}
+
+/* Fills `r` from the fields of a data line. Returns 0 on success. */
+static int XSUM_parseBaselineLine(XSUM_benchResult* r, char* fields[], size_t nbFields,
+                                  const XSUM_baselineColumn columns[])
+{
+    int hasName = 0, hasSize = 0, hasSpeed = 0;
+    size_t n;
+    memset(r, 0, sizeof(*r));
+    for (n = 0; n < nbFields; n++) {
+        const char* const field = fields[n];
+        unsigned long long size;
+        int ok = 1;
+        switch (columns[n]) {
+        case XSUM_col_ignored:
+            break;
+        case XSUM_col_id:
+            ok = (sscanf(field, "%d", &r->testID) == 1);
+            break;
+        case XSUM_col_name:
+            ok = (field[0] != '\0' && strlen(field) < sizeof(r->name));
+            if (ok) strcpy(r->name, field);
+            hasName = 1;
+            break;
+        case XSUM_col_size:
+            ok = (sscanf(field, "%llu", &size) == 1);
+            r->size = (size_t)size;
+            hasSize = 1;
+            break;
+        case XSUM_col_hashes:
+            ok = (sscanf(field, "%lf", &r->hashPerSecond) == 1);
+            hasSpeed = 1;
+            break;
+        case XSUM_col_median:
+            ok = (sscanf(field, "%lf", &r->medianHashPerSecond) == 1);
+            hasSpeed = 1;
+            break;
+        case XSUM_col_cycles:
+            ok = (sscanf(field, "%lf", &r->cyclesPerByte) == 1);
+            break;
+        case XSUM_col_rounds:
+            ok = (sscanf(field, "%d", &r->nbRounds) == 1);
+            break;
+        case XSUM_col_noise:
+            ok = (sscanf(field, "%lf", &r->noise) == 1);
+            break;
+        }
+        if (!ok) return 1;
+    }
+    /* files written before median_hashes_per_s only have the fastest round */
+    if (r->medianHashPerSecond <= 0.) r->medianHashPerSecond = r->hashPerSecond;
+    return !(hasName && hasSize && hasSpeed);
+}
+
+int XSUM_benchLoadBaseline(const char* fileName)
+{
+    FILE* const inFile = XSUM_fopen(fileName, "r");
+    XSUM_baselineColumn columns[XSUM_BASELINE_COLUMNS_MAX];
+    size_t nbColumns = 0;   /* 0: no header yet */
+    char line[512];
+    unsigned lineNb = 0;
+    if (inFile == NULL) {
+        XSUM_log("Error: Could not open '%s': %s. \n", fileName, strerror(errno));
+        return 1;
+    }
+    while (fgets(line, sizeof(line), inFile) != NULL) {
+        char* fields[XSUM_BASELINE_COLUMNS_MAX];
+        size_t nbFields;
+        XSUM_benchResult r;
+        lineNb++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        nbFields = XSUM_splitCsvLine(line, fields, XSUM_BASELINE_COLUMNS_MAX);
+        if (nbColumns == 0 && nbFields > 0 && !strcmp(fields[0], "id")) {
+            size_t n;
+            for (n = 0; n < nbFields; n++) columns[n] = XSUM_baselineColumnOf(fields[n]);
+            nbColumns = nbFields;
+            continue;
+        }
+        if ( nbColumns == 0 || nbFields != nbColumns
+          || XSUM_parseBaselineLine(&r, fields, nbFields, columns) ) {
+            XSUM_log("Error: %s:%u: not a result of --format=csv \n", fileName, lineNb);
+            fclose(inFile);
+            return 1;
+        }
+        *XSUM_benchAddResult(&g_benchBaseline) = r;
+    }
+    fclose(inFile);
+    if (nbColumns == 0) {
+        XSUM_log("Error: %s: no id,name,... header, not a result of --format=csv \n", fileName);
+        return 1;
+    }
+    g_hasBaseline = 1;
+    return 0;
+}
+
+/*
+ * A result is significantly slower when its median speed drops by more than
+ * XSUM_BASELINE_THRESHOLD, plus the noise of the noisiest of both runs.
+ * Returns the number of such results.
+ */
+static int XSUM_benchCompare(void)
+{
+    int nbSlower = 0;
+    size_t n, b;
+    for (n = 0; n < g_benchResults.nbResults; n++) {
+        const XSUM_benchResult* const r = g_benchResults.results + n;
+        const XSUM_benchResult* base = NULL;
+        for (b = 0; b < g_benchBaseline.nbResults && base == NULL; b++) {
+            if (g_benchBaseline.results[b].size == r->size && !strcmp(g_benchBaseline.results[b].name, r->name))
+                base = g_benchBaseline.results + b;
+        }
+        if (base == NULL || base->medianHashPerSecond <= 0.) {
+            XSUM_logVerbose(1, "%2i#%-*.*s : %10u -> not in baseline \n",
+                            r->testID, HASHNAME_MAX, HASHNAME_MAX, r->name, (unsigned)r->size);
+            continue;
+        }
+        {   double const change = r->medianHashPerSecond / base->medianHashPerSecond - 1.;
+            double const threshold = XSUM_BASELINE_THRESHOLD + ((r->noise > base->noise) ? r->noise : base->noise);
+            int const slower = (change < -threshold);
+            nbSlower += slower;
+            XSUM_logVerbose(1, "%2i#%-*.*s : %10u -> %+6.1f %% vs baseline (threshold %4.1f %%) %s\n",
+                            r->testID, HASHNAME_MAX, HASHNAME_MAX, r->name, (unsigned)r->size,
+                            100. * change, 100. * threshold, slower ? "SLOWER " : "");
+    }   }
+    if (nbSlower)
+        XSUM_log("Error: %i result(s) significantly slower than baseline \n", nbSlower);
+    return nbSlower;
+}
+
+/* Completes a benchmark run: returns 1 if it is slower than the baseline */
+static int XSUM_benchReport(void)
+{
+    int result = 0;
+    if (g_benchFormat != XSUM_benchFormat_text) XSUM_benchPrintResults();
+    if (g_hasBaseline) result = (XSUM_benchCompare() > 0);
+    free(g_benchResults.results);
+    free(g_benchBaseline.results);
+    return result;
+}
+
 static size_t XSUM_selectBenchedSize(const char* fileName)
 {
     XSUM_U64 const inFileSize = XSUM_getFileSize(fileName);
@@ -422,9 +805,404 @@ int XSUM_benchFiles(const char* fileNamesTable[], int nbFiles)
 
             free(buffer);
     }   }
+    return XSUM_benchReport();
+}
+
+
+/*
+ * I/O strategies.
+ *
+ * XSUM_benchFiles() measures hashing of data already in memory.
+ * XSUM_benchFilesIO() measures the whole path instead, from the storage
+ * device (or the OS cache) to the digest, for several ways of reading a file.
+ * Files are streamed, so they can be larger than the available memory.
+ */
+#define XSUM_IO_THREADS_DEFAULT 4
+#define XSUM_IO_BLOCKSIZE_DEFAULT (1 MB)
+
+typedef struct {
+    const char* fileName;
+    XSUM_U64 fileSize;
+    size_t   blockSize;
+    int      nbThreads;
+} XSUM_ioParams;
+
+/* Returns 0, or an errno value; `*hash` receives a digest of the content */
+typedef int (*XSUM_ioStrategy)(const XSUM_ioParams* params, XSUM_U64* hash);
+
+typedef struct {
+    const char* fileName;
+    XSUM_U64 start;
+    XSUM_U64 length;
+    size_t   blockSize;
+    XSUM_U64 hash;
+    int      errorNb;
+} XSUM_ioRange;
+
+/* XSUM_poolJob_f: hashes `length` bytes from `start`, read with fread() */
+static void XSUM_ioReadRange(void* opaque)
+{
+    XSUM_ioRange* const range = (XSUM_ioRange*)opaque;
+    FILE* const inFile = XSUM_fopen(range->fileName, "rb");
+    void* const buffer = malloc(range->blockSize);
+    XXH3_state_t state;
+    XSUM_U64 left = range->length;
+
+    range->errorNb = 0;
+    XXH3_64bits_reset(&state);
+    if (inFile == NULL || buffer == NULL) {
+        range->errorNb = (inFile == NULL) ? errno : ENOMEM;
+    } else if (XSUM_seekFile(inFile, range->start)) {
+        range->errorNb = errno ? errno : EIO;
+    } else {
+        while (left > 0) {
+            size_t const toRead = (left < range->blockSize) ? (size_t)left : range->blockSize;
+            size_t const readSize = fread(buffer, 1, toRead, inFile);
+            XXH3_64bits_update(&state, buffer, readSize);
+            left -= readSize;
+            if (readSize < toRead) {
+                if (ferror(inFile)) range->errorNb = EIO;
+                break;
+        }   }
+    }
+    range->hash = XXH3_64bits_digest(&state);
+    free(buffer);
+    if (inFile != NULL) fclose(inFile);
+}
+
+static int XSUM_ioFread(const XSUM_ioParams* params, XSUM_U64* hash)
+{
+    XSUM_ioRange range;
+    range.fileName = params->fileName;
+    range.start = 0;
+    range.length = params->fileSize;
+    range.blockSize = params->blockSize;
+    XSUM_ioReadRange(&range);
+    *hash = range.hash;
+    return range.errorNb;
+}
+
+static int XSUM_ioMmap(const XSUM_ioParams* params, XSUM_U64* hash)
+{
+    size_t size;
+    void* const data = XSUM_mapFile(params->fileName, &size);
+    if (data == NULL) return errno ? errno : EINVAL;
+    *hash = XXH3_64bits(data, size);
+    XSUM_unmapFile(data, size);
     return 0;
 }
 
+static int XSUM_ioDirect(const XSUM_ioParams* params, XSUM_U64* hash)
+{
+    /* the block size must be a multiple of the alignment */
+    size_t const blockSize = (params->blockSize + XSUM_DIRECT_ALIGN - 1) & ~(size_t)(XSUM_DIRECT_ALIGN - 1);
+    char* const buffer = (char*)malloc(blockSize + XSUM_DIRECT_ALIGN);
+    XSUM_directFile* const file = XSUM_openDirect(params->fileName);
+    int errorNb = 0;
+
+    if (buffer == NULL || file == NULL) {
+        errorNb = (file == NULL) ? errno : ENOMEM;
+    } else {
+        void* const alignedBuffer = buffer + XSUM_DIRECT_ALIGN - ((size_t)buffer & (XSUM_DIRECT_ALIGN - 1));
+        XXH3_state_t state;
+        long readSize;
+        XXH3_64bits_reset(&state);
+        while ((readSize = XSUM_readDirect(file, alignedBuffer, blockSize)) > 0)
+            XXH3_64bits_update(&state, alignedBuffer, (size_t)readSize);
+        if (readSize < 0) errorNb = errno;
+        *hash = XXH3_64bits_digest(&state);
+    }
+    XSUM_closeDirect(file);
+    free(buffer);
+    return errorNb;
+}
+
+/* Each thread hashes its own slice of the file: digests differ from XSUM_ioFread() */
+static int XSUM_ioThreads(const XSUM_ioParams* params, XSUM_U64* hash)
+{
+    size_t const nbRanges = (size_t)params->nbThreads;
+    XSUM_ioRange* const ranges = (XSUM_ioRange*)malloc(nbRanges * sizeof(*ranges));
+    XSUM_pool* const pool = XSUM_pool_create(params->nbThreads);
+    int errorNb = 0;
+
+    if (ranges == NULL || pool == NULL) {
+        errorNb = ENOMEM;
+    } else {
+        /* slices are whole blocks, the last one takes what remains */
+        XSUM_U64 const nbBlocks = (params->fileSize + params->blockSize - 1) / params->blockSize;
+        XSUM_U64 const sliceSize = ((nbBlocks + nbRanges - 1) / nbRanges) * params->blockSize;
+        size_t n;
+        for (n = 0; n < nbRanges; n++) {
+            XSUM_U64 const start = sliceSize * n;
+            ranges[n].fileName = params->fileName;
+            ranges[n].start = start;
+            ranges[n].length = (start >= params->fileSize) ? 0
+                             : (params->fileSize - start < sliceSize) ? params->fileSize - start : sliceSize;
+            ranges[n].blockSize = params->blockSize;
+            XSUM_pool_add(pool, XSUM_ioReadRange, ranges + n, NULL);
+        }
+        XSUM_pool_waitAll(pool);
+        *hash = 0;
+        for (n = 0; n < nbRanges; n++) {
+            *hash ^= ranges[n].hash;
+            if (ranges[n].errorNb) errorNb = ranges[n].errorNb;
+    }   }
+    XSUM_pool_free(pool);
+    free(ranges);
+    return errorNb;
+}
+
+/*
+ * Runs `strategy` g_nbIterations times with a cold cache, when `dropCache`,
+ * then as many times with a warm cache, and displays the best speed of each.
+ */
+static void XSUM_benchIOStrategy(const char* name, XSUM_ioStrategy strategy,
+                                 const XSUM_ioParams* params, int dropCache)
+{
+    int const nbIterations = g_nbIterations + !g_nbIterations /* min 1 */;
+    double bestSpeed[2] = { 0., 0. };   /* cold, warm; in MB/s */
+    XSUM_U64 sink = 0;
+    int warm, iterationNb;
+
+    for (warm = !dropCache; warm <= 1; warm++) {
+        for (iterationNb = 1; iterationNb <= nbIterations; iterationNb++) {
+            XSUM_U64 hash = 0;
+            XSUM_U64 start, nbNs;
+            int errorNb;
+            XSUM_logVerbose(2, "%2i-%-*.*s : %s \r", iterationNb, HASHNAME_MAX, HASHNAME_MAX, name, warm ? "warm" : "cold");
+            if (!warm && XSUM_dropFileCache(params->fileName)) break;
+            start = XSUM_clockNs();
+            errorNb = strategy(params, &hash);
+            nbNs = XSUM_clockNs() - start;
+            if (errorNb) {
+                XSUM_logVerbose(1, "%-*.*s : n/a (%s) \n", HASHNAME_MAX+3, HASHNAME_MAX+3, name, strerror(errorNb));
+                return;
+            }
+            sink += hash;
+            if (nbNs == 0) nbNs = 1;
+            {   double const speed = ((double)params->fileSize / (1 MB)) / ((double)nbNs / 1000000000.);
+                if (speed > bestSpeed[warm]) bestSpeed[warm] = speed;
+    }   }   }
+    if (sink == 0) XSUM_logVerbose(3, ".\r");  /* do something with sink to defeat compiler "optimizing" it away */
+
+    if (dropCache) {
+        XSUM_logVerbose(1, "%-*.*s : cold %8.1f MB/s, warm %8.1f MB/s \n",
+                        HASHNAME_MAX+3, HASHNAME_MAX+3, name, bestSpeed[0], bestSpeed[1]);
+    } else {
+        XSUM_logVerbose(1, "%-*.*s : cold      n/a,      warm %8.1f MB/s \n",
+                        HASHNAME_MAX+3, HASHNAME_MAX+3, name, bestSpeed[1]);
+    }
+}
+
+/* Writes "<prefix> <blockSize>" into `name`, in KB when it's a whole number of KB */
+static void XSUM_ioName(char* name, const char* prefix, size_t blockSize)
+{
+    if (blockSize % (1 KB) == 0) {
+        sprintf(name, "%s %u KB", prefix, (unsigned)(blockSize >> 10));
+    } else {
+        sprintf(name, "%s %u B", prefix, (unsigned)blockSize);
+    }
+}
+
+int XSUM_benchFilesIO(const char* fileNamesTable[], int nbFiles, size_t blockSize, int nbThreads)
+{
+    int fileIdx;
+    if (nbThreads < 0) nbThreads = XSUM_IO_THREADS_DEFAULT;
+    if (nbThreads == 0) nbThreads = XSUM_getNbCores();
+
+    for (fileIdx=0; fileIdx<nbFiles; fileIdx++) {
+        const char* const inFileName = fileNamesTable[fileIdx];
+        XSUM_fileStat st;
+        XSUM_ioParams params;
+        int dropCache;
+        char name[64];
+        assert(inFileName != NULL);
+
+        if (XSUM_statFile(inFileName, &st)) {
+            XSUM_log("Error: Could not open '%s': %s.\n", inFileName, strerror(errno));
+            exit(11);
+        }
+        if (XSUM_getFileType(inFileName) != XSUM_fileType_regular || st.size == 0) {
+            XSUM_log("Skipping '%s': not a regular file, or empty.\n", inFileName);
+            continue;
+        }
+        params.fileName = inFileName;
+        params.fileSize = st.size;
+        params.nbThreads = nbThreads;
+
+        XSUM_logVerbose(1, "%s : %llu bytes, XXH3_64b, best of %i \n",
+                        inFileName, (unsigned long long)st.size, g_nbIterations + !g_nbIterations);
+        dropCache = (XSUM_dropFileCache(inFileName) == 0);
+        if (!dropCache)
+            XSUM_logVerbose(1, "Cannot drop '%s' from the cache (%s): cold speeds are not measured \n",
+                            inFileName, strerror(errno));
+
+        {   static const size_t defaultBlockSizes[] = { 4 KB, 64 KB, 1 MB };
+            size_t const nbBlockSizes = blockSize ? 1 : sizeof(defaultBlockSizes) / sizeof(*defaultBlockSizes);
+            size_t n;
+            for (n = 0; n < nbBlockSizes; n++) {
+                params.blockSize = blockSize ? blockSize : defaultBlockSizes[n];
+                XSUM_ioName(name, "fread", params.blockSize);
+                XSUM_benchIOStrategy(name, XSUM_ioFread, &params, dropCache);
+        }   }
+        params.blockSize = blockSize ? blockSize : XSUM_IO_BLOCKSIZE_DEFAULT;
+        XSUM_benchIOStrategy("mmap", XSUM_ioMmap, &params, dropCache);
+        XSUM_ioName(name, "O_DIRECT", (params.blockSize + XSUM_DIRECT_ALIGN - 1) & ~(size_t)(XSUM_DIRECT_ALIGN - 1));
+        XSUM_benchIOStrategy(name, XSUM_ioDirect, &params, dropCache);
+        XSUM_ioName(name, "fread", params.blockSize);
+        sprintf(name + strlen(name), " x %i thread%s", nbThreads, nbThreads > 1 ? "s" : "");
+        XSUM_benchIOStrategy(name, XSUM_ioThreads, &params, dropCache);
+    }
+    return 0;
+}
+
+
+/*
+ * Memory bandwidth scaling.
+ *
+ * Each thread hashes its own buffer, much larger than CPU caches, so that
+ * data comes from DRAM. Adding threads shows how many cores it takes to
+ * saturate memory bandwidth: past that point, the speed of each thread drops.
+ */
+#define XSUM_SCALING_BUFFER_DEFAULT (64 MB)
+
+typedef struct {
+    hashFunction func;
+    XSUM_U8*     buffer;
+    size_t       size;
+    XSUM_U32     nbLoops;
+    int          cpu;      /* < 0: not pinned */
+    XSUM_U32     result;
+} XSUM_scalingJob;
+
+/*
+ * XSUM_poolJob_f: fills the buffer. With --pin, the hashing thread runs on
+ * the same core, so the pages are local to it; otherwise the scheduler may
+ * move threads, and pages, between nodes.
+ */
+static void XSUM_scalingFill(void* opaque)
+{
+    XSUM_scalingJob* const job = (XSUM_scalingJob*)opaque;
+    if (job->cpu >= 0) (void)XSUM_pinThread(job->cpu);
+    XSUM_fillTestBuffer(job->buffer, job->size);
+}
+
+/* XSUM_poolJob_f */
+static void XSUM_scalingHash(void* opaque)
+{
+    XSUM_scalingJob* const job = (XSUM_scalingJob*)opaque;
+    XSUM_U32 u, r = 0;
+    if (job->cpu >= 0) (void)XSUM_pinThread(job->cpu);
+    for (u = 0; u < job->nbLoops; u++)
+        r += job->func(job->buffer, job->size, u);
+    job->result = r;
+}
+
+/*
+ * Runs all jobs on a pool of `nbThreads` threads, `nbIterations` times.
+ * Returns the fastest run, in nanoseconds.
+ */
+static XSUM_U64 XSUM_scalingRun(XSUM_poolJob_f func, XSUM_scalingJob* jobs, int nbThreads, int nbIterations)
+{
+    /* a pool of 1 thread runs jobs on this thread, which --pin would leave
+     * pinned, along with every thread it creates later: one worker idles */
+    XSUM_pool* const pool = XSUM_pool_create(nbThreads > 1 ? nbThreads : 2);
+    XSUM_U64 fastest = (XSUM_U64)-1;
+    int iterationNb, n;
+    if (pool == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        exit(12);
+    }
+    for (iterationNb = 1; iterationNb <= nbIterations; iterationNb++) {
+        XSUM_U64 const start = XSUM_clockNs();
+        XSUM_U64 nbNs;
+        for (n = 0; n < nbThreads; n++) XSUM_pool_add(pool, func, jobs + n, NULL);
+        XSUM_pool_waitAll(pool);
+        nbNs = XSUM_clockNs() - start;
+        if (nbNs < fastest) fastest = nbNs;
+    }
+    XSUM_pool_free(pool);
+    return fastest ? fastest : 1;
+}
+
+int XSUM_benchThreads(const int threadCounts[], int nbCounts, size_t bufferSize, int pin)
+{
+    int const nbCores = XSUM_getNbCores();
+    int maxThreads = 1;
+    int const nbIterations = g_nbIterations + !g_nbIterations /* min 1 */;
+    int c, n;
+    XSUM_scalingJob* jobs;
+
+    if (bufferSize == 0) bufferSize = XSUM_SCALING_BUFFER_DEFAULT;
+    for (c = 0; c < nbCounts; c++) {
+        int const nbThreads = threadCounts[c] ? threadCounts[c] : nbCores;
+        if (nbThreads > maxThreads) maxThreads = nbThreads;
+    }
+    if (!XSUM_MULTITHREAD)
+        XSUM_log("Warning: built without thread support, threads run one after another \n");
+    if (pin && XSUM_canPinThreads()) {
+        XSUM_log("Warning: cannot pin threads to cores: %s \n", strerror(errno));
+        pin = 0;
+    }
+
+    jobs = (XSUM_scalingJob*)calloc((size_t)maxThreads, sizeof(*jobs));
+    if (jobs == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        exit(12);
+    }
+    for (n = 0; n < maxThreads; n++) {
+        jobs[n].buffer = (XSUM_U8*)malloc(bufferSize);
+        jobs[n].size = bufferSize;
+        jobs[n].cpu = pin ? n % nbCores : -1;
+        if (jobs[n].buffer == NULL) {
+            XSUM_log("\nError: Out of memory: %i threads need %u MB each.\n", maxThreads, (unsigned)(bufferSize >> 20));
+            exit(12);
+    }   }
+    (void)XSUM_scalingRun(XSUM_scalingFill, jobs, maxThreads, 1);
+
+    XSUM_logVerbose(1, "Sample of %u MB per thread, %s... \n",
+                    (unsigned)(bufferSize >> 20), pin ? "pinned to cores" : "not pinned");
+    {   int i;
+        for (i = 1; i < (int)NB_TESTFUNC; i += 2) {   /* aligned variants only */
+            const hashInfo* const h = g_hashesToBench + (i-1) / 2;
+            double baseline = 0.;   /* per thread, first thread count */
+            XSUM_U32 nbLoops;
+            if (g_testIDs[i] == 0) continue;
+
+            /* one thread, one pass: calibrates each run to about TIMELOOP_S seconds */
+            jobs[0].func = h->func;
+            jobs[0].nbLoops = 1;
+            {   XSUM_U64 const passNs = XSUM_scalingRun(XSUM_scalingHash, jobs, 1, nbIterations);
+                double const nbPasses = (TIMELOOP_S * 1000000000.) / (double)passNs;
+                nbLoops = (nbPasses > 1.) ? (XSUM_U32)nbPasses : 1;
+            }
+
+            for (c = 0; c < nbCounts; c++) {
+                int const nbThreads = threadCounts[c] ? threadCounts[c] : nbCores;
+                XSUM_U64 nbNs;
+                double total, perThread;
+                for (n = 0; n < nbThreads; n++) {
+                    jobs[n].func = h->func;
+                    jobs[n].nbLoops = nbLoops;
+                }
+                XSUM_logVerbose(2, "%2i-%-*.*s : %3i thread%s ->\r",
+                                i, HASHNAME_MAX, HASHNAME_MAX, h->name, nbThreads, nbThreads > 1 ? "s" : " ");
+                nbNs = XSUM_scalingRun(XSUM_scalingHash, jobs, nbThreads, nbIterations);
+                total = ((double)bufferSize * nbLoops * nbThreads / (1 GB)) / ((double)nbNs / 1000000000.);
+                perThread = total / nbThreads;
+                if (c == 0) baseline = perThread;
+                XSUM_logVerbose(1, "%2i#%-*.*s : %3i thread%s -> %7.2f GB/s, %6.2f GB/s per thread, %5.1f %% \n",
+                                i, HASHNAME_MAX, HASHNAME_MAX, h->name, nbThreads, nbThreads > 1 ? "s" : " ",
+                                total, perThread, 100. * perThread / baseline);
+            }
+            for (n = 0; n < maxThreads; n++)
+                if (jobs[n].result == 0) XSUM_logVerbose(3, ".\r");  /* defeat compiler "optimizing" hashes away */
+    }   }
+
+    for (n = 0; n < maxThreads; n++) free(jobs[n].buffer);
+    free(jobs);
+    return 0;
+}
 
 int XSUM_benchInternal(size_t keySize)
 {
@@ -448,5 +1226,5 @@ int XSUM_benchInternal(size_t keySize)
         XSUM_benchMem(alignedBuffer, keySize);
         free(buffer);
     }
-    return 0;
+    return XSUM_benchReport();
 }
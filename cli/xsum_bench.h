@@ -29,14 +29,31 @@
 #include <stddef.h>  /* size_t */
 
 #define NBLOOPS_DEFAULT    3    /* Default number of benchmark iterations */
+#define XSUM_BENCH_THREADS_MAX 32  /* Max nb of thread counts in one scaling benchmark */
 
 extern int const g_nbTestFunctions;
 extern char g_testIDs[];  /* size : g_nbTestFunctions */
 extern const char k_testIDs_default[];
 extern int g_nbIterations;
 
+typedef enum { XSUM_benchFormat_text, XSUM_benchFormat_csv, XSUM_benchFormat_json } XSUM_benchFormat;
+extern int g_benchFormat;   /* XSUM_benchFormat: results of XSUM_benchInternal() and XSUM_benchFiles() */
+
+/* Loads the results of a previous --format=csv run. XSUM_benchInternal() and
+ * XSUM_benchFiles() then return 1 when a result is significantly slower.
+ * Returns 0 on success. */
+int XSUM_benchLoadBaseline(const char* fileName);
+
 int XSUM_benchInternal(size_t keySize);
 int XSUM_benchFiles(const char* fileNamesTable[], int nbFiles);
+/* Times reading and hashing files through several I/O strategies.
+ * blockSize==0 selects default block sizes; nbThreads==0 means one per core,
+ * nbThreads<0 selects the default thread count. */
+int XSUM_benchFilesIO(const char* fileNamesTable[], int nbFiles, size_t blockSize, int nbThreads);
+/* Times each thread count of threadCounts[] hashing separate buffers of
+ * bufferSize bytes (0: default), optionally pinning threads to cores.
+ * A count of 0 means one thread per core. */
+int XSUM_benchThreads(const int threadCounts[], int nbCounts, size_t bufferSize, int pin);
 
 
 #ifdef __cplusplus
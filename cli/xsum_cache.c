@@ -0,0 +1,379 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_cache.h"
+#include "xsum_output.h"   /* XSUM_log */
+#include "../xxhash.h"     /* XXH64 */
+#include <stdlib.h>        /* malloc, realloc, free, qsort */
+#include <string.h>        /* memcpy, memcmp, strlen, strncmp, strerror */
+#include <stdio.h>         /* FILE, rename, remove */
+#include <errno.h>         /* errno */
+#include <time.h>          /* time */
+
+/*
+ * Records have a fixed size and are stored in little endian order:
+ *
+ *   offset  size  field
+ *        0     4  record format version (XSUM_CACHE_VERSION)
+ *        4     4  algorithm id
+ *        8     8  key: XXH64 of the file name (0 in extended attributes)
+ *       16     8  file size
+ *       24     8  modification time, in ns
+ *       32     8  change time, in ns
+ *       40     8  inode
+ *       48     8  seed (xxhsum always hashes with seed 0)
+ *       56     4  digest size
+ *       60     4  reserved, 0
+ *       64    16  digest, canonical representation, zero padded
+ *
+ * The index file starts with XSUM_CACHE_MAGIC, the version and the record size
+ * (16 bytes), followed by records sorted by (key, algorithm id).
+ */
+#define XSUM_CACHE_VERSION     1
+#define XSUM_CACHE_RECORD_SIZE 80
+#define XSUM_CACHE_MAGIC       "XXHCACHE"
+#define XSUM_CACHE_HEADER_SIZE 16
+#define XSUM_CACHE_ATTR_PREFIX "user.xxhash."
+
+typedef enum { XSUM_cache_xattr, XSUM_cache_file } XSUM_cacheMode;
+
+struct XSUM_cache_s {
+    XSUM_cacheMode mode;
+    XSUM_U64       startTime_ns;
+    int            xattrWarned;
+    /* XSUM_cache_file */
+    char*          indexName;
+    void*          map;          /* index file, read-only */
+    size_t         mapSize;
+    const unsigned char* records;
+    size_t         nbRecords;
+    unsigned char* added;        /* new records, unsorted */
+    size_t         nbAdded;
+    size_t         addedCapacity;
+};
+
+static void XSUM_cache_writeLE32(unsigned char* p, XSUM_U32 v)
+{
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+static void XSUM_cache_writeLE64(unsigned char* p, XSUM_U64 v)
+{
+    XSUM_cache_writeLE32(p, (XSUM_U32)v);
+    XSUM_cache_writeLE32(p + 4, (XSUM_U32)(v >> 32));
+}
+
+static XSUM_U32 XSUM_cache_readLE32(const unsigned char* p)
+{
+    return (XSUM_U32)p[0] | ((XSUM_U32)p[1] << 8) | ((XSUM_U32)p[2] << 16) | ((XSUM_U32)p[3] << 24);
+}
+
+static XSUM_U64 XSUM_cache_readLE64(const unsigned char* p)
+{
+    return (XSUM_U64)XSUM_cache_readLE32(p) | ((XSUM_U64)XSUM_cache_readLE32(p + 4) << 32);
+}
+
+static void XSUM_cache_writeRecord(unsigned char* record, XSUM_U64 key,
+                                   const XSUM_fileStat* st, unsigned algoId,
+                                   const void* digest, size_t digestSize)
+{
+    memset(record, 0, XSUM_CACHE_RECORD_SIZE);
+    XSUM_cache_writeLE32(record +  0, XSUM_CACHE_VERSION);
+    XSUM_cache_writeLE32(record +  4, (XSUM_U32)algoId);
+    XSUM_cache_writeLE64(record +  8, key);
+    XSUM_cache_writeLE64(record + 16, st->size);
+    XSUM_cache_writeLE64(record + 24, st->mtime_ns);
+    XSUM_cache_writeLE64(record + 32, st->ctime_ns);
+    XSUM_cache_writeLE64(record + 40, st->inode);
+    XSUM_cache_writeLE64(record + 48, 0);
+    XSUM_cache_writeLE32(record + 56, (XSUM_U32)digestSize);
+    memcpy(record + 64, digest, digestSize);
+}
+
+/* Returns 1 if `record` is a valid digest for a file matching `st` */
+static int XSUM_cache_checkRecord(const unsigned char* record, const XSUM_fileStat* st,
+                                  unsigned algoId, size_t digestSize, int checkCtime)
+{
+    return XSUM_cache_readLE32(record +  0) == XSUM_CACHE_VERSION
+        && XSUM_cache_readLE32(record +  4) == algoId
+        && XSUM_cache_readLE64(record + 16) == st->size
+        && XSUM_cache_readLE64(record + 24) == st->mtime_ns
+        && (!checkCtime || XSUM_cache_readLE64(record + 32) == st->ctime_ns)
+        && XSUM_cache_readLE64(record + 40) == st->inode
+        && XSUM_cache_readLE64(record + 48) == 0
+        && XSUM_cache_readLE32(record + 56) == digestSize;
+}
+
+/* Orders records by (key, algorithm id) */
+static int XSUM_cache_compareRecords(const void* a, const void* b)
+{
+    const unsigned char* const ra = (const unsigned char*)a;
+    const unsigned char* const rb = (const unsigned char*)b;
+    XSUM_U64 const ka = XSUM_cache_readLE64(ra + 8);
+    XSUM_U64 const kb = XSUM_cache_readLE64(rb + 8);
+    XSUM_U32 const aa = XSUM_cache_readLE32(ra + 4);
+    XSUM_U32 const ab = XSUM_cache_readLE32(rb + 4);
+    if (ka != kb) return ka < kb ? -1 : 1;
+    if (aa != ab) return aa < ab ? -1 : 1;
+    return 0;
+}
+
+static XSUM_U64 XSUM_cache_key(const char* fileName)
+{
+    return XXH64(fileName, strlen(fileName), 0);
+}
+
+static void XSUM_cache_attrName(char* attrName, size_t size, const char* algoName)
+{
+    size_t const prefixLen = sizeof(XSUM_CACHE_ATTR_PREFIX) - 1;
+    size_t n = 0;
+    memcpy(attrName, XSUM_CACHE_ATTR_PREFIX, prefixLen);
+    /* lower case, as in user.xxhash.xxh128 */
+    while (algoName[n] && prefixLen + n + 1 < size) {
+        char const c = algoName[n];
+        attrName[prefixLen + n] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+        n++;
+    }
+    attrName[prefixLen + n] = '\0';
+}
+
+static int XSUM_cache_openIndex(XSUM_cache* cache)
+{
+    cache->map = XSUM_mapFile(cache->indexName, &cache->mapSize);
+    if (cache->map == NULL) {
+        if (errno == 0 || errno == ENOENT) return 0;   /* new index */
+        XSUM_log("xxhsum: %s: %s \n", cache->indexName, strerror(errno));
+        return 1;
+    }
+    {   const unsigned char* const header = (const unsigned char*)cache->map;
+        if ( cache->mapSize < XSUM_CACHE_HEADER_SIZE
+          || memcmp(header, XSUM_CACHE_MAGIC, 8) != 0
+          || XSUM_cache_readLE32(header + 8) != XSUM_CACHE_VERSION
+          || XSUM_cache_readLE32(header + 12) != XSUM_CACHE_RECORD_SIZE
+          || (cache->mapSize - XSUM_CACHE_HEADER_SIZE) % XSUM_CACHE_RECORD_SIZE != 0 ) {
+            XSUM_log("xxhsum: %s: Not a valid cache index, it will be replaced \n", cache->indexName);
+            XSUM_unmapFile(cache->map, cache->mapSize);
+            cache->map = NULL;
+            cache->mapSize = 0;
+            return 0;
+        }
+        cache->records = header + XSUM_CACHE_HEADER_SIZE;
+        cache->nbRecords = (cache->mapSize - XSUM_CACHE_HEADER_SIZE) / XSUM_CACHE_RECORD_SIZE;
+    }
+    return 0;
+}
+
+XSUM_API XSUM_cache* XSUM_cache_create(const char* spec)
+{
+    XSUM_cache* const cache = (XSUM_cache*)calloc(1, sizeof(XSUM_cache));
+    if (cache == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        return NULL;
+    }
+    cache->startTime_ns = (XSUM_U64)time(NULL) * 1000000000ULL;
+    if (!strcmp(spec, "xattr")) {
+        cache->mode = XSUM_cache_xattr;
+        return cache;
+    }
+    if (!strncmp(spec, "file:", 5) && spec[5] != '\0') {
+        size_t const nameSize = strlen(spec + 5) + 1;
+        cache->mode = XSUM_cache_file;
+        cache->indexName = (char*)malloc(nameSize);
+        if (cache->indexName == NULL) {
+            XSUM_log("Error: Out of memory.\n");
+            free(cache);
+            return NULL;
+        }
+        memcpy(cache->indexName, spec + 5, nameSize);
+        if (XSUM_cache_openIndex(cache)) {
+            free(cache->indexName);
+            free(cache);
+            return NULL;
+        }
+        return cache;
+    }
+    XSUM_log("Error: --cache: expected 'xattr' or 'file:<path>', got '%s' \n", spec);
+    free(cache);
+    return NULL;
+}
+
+XSUM_API int XSUM_cache_lookup(const XSUM_cache* cache,
+                               const char* fileName, const XSUM_fileStat* st,
+                               unsigned algoId, const char* algoName,
+                               void* digest, size_t digestSize)
+{
+    unsigned char record[XSUM_CACHE_RECORD_SIZE];
+    const unsigned char* found = NULL;
+    int checkCtime = 1;
+    if (digestSize > XSUM_CACHE_DIGEST_MAX) return 0;
+
+    switch (cache->mode)
+    {
+    case XSUM_cache_xattr:
+        {   char attrName[64];
+            XSUM_cache_attrName(attrName, sizeof(attrName), algoName);
+            if (XSUM_getXattr(fileName, attrName, record, sizeof(record)) != (long)sizeof(record))
+                return 0;
+            found = record;
+            checkCtime = 0;
+            break;
+        }
+    case XSUM_cache_file:
+    default:
+        {   size_t low = 0, high = cache->nbRecords;
+            XSUM_cache_writeRecord(record, XSUM_cache_key(fileName), st, algoId, digest, 0);
+            while (low < high) {
+                size_t const mid = low + (high - low) / 2;
+                const unsigned char* const r = cache->records + mid * XSUM_CACHE_RECORD_SIZE;
+                int const cmp = XSUM_cache_compareRecords(r, record);
+                if (cmp == 0) { found = r; break; }
+                if (cmp < 0) low = mid + 1; else high = mid;
+            }
+            if (found == NULL) return 0;
+            break;
+    }   }
+
+    if (!XSUM_cache_checkRecord(found, st, algoId, digestSize, checkCtime)) return 0;
+    memcpy(digest, found + 64, digestSize);
+    return 1;
+}
+
+XSUM_API void XSUM_cache_store(XSUM_cache* cache,
+                               const char* fileName, const XSUM_fileStat* st,
+                               unsigned algoId, const char* algoName,
+                               const void* digest, size_t digestSize)
+{
+    if (digestSize > XSUM_CACHE_DIGEST_MAX) return;
+    /* racy: a change within the same timestamp granularity could go unnoticed */
+    if (st->mtime_ns + 1000000000ULL > cache->startTime_ns) return;
+
+    switch (cache->mode)
+    {
+    case XSUM_cache_xattr:
+        {   unsigned char record[XSUM_CACHE_RECORD_SIZE];
+            char attrName[64];
+            XSUM_cache_attrName(attrName, sizeof(attrName), algoName);
+            XSUM_cache_writeRecord(record, 0, st, algoId, digest, digestSize);
+            /* best effort: read-only files are simply not cached */
+            if (XSUM_setXattr(fileName, attrName, record, sizeof(record)) && !cache->xattrWarned) {
+                if (errno != EACCES && errno != EPERM) {
+                    XSUM_log("xxhsum: %s: Could not store cache attribute: %s \n", fileName, strerror(errno));
+                    cache->xattrWarned = 1;
+            }   }
+            break;
+        }
+    case XSUM_cache_file:
+    default:
+        if (cache->nbAdded == cache->addedCapacity) {
+            size_t const newCapacity = cache->addedCapacity ? cache->addedCapacity * 2 : 256;
+            unsigned char* const newAdded = (unsigned char*)realloc(cache->added, newCapacity * XSUM_CACHE_RECORD_SIZE);
+            if (newAdded == NULL) return;   /* just not cached */
+            cache->added = newAdded;
+            cache->addedCapacity = newCapacity;
+        }
+        XSUM_cache_writeRecord(cache->added + cache->nbAdded * XSUM_CACHE_RECORD_SIZE,
+                               XSUM_cache_key(fileName), st, algoId, digest, digestSize);
+        cache->nbAdded++;
+        break;
+    }
+}
+
+/* Merges new records into the existing index, new records replacing old ones */
+static int XSUM_cache_writeIndex(XSUM_cache* cache)
+{
+    size_t const tmpNameSize = strlen(cache->indexName) + 5;
+    char* const tmpName = (char*)malloc(tmpNameSize);
+    FILE* f;
+    size_t i = 0, j = 0;
+    int error = 0;
+    unsigned char header[XSUM_CACHE_HEADER_SIZE];
+
+    if (tmpName == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        return 1;
+    }
+    memcpy(tmpName, cache->indexName, tmpNameSize - 5);
+    memcpy(tmpName + tmpNameSize - 5, ".tmp", 5);
+    f = XSUM_fopen(tmpName, "wb");
+    if (f == NULL) {
+        XSUM_log("xxhsum: %s: %s \n", tmpName, strerror(errno));
+        free(tmpName);
+        return 1;
+    }
+
+    qsort(cache->added, cache->nbAdded, XSUM_CACHE_RECORD_SIZE, XSUM_cache_compareRecords);
+    memcpy(header, XSUM_CACHE_MAGIC, 8);
+    XSUM_cache_writeLE32(header + 8, XSUM_CACHE_VERSION);
+    XSUM_cache_writeLE32(header + 12, XSUM_CACHE_RECORD_SIZE);
+    error |= fwrite(header, sizeof(header), 1, f) != 1;
+    while (i < cache->nbRecords || j < cache->nbAdded) {
+        const unsigned char* const oldR = cache->records + i * XSUM_CACHE_RECORD_SIZE;
+        const unsigned char* const newR = cache->added + j * XSUM_CACHE_RECORD_SIZE;
+        const unsigned char* r;
+        int const cmp = (i == cache->nbRecords) ? 1
+                      : (j == cache->nbAdded) ? -1
+                      : XSUM_cache_compareRecords(oldR, newR);
+        if (cmp < 0) {
+            r = oldR; i++;
+        } else {
+            r = newR; j++;
+            if (cmp == 0) i++;
+            /* same file stored twice during this run: keep one */
+            while (j < cache->nbAdded && !XSUM_cache_compareRecords(r, r + XSUM_CACHE_RECORD_SIZE)) {
+                r += XSUM_CACHE_RECORD_SIZE; j++;
+        }   }
+        error |= fwrite(r, XSUM_CACHE_RECORD_SIZE, 1, f) != 1;
+    }
+    error |= fclose(f) != 0;
+
+    XSUM_unmapFile(cache->map, cache->mapSize);
+    cache->map = NULL;
+    cache->records = NULL;
+    cache->nbRecords = 0;
+#if defined(_WIN32)
+    if (!error) remove(cache->indexName);   /* rename() doesn't replace files */
+#endif
+    if (error || rename(tmpName, cache->indexName)) {
+        XSUM_log("xxhsum: %s: Could not write cache index: %s \n", cache->indexName, strerror(errno));
+        remove(tmpName);
+        error = 1;
+    }
+    free(tmpName);
+    return error;
+}
+
+XSUM_API int XSUM_cache_free(XSUM_cache* cache)
+{
+    int result = 0;
+    if (cache == NULL) return 0;
+    if (cache->mode == XSUM_cache_file && cache->nbAdded > 0)
+        result = XSUM_cache_writeIndex(cache);
+    XSUM_unmapFile(cache->map, cache->mapSize);
+    free(cache->added);
+    free(cache->indexName);
+    free(cache);
+    return result;
+}
@@ -0,0 +1,97 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Cache of file digests, for --cache.
+ *
+ * A digest is trusted as long as the metadata recorded with it (size,
+ * modification time, inode, and change time when possible) still matches
+ * the file, so unchanged files don't have to be read again.
+ *
+ * Two backends are available:
+ * - "xattr": the record is stored in a `user.xxhash.<algo>` extended
+ *   attribute of each file. Writing the attribute updates the file's change
+ *   time, so the change time cannot be part of the check in this mode.
+ * - "file:<path>": records are stored in a single index file, sorted by
+ *   the hash of the file name, so lookups are binary searches directly into
+ *   the memory-mapped index. New records are merged when the cache is freed.
+ *
+ * A file modified within the second preceding the start of the run is never
+ * stored: a later modification could leave its metadata unchanged.
+ */
+
+#ifndef XSUM_CACHE_H
+#define XSUM_CACHE_H
+
+#include "xsum_config.h"
+#include "xsum_os_specific.h"   /* XSUM_fileStat */
+#include <stddef.h>             /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct XSUM_cache_s XSUM_cache;
+
+/* largest digest which can be stored, in bytes */
+#define XSUM_CACHE_DIGEST_MAX 16
+
+/*
+ * Opens a cache from its command line description: "xattr" or "file:<path>".
+ * Returns NULL after displaying an error message on failure.
+ */
+XSUM_API XSUM_cache* XSUM_cache_create(const char* spec);
+
+/*
+ * Looks for a digest of `fileName` by algorithm `algoId` (named `algoName`),
+ * which is still valid for the current metadata `st` of the file.
+ * On success, copies `digestSize` bytes to `digest` and returns 1.
+ * Returns 0 otherwise. Can be called concurrently from multiple threads.
+ */
+XSUM_API int XSUM_cache_lookup(const XSUM_cache* cache,
+                               const char* fileName, const XSUM_fileStat* st,
+                               unsigned algoId, const char* algoName,
+                               void* digest, size_t digestSize);
+
+/*
+ * Records the digest of `fileName`, computed from a file matching `st`.
+ * Calls must be serialized by the caller.
+ */
+XSUM_API void XSUM_cache_store(XSUM_cache* cache,
+                               const char* fileName, const XSUM_fileStat* st,
+                               unsigned algoId, const char* algoName,
+                               const void* digest, size_t digestSize);
+
+/*
+ * Writes back the index file, if any, then releases the cache.
+ * Returns 0 on success, 1 after displaying an error message. Accepts NULL.
+ */
+XSUM_API int XSUM_cache_free(XSUM_cache* cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_CACHE_H */
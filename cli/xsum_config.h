@@ -77,6 +77,9 @@
 #      ifndef _POSIX_C_SOURCE
 #        define _POSIX_C_SOURCE 200112L  /* use feature test macro */
 #      endif
+#      ifndef _DEFAULT_SOURCE
+#        define _DEFAULT_SOURCE  /* struct dirent::d_type */
+#      endif
 #    endif
 #    include <unistd.h>  /* declares _POSIX_VERSION */
 #    if defined(_POSIX_VERSION)  /* POSIX compliant */
@@ -181,6 +184,21 @@
 #  define XSUM_NO_TESTS 0
 #endif
 
+/*
+ * Whether xxhsum can spread work over several threads (-T#).
+ * Uses pthreads on POSIX systems, and native threads on Windows (Vista+).
+ * Define XSUM_MULTITHREAD=0 to build a strictly single-threaded xxhsum.
+ */
+#ifndef XSUM_MULTITHREAD
+#  if defined(__EMSCRIPTEN__) || defined(__DJGPP__)
+#    define XSUM_MULTITHREAD 0
+#  elif defined(_WIN32) || (XSUM_PLATFORM_POSIX_VERSION >= 200112L)
+#    define XSUM_MULTITHREAD 1
+#  else
+#    define XSUM_MULTITHREAD 0
+#  endif
+#endif
+
 /* ***************************
  * Basic types
  * ***************************/
@@ -0,0 +1,341 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_index.h"
+#include "xsum_os_specific.h"   /* XSUM_fopen, XSUM_mapFile, XSUM_getFileType */
+#include "xsum_output.h"        /* XSUM_log */
+#include <stdlib.h>             /* malloc, realloc, free, qsort */
+#include <string.h>             /* memcpy, memcmp, memset, strlen, strcmp, strerror */
+#include <stdio.h>              /* FILE, rename, remove */
+#include <errno.h>              /* errno */
+
+/*
+ * All numbers are stored in little endian order.
+ *
+ * Header:
+ *   offset  size  field
+ *        0     8  XSUM_INDEX_MAGIC
+ *        8     4  format version (XSUM_INDEX_VERSION)
+ *       12     4  digest size
+ *       16     8  number of entries
+ *       24     8  algorithm name, zero padded ("XXH128")
+ *
+ * followed by one record per entry, sorted by path (as strcmp()):
+ *        0     8  offset of the path, from the start of the file
+ *        8     4  length of the path
+ *       12     *  digest, canonical representation
+ *
+ * followed by the table of paths, each one terminated by a '\0'.
+ */
+#define XSUM_INDEX_MAGIC       "XXHINDEX"
+#define XSUM_INDEX_VERSION     1
+#define XSUM_INDEX_HEADER_SIZE 32
+#define XSUM_INDEX_RECORD_HEAD 12
+
+static void XSUM_index_writeLE32(unsigned char* p, XSUM_U32 v)
+{
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+static void XSUM_index_writeLE64(unsigned char* p, XSUM_U64 v)
+{
+    XSUM_index_writeLE32(p, (XSUM_U32)v);
+    XSUM_index_writeLE32(p + 4, (XSUM_U32)(v >> 32));
+}
+
+static XSUM_U32 XSUM_index_readLE32(const unsigned char* p)
+{
+    return (XSUM_U32)p[0] | ((XSUM_U32)p[1] << 8) | ((XSUM_U32)p[2] << 16) | ((XSUM_U32)p[3] << 24);
+}
+
+static XSUM_U64 XSUM_index_readLE64(const unsigned char* p)
+{
+    return (XSUM_U64)XSUM_index_readLE32(p) | ((XSUM_U64)XSUM_index_readLE32(p + 4) << 32);
+}
+
+
+/* ********************************************************
+*  Writing
+**********************************************************/
+
+typedef struct {
+    char*         path;
+    size_t        order;    /* the last one added wins */
+    unsigned char digest[XSUM_INDEX_DIGEST_MAX];
+} XSUM_indexEntry;
+
+struct XSUM_indexWriter_s {
+    char             algoName[XSUM_INDEX_NAME_MAX + 1];
+    size_t           digestSize;
+    XSUM_indexEntry* entries;
+    size_t           nbEntries;
+    size_t           capacity;
+};
+
+XSUM_API XSUM_indexWriter* XSUM_indexWriter_create(const char* algoName, size_t digestSize)
+{
+    XSUM_indexWriter* writer;
+    if (strlen(algoName) > XSUM_INDEX_NAME_MAX || digestSize == 0 || digestSize > XSUM_INDEX_DIGEST_MAX) {
+        XSUM_log("Error: %s digests can't be stored in an index \n", algoName);
+        return NULL;
+    }
+    writer = (XSUM_indexWriter*)calloc(1, sizeof(XSUM_indexWriter));
+    if (writer == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        return NULL;
+    }
+    memcpy(writer->algoName, algoName, strlen(algoName));
+    writer->digestSize = digestSize;
+    return writer;
+}
+
+XSUM_API int XSUM_indexWriter_add(XSUM_indexWriter* writer, const char* path, const void* digest)
+{
+    size_t const pathSize = strlen(path) + 1;
+    XSUM_indexEntry* entry;
+    if (writer->nbEntries == writer->capacity) {
+        size_t const newCapacity = writer->capacity ? writer->capacity * 2 : 256;
+        XSUM_indexEntry* const newEntries = (XSUM_indexEntry*)realloc(writer->entries, newCapacity * sizeof(XSUM_indexEntry));
+        if (newEntries == NULL) return 1;
+        writer->entries = newEntries;
+        writer->capacity = newCapacity;
+    }
+    entry = &writer->entries[writer->nbEntries];
+    entry->path = (char*)malloc(pathSize);
+    if (entry->path == NULL) return 1;
+    memcpy(entry->path, path, pathSize);
+    entry->order = writer->nbEntries;
+    memcpy(entry->digest, digest, writer->digestSize);
+    writer->nbEntries++;
+    return 0;
+}
+
+/* Orders entries by (path, order) */
+static int XSUM_index_compareEntries(const void* a, const void* b)
+{
+    const XSUM_indexEntry* const ea = (const XSUM_indexEntry*)a;
+    const XSUM_indexEntry* const eb = (const XSUM_indexEntry*)b;
+    int const cmp = strcmp(ea->path, eb->path);
+    if (cmp != 0) return cmp;
+    return (ea->order < eb->order) ? -1 : (ea->order > eb->order);
+}
+
+XSUM_API int XSUM_indexWriter_write(XSUM_indexWriter* writer, const char* fileName)
+{
+    size_t const recordSize = XSUM_INDEX_RECORD_HEAD + writer->digestSize;
+    size_t const tmpNameSize = strlen(fileName) + 5;
+    char* const tmpName = (char*)malloc(tmpNameSize);
+    unsigned char header[XSUM_INDEX_HEADER_SIZE];
+    unsigned char record[XSUM_INDEX_RECORD_HEAD + XSUM_INDEX_DIGEST_MAX];
+    XSUM_U64 pathOffset;
+    size_t n, nbEntries = 0;
+    int error = 0;
+    FILE* f;
+
+    if (tmpName == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        return 1;
+    }
+    memcpy(tmpName, fileName, tmpNameSize - 5);
+    memcpy(tmpName + tmpNameSize - 5, ".tmp", 5);
+    f = XSUM_fopen(tmpName, "wb");
+    if (f == NULL) {
+        XSUM_log("xxhsum: %s: %s \n", tmpName, strerror(errno));
+        free(tmpName);
+        return 1;
+    }
+
+    /* sort, then keep only the last entry of each path */
+    if (writer->nbEntries > 1)
+        qsort(writer->entries, writer->nbEntries, sizeof(XSUM_indexEntry), XSUM_index_compareEntries);
+    for (n = 0; n < writer->nbEntries; n++) {
+        if (n + 1 < writer->nbEntries && !strcmp(writer->entries[n].path, writer->entries[n+1].path)) {
+            free(writer->entries[n].path);
+            continue;
+        }
+        writer->entries[nbEntries++] = writer->entries[n];
+    }
+    writer->nbEntries = nbEntries;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, XSUM_INDEX_MAGIC, 8);
+    XSUM_index_writeLE32(header + 8, XSUM_INDEX_VERSION);
+    XSUM_index_writeLE32(header + 12, (XSUM_U32)writer->digestSize);
+    XSUM_index_writeLE64(header + 16, (XSUM_U64)nbEntries);
+    memcpy(header + 24, writer->algoName, strlen(writer->algoName));
+    error |= fwrite(header, sizeof(header), 1, f) != 1;
+
+    pathOffset = XSUM_INDEX_HEADER_SIZE + (XSUM_U64)nbEntries * recordSize;
+    for (n = 0; n < nbEntries; n++) {
+        size_t const pathLength = strlen(writer->entries[n].path);
+        XSUM_index_writeLE64(record, pathOffset);
+        XSUM_index_writeLE32(record + 8, (XSUM_U32)pathLength);
+        memcpy(record + XSUM_INDEX_RECORD_HEAD, writer->entries[n].digest, writer->digestSize);
+        error |= fwrite(record, recordSize, 1, f) != 1;
+        pathOffset += pathLength + 1;
+    }
+    for (n = 0; n < nbEntries; n++) {
+        const char* const path = writer->entries[n].path;
+        error |= fwrite(path, strlen(path) + 1, 1, f) != 1;
+    }
+    error |= fclose(f) != 0;
+
+#if defined(_WIN32)
+    if (!error) remove(fileName);   /* rename() doesn't replace files */
+#endif
+    if (error || rename(tmpName, fileName)) {
+        XSUM_log("xxhsum: %s: Could not write index: %s \n", fileName, strerror(errno));
+        remove(tmpName);
+        error = 1;
+    }
+    free(tmpName);
+    return error;
+}
+
+XSUM_API void XSUM_indexWriter_free(XSUM_indexWriter* writer)
+{
+    size_t n;
+    if (writer == NULL) return;
+    for (n = 0; n < writer->nbEntries; n++)
+        free(writer->entries[n].path);
+    free(writer->entries);
+    free(writer);
+}
+
+
+/* ********************************************************
+*  Reading
+**********************************************************/
+
+struct XSUM_index_s {
+    void*                map;
+    size_t               mapSize;
+    char                 algoName[XSUM_INDEX_NAME_MAX + 1];
+    size_t               digestSize;
+    size_t               recordSize;
+    size_t               nbEntries;
+    const unsigned char* records;
+};
+
+XSUM_API int XSUM_index_open(const char* fileName, XSUM_index** index)
+{
+    XSUM_index* idx;
+    *index = NULL;
+
+    /* pipes can't be read twice, nor mapped: they are parsed as text */
+    if (XSUM_getFileType(fileName) != XSUM_fileType_regular) return 0;
+
+    /* only the start is read to tell text checksum files apart */
+    {   FILE* const f = XSUM_fopen(fileName, "rb");
+        char magic[8];
+        int isIndex;
+        if (f == NULL) return 0;
+        isIndex = fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, XSUM_INDEX_MAGIC, 8);
+        fclose(f);
+        if (!isIndex) return 0;
+    }
+
+    idx = (XSUM_index*)calloc(1, sizeof(XSUM_index));
+    if (idx == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        return -1;
+    }
+    idx->map = XSUM_mapFile(fileName, &idx->mapSize);
+    if (idx->map == NULL) {
+        XSUM_log("xxhsum: %s: %s \n", fileName, strerror(errno));
+        free(idx);
+        return -1;
+    }
+    {   const unsigned char* const header = (const unsigned char*)idx->map;
+        XSUM_U64 nbEntries = 0;
+        if (idx->mapSize >= XSUM_INDEX_HEADER_SIZE) {
+            idx->digestSize = XSUM_index_readLE32(header + 12);
+            idx->recordSize = XSUM_INDEX_RECORD_HEAD + idx->digestSize;
+            nbEntries = XSUM_index_readLE64(header + 16);
+            memcpy(idx->algoName, header + 24, XSUM_INDEX_NAME_MAX);
+        }
+        if ( idx->mapSize < XSUM_INDEX_HEADER_SIZE
+          || XSUM_index_readLE32(header + 8) != XSUM_INDEX_VERSION
+          || idx->digestSize == 0 || idx->digestSize > XSUM_INDEX_DIGEST_MAX
+          || header[24 + XSUM_INDEX_NAME_MAX] != 0
+          || nbEntries > (idx->mapSize - XSUM_INDEX_HEADER_SIZE) / idx->recordSize ) {
+            XSUM_log("xxhsum: %s: Not a valid index \n", fileName);
+            XSUM_index_close(idx);
+            return -1;
+        }
+        idx->nbEntries = (size_t)nbEntries;
+        idx->records = header + XSUM_INDEX_HEADER_SIZE;
+    }
+    *index = idx;
+    return 1;
+}
+
+XSUM_API const char* XSUM_index_algoName(const XSUM_index* index) { return index->algoName; }
+XSUM_API size_t XSUM_index_digestSize(const XSUM_index* index) { return index->digestSize; }
+XSUM_API size_t XSUM_index_nbEntries(const XSUM_index* index) { return index->nbEntries; }
+
+XSUM_API const unsigned char* XSUM_index_entry(const XSUM_index* index, size_t n, const char** path)
+{
+    const char* const map = (const char*)index->map;
+    size_t const tableStart = XSUM_INDEX_HEADER_SIZE + index->nbEntries * index->recordSize;
+    const unsigned char* record;
+    XSUM_U64 offset;
+    XSUM_U32 length;
+    *path = NULL;
+    if (n >= index->nbEntries) return NULL;
+    record = index->records + n * index->recordSize;
+    offset = XSUM_index_readLE64(record);
+    length = XSUM_index_readLE32(record + 8);
+    /* entries are only checked when used, so that lookups stay cheap */
+    if ( offset < tableStart || offset >= index->mapSize
+      || length >= index->mapSize - offset
+      || map[offset + length] != '\0' )
+        return NULL;
+    *path = map + offset;
+    return record + XSUM_INDEX_RECORD_HEAD;
+}
+
+XSUM_API size_t XSUM_index_find(const XSUM_index* index, const char* path)
+{
+    size_t low = 0, high = index->nbEntries;
+    while (low < high) {
+        size_t const mid = low + (high - low) / 2;
+        const char* midPath;
+        int cmp;
+        if (XSUM_index_entry(index, mid, &midPath) == NULL) return XSUM_INDEX_NOT_FOUND;
+        cmp = strcmp(midPath, path);
+        if (cmp == 0) return mid;
+        if (cmp < 0) low = mid + 1; else high = mid;
+    }
+    return XSUM_INDEX_NOT_FOUND;
+}
+
+XSUM_API void XSUM_index_close(XSUM_index* index)
+{
+    if (index == NULL) return;
+    XSUM_unmapFile(index->map, index->mapSize);
+    free(index);
+}
@@ -0,0 +1,117 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Binary checksum index, for --index, --convert and `--check --only`.
+ *
+ * An index stores the digests of one algorithm as fixed-size records sorted
+ * by path, followed by the table of paths. It is memory-mapped rather than
+ * parsed, so looking up a few paths only reads the pages visited by a
+ * binary search, whatever the number of entries.
+ */
+
+#ifndef XSUM_INDEX_H
+#define XSUM_INDEX_H
+
+#include "xsum_config.h"
+#include <stddef.h>   /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* longest algorithm name which can be stored, and largest digest, in bytes */
+#define XSUM_INDEX_NAME_MAX   7
+#define XSUM_INDEX_DIGEST_MAX 16
+
+/* returned by XSUM_index_find() for paths which are not listed */
+#define XSUM_INDEX_NOT_FOUND  ((size_t)-1)
+
+
+/*
+ * Writing
+ */
+typedef struct XSUM_indexWriter_s XSUM_indexWriter;
+
+/*
+ * Starts an index of `digestSize` bytes digests by algorithm `algoName`.
+ * Returns NULL after displaying an error message on failure.
+ */
+XSUM_API XSUM_indexWriter* XSUM_indexWriter_create(const char* algoName, size_t digestSize);
+
+/*
+ * Adds the canonical `digest` of `path`. If the same path is added again,
+ * the last digest is kept. Returns 0 on success, 1 on allocation failure.
+ */
+XSUM_API int XSUM_indexWriter_add(XSUM_indexWriter* writer, const char* path, const void* digest);
+
+/*
+ * Sorts the entries and writes them to `fileName`, replacing it atomically.
+ * Returns 0 on success, 1 after displaying an error message.
+ */
+XSUM_API int XSUM_indexWriter_write(XSUM_indexWriter* writer, const char* fileName);
+
+/* Accepts NULL */
+XSUM_API void XSUM_indexWriter_free(XSUM_indexWriter* writer);
+
+
+/*
+ * Reading
+ */
+typedef struct XSUM_index_s XSUM_index;
+
+/*
+ * Opens `fileName` if it is an index.
+ * Returns 1 and sets `*index` on success.
+ * Returns 0 if the file can't be read, isn't a regular file (a pipe is only
+ * read once, by the text parser), or doesn't start like an index:
+ * it is then presumably a text checksum file.
+ * Returns -1 after displaying an error message if the index is damaged.
+ */
+XSUM_API int XSUM_index_open(const char* fileName, XSUM_index** index);
+
+XSUM_API const char* XSUM_index_algoName(const XSUM_index* index);
+XSUM_API size_t XSUM_index_digestSize(const XSUM_index* index);
+XSUM_API size_t XSUM_index_nbEntries(const XSUM_index* index);
+
+/*
+ * Returns the digest of entry `n` and sets `*path`,
+ * or returns NULL if this entry is damaged.
+ */
+XSUM_API const unsigned char* XSUM_index_entry(const XSUM_index* index, size_t n, const char** path);
+
+/*
+ * Returns the number of the entry of `path`, or XSUM_INDEX_NOT_FOUND.
+ */
+XSUM_API size_t XSUM_index_find(const XSUM_index* index, const char* path);
+
+/* Accepts NULL */
+XSUM_API void XSUM_index_close(XSUM_index* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_INDEX_H */
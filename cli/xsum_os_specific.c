@@ -25,6 +25,11 @@
 
 #include "xsum_os_specific.h"  /* XSUM_API */
 #include <sys/stat.h>   /* stat() / _stat64() */
+#include <stdlib.h>     /* malloc, calloc, free */
+#include <string.h>     /* memcpy, strlen */
+#include <errno.h>      /* errno */
+#include <limits.h>     /* LONG_MAX, INT_MAX */
+#include <time.h>       /* clock_gettime, clock, time */
 
 /*
  * This file contains all of the ugly boilerplate to make xxhsum work across
@@ -521,3 +526,950 @@ XSUM_API XSUM_U64 XSUM_getFileSize(const char* filename)
     if (r || !S_ISREG(statbuf.st_mode)) return 0;   /* No good... */
     return (XSUM_U64)statbuf.st_size;
 }
+
+/*
+ * Returns the type of the file at filename, following symbolic links.
+ */
+XSUM_API XSUM_fileType XSUM_getFileType(const char* filename)
+{
+    XSUM_stat_t statbuf;
+    if (XSUM_stat(filename, &statbuf)) return XSUM_fileType_unknown;
+#ifdef _MSC_VER
+    if (statbuf.st_mode & _S_IFDIR) return XSUM_fileType_directory;
+#else
+    if (S_ISDIR(statbuf.st_mode)) return XSUM_fileType_directory;
+#endif
+    if (S_ISREG(statbuf.st_mode)) return XSUM_fileType_regular;
+    return XSUM_fileType_other;
+}
+
+/*
+ * Same as XSUM_getFileType(), without following symbolic links.
+ */
+XSUM_API XSUM_fileType XSUM_getLinkType(const char* filename)
+{
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0)
+    XSUM_stat_t statbuf;
+    if (lstat(filename, &statbuf)) return XSUM_fileType_unknown;
+    if (S_ISLNK(statbuf.st_mode)) return XSUM_fileType_symlink;
+    if (S_ISDIR(statbuf.st_mode)) return XSUM_fileType_directory;
+    if (S_ISREG(statbuf.st_mode)) return XSUM_fileType_regular;
+    return XSUM_fileType_other;
+#else
+    return XSUM_getFileType(filename);
+#endif
+}
+
+
+/*****************************************************************************
+ *                           Directory iteration
+ *****************************************************************************/
+#if XSUM_WIN32_USE_WCHAR
+
+struct XSUM_dir_s {
+    HANDLE handle;
+    WIN32_FIND_DATAW data;
+    int pending;    /* data holds an entry not yet returned */
+    char* name;
+};
+
+XSUM_API XSUM_dir* XSUM_openDir(const char* dirname)
+{
+    XSUM_dir* dir;
+    int len;
+    wchar_t* const wide_dirname = XSUM_widenString(dirname, &len);
+    wchar_t* pattern;
+    if (wide_dirname == NULL) return NULL;
+    /* len includes the terminating NUL: room for "\\*" */
+    pattern = (wchar_t*)malloc(((size_t)len + 2) * sizeof(wchar_t));
+    dir = (XSUM_dir*)calloc(1, sizeof(XSUM_dir));
+    if (pattern == NULL || dir == NULL) {
+        free(pattern); free(dir); free(wide_dirname);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(pattern, wide_dirname, (size_t)(len - 1) * sizeof(wchar_t));
+    pattern[len - 1] = L'\\';
+    pattern[len]     = L'*';
+    pattern[len + 1] = L'\0';
+    dir->handle = FindFirstFileW(pattern, &dir->data);
+    free(pattern);
+    free(wide_dirname);
+    if (dir->handle == INVALID_HANDLE_VALUE) {
+        free(dir);
+        errno = ENOENT;
+        return NULL;
+    }
+    dir->pending = 1;
+    return dir;
+}
+
+XSUM_API const char* XSUM_readDir(XSUM_dir* dir, XSUM_fileType* type)
+{
+    for (;;) {
+        const wchar_t* wname;
+        if (!dir->pending && !FindNextFileW(dir->handle, &dir->data)) return NULL;
+        dir->pending = 0;
+        wname = dir->data.cFileName;
+        if (wname[0] == L'.' && (wname[1] == L'\0' || (wname[1] == L'.' && wname[2] == L'\0')))
+            continue;
+        free(dir->name);
+        dir->name = XSUM_narrowString(wname, NULL);
+        if (dir->name == NULL) continue;
+        if (dir->data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+            *type = XSUM_fileType_symlink;
+        } else if (dir->data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            *type = XSUM_fileType_directory;
+        } else {
+            *type = XSUM_fileType_regular;
+        }
+        return dir->name;
+    }
+}
+
+XSUM_API void XSUM_closeDir(XSUM_dir* dir)
+{
+    if (dir == NULL) return;
+    FindClose(dir->handle);
+    free(dir->name);
+    free(dir);
+}
+
+#elif XSUM_PLATFORM_POSIX_VERSION > 0
+#  include <dirent.h>   /* opendir, readdir, closedir */
+
+struct XSUM_dir_s {
+    DIR* dir;
+};
+
+XSUM_API XSUM_dir* XSUM_openDir(const char* dirname)
+{
+    XSUM_dir* const dir = (XSUM_dir*)malloc(sizeof(XSUM_dir));
+    if (dir == NULL) return NULL;
+    dir->dir = opendir(dirname);
+    if (dir->dir == NULL) {
+        free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+XSUM_API const char* XSUM_readDir(XSUM_dir* dir, XSUM_fileType* type)
+{
+    struct dirent* entry;
+    while ((entry = readdir(dir->dir)) != NULL) {
+        const char* const name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+        *type = XSUM_fileType_unknown;
+#if defined(DT_REG) && defined(DT_DIR) && defined(DT_LNK) && defined(DT_UNKNOWN)
+        /* d_type spares one stat() per entry on most file systems */
+        switch (entry->d_type) {
+        case DT_REG: *type = XSUM_fileType_regular; break;
+        case DT_DIR: *type = XSUM_fileType_directory; break;
+        case DT_LNK: *type = XSUM_fileType_symlink; break;
+        case DT_UNKNOWN: break;
+        default: *type = XSUM_fileType_other; break;
+        }
+#endif
+        return name;
+    }
+    return NULL;
+}
+
+XSUM_API void XSUM_closeDir(XSUM_dir* dir)
+{
+    if (dir == NULL) return;
+    closedir(dir->dir);
+    free(dir);
+}
+
+#else  /* no known directory API */
+
+XSUM_API XSUM_dir* XSUM_openDir(const char* dirname)
+{
+    (void)dirname;
+    errno = ENOSYS;
+    return NULL;
+}
+
+XSUM_API const char* XSUM_readDir(XSUM_dir* dir, XSUM_fileType* type)
+{
+    (void)dir; (void)type;
+    return NULL;
+}
+
+XSUM_API void XSUM_closeDir(XSUM_dir* dir)
+{
+    (void)dir;
+}
+
+#endif
+
+/*
+ * Returns a newly allocated "dirName/name", adding a separator only when
+ * dirName doesn't already end with one, or NULL on allocation failure.
+ */
+XSUM_API char* XSUM_pathJoin(const char* dirName, const char* name)
+{
+    size_t const dirLen = strlen(dirName);
+    size_t const nameLen = strlen(name);
+    int const needsSep = (dirLen > 0) && (dirName[dirLen-1] != '/')
+#if defined(_WIN32)
+                      && (dirName[dirLen-1] != '\\')
+#endif
+                      ;
+    char* const path = (char*)malloc(dirLen + (size_t)needsSep + nameLen + 1);
+    if (path == NULL) return NULL;
+    memcpy(path, dirName, dirLen);
+    if (needsSep) path[dirLen] = '/';
+    memcpy(path + dirLen + needsSep, name, nameLen + 1);
+    return path;
+}
+
+
+/*
+ * Returns the number of online logical cores, or 1 if unknown.
+ */
+XSUM_API int XSUM_getNbCores(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return sysinfo.dwNumberOfProcessors > 0 ? (int)sysinfo.dwNumberOfProcessors : 1;
+#elif (XSUM_PLATFORM_POSIX_VERSION > 0) && defined(_SC_NPROCESSORS_ONLN)
+    long const nbCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return nbCores > 0 ? (int)nbCores : 1;
+#else
+    return 1;
+#endif
+}
+
+
+/*
+ * CPU affinity
+ */
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#  include <sys/syscall.h>   /* SYS_sched_setaffinity */
+#  include <unistd.h>        /* syscall */
+#endif
+
+XSUM_API int XSUM_pinThread(int cpu)
+{
+#if defined(_WIN32)
+    if (cpu < 0 || cpu >= (int)(8 * sizeof(DWORD_PTR))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+#elif defined(__linux__) && !defined(__EMSCRIPTEN__) && defined(SYS_sched_setaffinity)
+    /* sched_setaffinity() and cpu_set_t are only declared by glibc with _GNU_SOURCE */
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))];
+    size_t const bitsPerWord = 8 * sizeof(unsigned long);
+    if (cpu < 0 || (size_t)cpu >= 8 * sizeof(mask)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(mask, 0, sizeof(mask));
+    mask[(size_t)cpu / bitsPerWord] = 1UL << ((size_t)cpu % bitsPerWord);
+    return (syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0) ? 0 : -1;
+#else
+    (void)cpu;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+XSUM_API int XSUM_canPinThreads(void)
+{
+#if defined(_WIN32)
+    /* there is no way to read the mask of a thread without setting it */
+    DWORD_PTR const previous = SetThreadAffinityMask(GetCurrentThread(), 1);
+    if (previous == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    (void)SetThreadAffinityMask(GetCurrentThread(), previous);
+    return 0;
+#elif defined(__linux__) && !defined(__EMSCRIPTEN__) && defined(SYS_sched_setaffinity) && defined(SYS_sched_getaffinity)
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) < 0) return -1;
+    return (syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0) ? 0 : -1;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
+/*
+ * Host description
+ */
+#if !defined(_WIN32) && (XSUM_PLATFORM_POSIX_VERSION > 0)
+#  include <sys/utsname.h>   /* uname */
+#endif
+#if defined(__APPLE__)
+#  include <sys/sysctl.h>    /* sysctlbyname */
+#endif
+
+static void XSUM_copyString(char* dst, size_t capacity, const char* src)
+{
+    size_t length = strlen(src);
+    if (length >= capacity) length = capacity - 1;
+    memcpy(dst, src, length);
+    dst[length] = 0;
+}
+
+XSUM_API void XSUM_getHostInfo(XSUM_hostInfo* info)
+{
+    XSUM_copyString(info->host, sizeof(info->host), "unknown");
+    XSUM_copyString(info->os, sizeof(info->os), "unknown");
+    XSUM_copyString(info->cpu, sizeof(info->cpu), "unknown");
+#if defined(_WIN32)
+    {   DWORD size = (DWORD)sizeof(info->host);
+        const char* const cpu = getenv("PROCESSOR_IDENTIFIER");
+        if (!GetComputerNameA(info->host, &size)) XSUM_copyString(info->host, sizeof(info->host), "unknown");
+        XSUM_copyString(info->os, sizeof(info->os), "Windows");
+        if (cpu != NULL) XSUM_copyString(info->cpu, sizeof(info->cpu), cpu);
+    }
+#elif XSUM_PLATFORM_POSIX_VERSION > 0
+    {   struct utsname name;
+        if (uname(&name) == 0) {
+            XSUM_copyString(info->host, sizeof(info->host), name.nodename);
+            XSUM_copyString(info->os, sizeof(info->os), name.sysname);
+            if (strlen(info->os) + 1 + strlen(name.release) < sizeof(info->os)) {
+                strcat(info->os, " ");
+                strcat(info->os, name.release);
+            }
+            XSUM_copyString(info->cpu, sizeof(info->cpu), name.machine);
+    }   }
+#  if defined(__linux__)
+    {   FILE* const cpuinfo = fopen("/proc/cpuinfo", "r");
+        char line[256];
+        if (cpuinfo != NULL) {
+            while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+                const char* const colon = strchr(line, ':');
+                if (strncmp(line, "model name", 10) || colon == NULL) continue;
+                line[strcspn(line, "\r\n")] = 0;
+                XSUM_copyString(info->cpu, sizeof(info->cpu), colon + 1 + (colon[1] == ' '));
+                break;
+            }
+            fclose(cpuinfo);
+    }   }
+#  elif defined(__APPLE__)
+    {   char brand[128];
+        size_t size = sizeof(brand);
+        if (sysctlbyname("machdep.cpu.brand_string", brand, &size, NULL, 0) == 0 && size > 0) {
+            brand[sizeof(brand) - 1] = 0;
+            XSUM_copyString(info->cpu, sizeof(info->cpu), brand);
+    }   }
+#  endif
+#endif
+}
+
+
+/*
+ * Time
+ */
+#if !defined(_WIN32) && (XSUM_PLATFORM_POSIX_VERSION >= 199309L) && defined(CLOCK_MONOTONIC)
+#  include <sys/resource.h>   /* getrusage */
+
+XSUM_API XSUM_U64 XSUM_clockNs(void)
+{
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+    /* not slewed by NTP adjustments, so durations are comparable */
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) == 0)
+        return (XSUM_U64)ts.tv_sec * 1000000000ULL + (XSUM_U64)ts.tv_nsec;
+#endif
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+    return (XSUM_U64)ts.tv_sec * 1000000000ULL + (XSUM_U64)ts.tv_nsec;
+}
+
+XSUM_API XSUM_U64 XSUM_cpuTimeNs(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+    return ((XSUM_U64)usage.ru_utime.tv_sec + (XSUM_U64)usage.ru_stime.tv_sec) * 1000000000ULL
+         + ((XSUM_U64)usage.ru_utime.tv_usec + (XSUM_U64)usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+#elif defined(_WIN32)
+
+XSUM_API XSUM_U64 XSUM_clockNs(void)
+{
+    static LARGE_INTEGER frequency;   /* constant, racing initializations are harmless */
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (XSUM_U64)(now.QuadPart / frequency.QuadPart) * 1000000000ULL
+         + (XSUM_U64)(now.QuadPart % frequency.QuadPart) * 1000000000ULL / (XSUM_U64)frequency.QuadPart;
+}
+
+XSUM_API XSUM_U64 XSUM_cpuTimeNs(void)
+{
+    FILETIME creation, exit, kernel, user;   /* 100 ns units */
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+    return ( (((XSUM_U64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime)
+           + (((XSUM_U64)user.dwHighDateTime << 32) | user.dwLowDateTime) ) * 100;
+}
+
+#else  /* C90 */
+
+/* clock() counts processor time rather than wall time,
+ * but it's much more precise than time(), which counts seconds */
+XSUM_API XSUM_U64 XSUM_clockNs(void)
+{
+    return (XSUM_U64)clock() * (1000000000ULL / CLOCKS_PER_SEC);
+}
+
+XSUM_API XSUM_U64 XSUM_cpuTimeNs(void)
+{
+    return (XSUM_U64)clock() * 1000000000ULL / CLOCKS_PER_SEC;
+}
+
+#endif
+
+
+/*
+ * File identity: sub-second timestamps are only available on some platforms.
+ */
+#if defined(__APPLE__)
+#  define XSUM_ST_MTIME_NSEC(st) ((XSUM_U64)(st).st_mtimespec.tv_nsec)
+#  define XSUM_ST_CTIME_NSEC(st) ((XSUM_U64)(st).st_ctimespec.tv_nsec)
+#elif !defined(_WIN32) && defined(st_mtime)   /* st_mtime is defined as st_mtim.tv_sec */
+#  define XSUM_ST_MTIME_NSEC(st) ((XSUM_U64)(st).st_mtim.tv_nsec)
+#  define XSUM_ST_CTIME_NSEC(st) ((XSUM_U64)(st).st_ctim.tv_nsec)
+#else
+#  define XSUM_ST_MTIME_NSEC(st) 0
+#  define XSUM_ST_CTIME_NSEC(st) 0
+#endif
+
+XSUM_API int XSUM_statFile(const char* filename, XSUM_fileStat* st)
+{
+    XSUM_stat_t statbuf;
+    if (XSUM_stat(filename, &statbuf)) return -1;
+    st->size     = (XSUM_U64)statbuf.st_size;
+    st->mtime_ns = (XSUM_U64)statbuf.st_mtime * 1000000000ULL + XSUM_ST_MTIME_NSEC(statbuf);
+    st->ctime_ns = (XSUM_U64)statbuf.st_ctime * 1000000000ULL + XSUM_ST_CTIME_NSEC(statbuf);
+#if defined(_WIN32)
+    st->inode    = 0;   /* st_ino is always 0 */
+#else
+    st->inode    = (XSUM_U64)statbuf.st_ino;
+#endif
+    st->device   = (XSUM_U64)statbuf.st_dev;
+    st->mode     = (XSUM_U32)statbuf.st_mode & 07777;
+    return 0;
+}
+
+
+XSUM_API int XSUM_seekFile(FILE* stream, XSUM_U64 offset)
+{
+#if defined(_WIN32)
+    if (offset > (XSUM_U64)0x7FFFFFFFFFFFFFFFULL) return -1;
+    return _fseeki64(stream, (__int64)offset, SEEK_SET) ? -1 : 0;
+#elif (XSUM_PLATFORM_POSIX_VERSION >= 200112L)
+    off_t const pos = (off_t)offset;
+    if (pos < 0 || (XSUM_U64)pos != offset) return -1;
+    return fseeko(stream, pos, SEEK_SET) ? -1 : 0;
+#else
+    if (offset > (XSUM_U64)LONG_MAX) return -1;
+    return fseek(stream, (long)offset, SEEK_SET) ? -1 : 0;
+#endif
+}
+
+
+/*
+ * Small files
+ */
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0) && !defined(__EMSCRIPTEN__)
+#  include <fcntl.h>    /* open */
+#  include <unistd.h>   /* read, close */
+#  ifndef O_CLOEXEC
+#    define O_CLOEXEC 0
+#  endif
+
+static int XSUM_closeOnError(int fd)
+{
+    int const errorNb = errno;
+    close(fd);
+    errno = errorNb;
+    return -1;
+}
+
+XSUM_API int XSUM_openFile(const char* filename, void* buffer, size_t capacity,
+                           size_t* size, FILE** stream)
+{
+    /* O_NONBLOCK: don't wait for a writer before knowing this is a FIFO.
+     * It has no effect on regular files. */
+    int const fd = open(filename, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    struct stat statbuf;
+    *stream = NULL;
+    if (fd < 0) return -1;
+    if (fstat(fd, &statbuf)) return XSUM_closeOnError(fd);
+    if (S_ISDIR(statbuf.st_mode)) {
+        errno = EISDIR;
+        return XSUM_closeOnError(fd);
+    }
+    if (!S_ISREG(statbuf.st_mode)) {
+        /* pipes and devices are opened the usual way, blocking */
+        close(fd);
+        *stream = XSUM_fopen(filename, "rb");
+        return (*stream == NULL) ? -1 : 1;
+    }
+
+    if ((XSUM_U64)statbuf.st_size < (XSUM_U64)capacity) {
+        size_t total = 0;
+        while (total < capacity) {
+            long const readSize = (long)read(fd, (char*)buffer + total, capacity - total);
+            if (readSize < 0) {
+                if (errno == EINTR) continue;
+                return XSUM_closeOnError(fd);
+            }
+            if (readSize == 0) break;
+            total += (size_t)readSize;
+        }
+        if (total < capacity) {
+            close(fd);
+            *size = total;
+            return 0;
+        }
+        /* the file grew meanwhile */
+        if (lseek(fd, 0, SEEK_SET) != 0) return XSUM_closeOnError(fd);
+    }
+
+    *stream = fdopen(fd, "rb");
+    if (*stream == NULL) return XSUM_closeOnError(fd);
+    return 1;
+}
+
+#else
+
+XSUM_API int XSUM_openFile(const char* filename, void* buffer, size_t capacity,
+                           size_t* size, FILE** stream)
+{
+    (void)buffer; (void)capacity; (void)size;
+    *stream = NULL;
+    if (XSUM_isDirectory(filename)) {
+        errno = EISDIR;
+        return -1;
+    }
+    *stream = XSUM_fopen(filename, "rb");
+    return (*stream == NULL) ? -1 : 1;
+}
+
+#endif
+
+
+/*
+ * Pipes
+ */
+#if defined(__linux__) && !defined(F_SETPIPE_SZ)
+#  define F_SETPIPE_SZ 1031   /* Linux >= 2.6.35, only exposed by glibc with _GNU_SOURCE */
+#endif
+
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0) && !defined(__EMSCRIPTEN__)
+#  include <fcntl.h>    /* fcntl */
+
+XSUM_API int XSUM_growPipe(FILE* stream, size_t size)
+{
+    int const fd = fileno(stream);
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) || !S_ISFIFO(statbuf.st_mode)) return 0;
+#  if defined(F_SETPIPE_SZ)
+    /* best effort: the size is capped by /proc/sys/fs/pipe-max-size */
+    if (size <= (size_t)INT_MAX) (void)fcntl(fd, F_SETPIPE_SZ, (int)size);
+#  else
+    (void)size;
+#  endif
+    return 1;
+}
+
+#else
+
+XSUM_API int XSUM_growPipe(FILE* stream, size_t size)
+{
+    (void)stream; (void)size;
+    return 0;
+}
+
+#endif
+
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#  include <sys/syscall.h>   /* SYS_tee */
+#  include <unistd.h>        /* syscall, read */
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__) && defined(SYS_tee)
+
+XSUM_API long XSUM_teePipe(FILE* in, FILE* out, void* buffer, size_t size)
+{
+    int const fdIn = fileno(in);
+    /* tee() is only declared by glibc with _GNU_SOURCE */
+    long const teed = syscall(SYS_tee, fdIn, fileno(out), size, 0U);
+    long got = 0;
+    if (teed <= 0) return teed;
+    while (got < teed) {
+        ssize_t const readSize = read(fdIn, (char*)buffer + got, (size_t)(teed - got));
+        if (readSize <= 0) {
+            if (readSize == 0) errno = EIO;
+            return -1;
+        }
+        got += (long)readSize;
+    }
+    return teed;
+}
+
+#else
+
+XSUM_API long XSUM_teePipe(FILE* in, FILE* out, void* buffer, size_t size)
+{
+    (void)in; (void)out; (void)buffer; (void)size;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+
+/*
+ * Sparse files
+ */
+#if defined(__linux__) && !defined(SEEK_DATA)
+#  define SEEK_DATA 3   /* Linux >= 3.1, only exposed by glibc with _GNU_SOURCE */
+#  define SEEK_HOLE 4
+#endif
+
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0) \
+ && !defined(__EMSCRIPTEN__) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+#  include <unistd.h>   /* lseek */
+
+XSUM_API int XSUM_isSparseFile(FILE* stream, XSUM_U64* size)
+{
+    int const fd = fileno(stream);
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) || !S_ISREG(statbuf.st_mode)) return 0;
+    if (lseek(fd, 0, SEEK_CUR) != 0) return 0;
+    /* st_blocks counts 512-byte units, whatever the file system block size */
+    if ((XSUM_U64)statbuf.st_blocks * 512 >= (XSUM_U64)statbuf.st_size) return 0;
+    *size = (XSUM_U64)statbuf.st_size;
+    return 1;
+}
+
+XSUM_API int XSUM_findData(FILE* stream, XSUM_U64 offset, XSUM_U64* dataStart, XSUM_U64* dataEnd)
+{
+    int const fd = fileno(stream);
+    off_t const start = lseek(fd, (off_t)offset, SEEK_DATA);
+    off_t end;
+    if (start < 0) return (errno == ENXIO) ? 1 : -1;
+    end = lseek(fd, start, SEEK_HOLE);   /* end of file is an implicit hole */
+    if (end < start) return -1;
+    *dataStart = (XSUM_U64)start;
+    *dataEnd = (XSUM_U64)end;
+    return 0;
+}
+
+#else  /* holes can't be located */
+
+XSUM_API int XSUM_isSparseFile(FILE* stream, XSUM_U64* size)
+{
+    (void)stream; (void)size;
+    return 0;
+}
+
+XSUM_API int XSUM_findData(FILE* stream, XSUM_U64 offset, XSUM_U64* dataStart, XSUM_U64* dataEnd)
+{
+    (void)stream; (void)offset; (void)dataStart; (void)dataEnd;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+
+/*
+ * Extended attributes
+ */
+#if (defined(__linux__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#  include <sys/xattr.h>   /* getxattr, setxattr */
+
+XSUM_API long XSUM_getXattr(const char* filename, const char* name, void* value, size_t size)
+{
+#  if defined(__APPLE__)
+    return (long)getxattr(filename, name, value, size, 0, 0);
+#  else
+    return (long)getxattr(filename, name, value, size);
+#  endif
+}
+
+XSUM_API int XSUM_setXattr(const char* filename, const char* name, const void* value, size_t size)
+{
+#  if defined(__APPLE__)
+    return setxattr(filename, name, value, size, 0, 0);
+#  else
+    return setxattr(filename, name, value, size, 0);
+#  endif
+}
+
+#else  /* no extended attributes */
+
+XSUM_API long XSUM_getXattr(const char* filename, const char* name, void* value, size_t size)
+{
+    (void)filename; (void)name; (void)value; (void)size;
+    errno = ENOSYS;
+    return -1;
+}
+
+XSUM_API int XSUM_setXattr(const char* filename, const char* name, const void* value, size_t size)
+{
+    (void)filename; (void)name; (void)value; (void)size;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+
+/*
+ * Read-only file mapping
+ */
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0) && !defined(__EMSCRIPTEN__)
+#  include <sys/mman.h>   /* mmap, munmap */
+#  include <fcntl.h>      /* open */
+#  include <unistd.h>     /* close */
+
+XSUM_API void* XSUM_mapFile(const char* filename, size_t* size)
+{
+    XSUM_stat_t statbuf;
+    void* data;
+    int const fd = open(filename, O_RDONLY);
+    *size = 0;
+    if (fd < 0) return NULL;
+    if (fstat(fd, &statbuf)) {
+        int const errorNb = errno;
+        close(fd);
+        errno = errorNb;
+        return NULL;
+    }
+    if (statbuf.st_size <= 0 || (XSUM_U64)statbuf.st_size > (XSUM_U64)(size_t)-1) {
+        /* files of 4 GB or more can't be mapped whole by 32-bit programs */
+        close(fd);
+        errno = (statbuf.st_size <= 0) ? 0 : EFBIG;
+        return NULL;
+    }
+    data = mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);   /* the mapping stays valid */
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t)statbuf.st_size;
+    return data;
+}
+
+XSUM_API void XSUM_unmapFile(void* data, size_t size)
+{
+    if (data != NULL) munmap(data, size);
+}
+
+#else  /* no mmap(): read the file */
+
+XSUM_API void* XSUM_mapFile(const char* filename, size_t* size)
+{
+    XSUM_U64 const fileSize = XSUM_getFileSize(filename);
+    FILE* const f = XSUM_fopen(filename, "rb");
+    char* data;
+    *size = 0;
+    if (f == NULL) return NULL;
+    if (fileSize == 0 || (size_t)fileSize != fileSize) {
+        fclose(f);
+        errno = (fileSize == 0) ? 0 : EFBIG;
+        return NULL;
+    }
+    data = (char*)malloc((size_t)fileSize);
+    if (data == NULL || fread(data, 1, (size_t)fileSize, f) != (size_t)fileSize) {
+        int const errorNb = (data == NULL) ? ENOMEM : EIO;
+        free(data);
+        fclose(f);
+        errno = errorNb;
+        return NULL;
+    }
+    fclose(f);
+    *size = (size_t)fileSize;
+    return data;
+}
+
+XSUM_API void XSUM_unmapFile(void* data, size_t size)
+{
+    (void)size;
+    free(data);
+}
+
+#endif
+
+
+/*
+ * Cache bypass and eviction
+ */
+#if defined(__linux__) && !defined(O_DIRECT) && defined(__O_DIRECT)
+#  define O_DIRECT __O_DIRECT   /* only exposed by glibc with _GNU_SOURCE */
+#endif
+
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION > 0) && !defined(__EMSCRIPTEN__) \
+ && (defined(O_DIRECT) || defined(F_NOCACHE))
+
+struct XSUM_directFile_s {
+    int fd;
+};
+
+XSUM_API XSUM_directFile* XSUM_openDirect(const char* filename)
+{
+    XSUM_directFile* file;
+#if defined(O_DIRECT)
+    int const fd = open(filename, O_RDONLY | O_DIRECT);
+    if (fd < 0) return NULL;
+#else
+    int const fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fcntl(fd, F_NOCACHE, 1) == -1) {
+        int const errorNb = errno;
+        close(fd);
+        errno = errorNb;
+        return NULL;
+    }
+#endif
+    file = (XSUM_directFile*)malloc(sizeof(*file));
+    if (file == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->fd = fd;
+    return file;
+}
+
+XSUM_API long XSUM_readDirect(XSUM_directFile* file, void* buffer, size_t size)
+{
+    for (;;) {
+        ssize_t const readSize = read(file->fd, buffer, size);
+        if (readSize >= 0) return (long)readSize;
+        if (errno != EINTR) return -1;
+    }
+}
+
+XSUM_API void XSUM_closeDirect(XSUM_directFile* file)
+{
+    if (file == NULL) return;
+    close(file->fd);
+    free(file);
+}
+
+#else  /* no way to bypass the cache */
+
+XSUM_API XSUM_directFile* XSUM_openDirect(const char* filename)
+{
+    (void)filename;
+    errno = ENOSYS;
+    return NULL;
+}
+
+XSUM_API long XSUM_readDirect(XSUM_directFile* file, void* buffer, size_t size)
+{
+    (void)file; (void)buffer; (void)size;
+    errno = ENOSYS;
+    return -1;
+}
+
+XSUM_API void XSUM_closeDirect(XSUM_directFile* file)
+{
+    (void)file;
+}
+
+#endif
+
+#if !XSUM_WIN32_USE_WCHAR && !defined(_MSC_VER) && (XSUM_PLATFORM_POSIX_VERSION >= 200112L) && !defined(__EMSCRIPTEN__) \
+ && defined(POSIX_FADV_DONTNEED)
+
+XSUM_API int XSUM_dropFileCache(const char* filename)
+{
+    int result;
+    int const fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    if (result != 0) {
+        errno = result;   /* posix_fadvise() returns the error */
+        return -1;
+    }
+    return 0;
+}
+
+#else  /* no cache eviction */
+
+XSUM_API int XSUM_dropFileCache(const char* filename)
+{
+    (void)filename;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+/*
+ * Physical layout
+ */
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#  include <fcntl.h>         /* open */
+#  include <unistd.h>        /* close */
+#  include <sys/ioctl.h>     /* ioctl */
+#  include <linux/fs.h>      /* FS_IOC_FIEMAP, FIBMAP, FIGETBSZ */
+#  include <linux/fiemap.h>  /* struct fiemap */
+#endif
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__) && defined(FS_IOC_FIEMAP)
+
+XSUM_API int XSUM_getPhysicalOffset(const char* filename, XSUM_U64* offset)
+{
+    union {
+        struct fiemap map;
+        char buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    } request;
+    int result = -1;
+    int const fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+
+    memset(&request, 0, sizeof(request));
+    request.map.fm_start = 0;
+    request.map.fm_length = ~(__u64)0;
+    request.map.fm_extent_count = 1;   /* only the first extent is needed */
+    if (ioctl(fd, FS_IOC_FIEMAP, &request.map) == 0) {
+        if ( request.map.fm_mapped_extents == 1
+          && !(request.map.fm_extents[0].fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)) ) {
+            *offset = (XSUM_U64)request.map.fm_extents[0].fe_physical;
+            result = 0;
+        }
+    } else {
+        /* no FIEMAP support: FIBMAP needs CAP_SYS_RAWIO */
+        int block = 0;
+        int blockSize = 0;
+        if ( ioctl(fd, FIGETBSZ, &blockSize) == 0
+          && ioctl(fd, FIBMAP, &block) == 0 && block > 0 ) {
+            *offset = (XSUM_U64)block * (XSUM_U64)blockSize;
+            result = 0;
+    }   }
+    close(fd);
+    return result;
+}
+
+#else  /* layout is unknown */
+
+XSUM_API int XSUM_getPhysicalOffset(const char* filename, XSUM_U64* offset)
+{
+    (void)filename; (void)offset;
+    return -1;
+}
+
+#endif
@@ -63,6 +63,206 @@ XSUM_API int XSUM_isDirectory(const char* filename);
  */
 XSUM_API XSUM_U64 XSUM_getFileSize(const char* filename);
 
+/*
+ * File types, as reported by XSUM_getFileType() and XSUM_readDir().
+ */
+typedef enum {
+    XSUM_fileType_unknown = 0,
+    XSUM_fileType_regular,
+    XSUM_fileType_directory,
+    XSUM_fileType_symlink,   /* only reported by XSUM_readDir() */
+    XSUM_fileType_other      /* fifo, socket, device, ... */
+} XSUM_fileType;
+
+/*
+ * Returns the type of the file at filename, following symbolic links.
+ * Returns XSUM_fileType_unknown if it cannot be determined.
+ */
+XSUM_API XSUM_fileType XSUM_getFileType(const char* filename);
+
+/*
+ * Same as XSUM_getFileType(), but reports symbolic links themselves
+ * as XSUM_fileType_symlink, on platforms which have them.
+ */
+XSUM_API XSUM_fileType XSUM_getLinkType(const char* filename);
+
+/*
+ * Directory iteration.
+ *
+ * XSUM_openDir() returns NULL on failure, with errno set.
+ * XSUM_readDir() returns the name of the next entry, or NULL at the end.
+ * "." and ".." are skipped. The returned name is only valid until the next
+ * call. `*type` is filled from the directory entry when the platform provides
+ * it for free, otherwise it is XSUM_fileType_unknown.
+ */
+typedef struct XSUM_dir_s XSUM_dir;
+XSUM_API XSUM_dir* XSUM_openDir(const char* dirname);
+XSUM_API const char* XSUM_readDir(XSUM_dir* dir, XSUM_fileType* type);
+XSUM_API void XSUM_closeDir(XSUM_dir* dir);
+
+/*
+ * Returns a newly allocated "dirName/name", to be free()d, or NULL.
+ * No separator is added when dirName already ends with one.
+ */
+XSUM_API char* XSUM_pathJoin(const char* dirName, const char* name);
+
+/*
+ * Returns the number of online logical cores, or 1 if unknown.
+ */
+XSUM_API int XSUM_getNbCores(void);
+
+/*
+ * Restricts the calling thread to logical core `cpu`, numbered from 0.
+ * Returns 0 on success, -1 on failure with errno set, ENOSYS on platforms
+ * which can't do it.
+ */
+XSUM_API int XSUM_pinThread(int cpu);
+
+/*
+ * Checks that threads can be pinned, leaving the calling thread's affinity
+ * unchanged. Returns 0 if they can, -1 otherwise with errno set.
+ */
+XSUM_API int XSUM_canPinThreads(void);
+
+/*
+ * Describes the machine, for benchmark reports: its network name, its
+ * operating system with the kernel release, and its processor model.
+ * Fields which can't be determined are set to "unknown".
+ */
+typedef struct {
+    char host[128];
+    char os[128];
+    char cpu[128];
+} XSUM_hostInfo;
+XSUM_API void XSUM_getHostInfo(XSUM_hostInfo* info);
+
+/*
+ * XSUM_clockNs() returns a monotonic time in nanoseconds, from an arbitrary
+ * origin, not slewed by NTP where possible (Linux CLOCK_MONOTONIC_RAW).
+ * XSUM_cpuTimeNs() returns the CPU time consumed so far by the process,
+ * all threads, user and system, in nanoseconds.
+ * Both are cheap enough to be called for each block of data.
+ */
+XSUM_API XSUM_U64 XSUM_clockNs(void);
+XSUM_API XSUM_U64 XSUM_cpuTimeNs(void);
+
+/*
+ * Metadata identifying a version of a file's content.
+ * Times are in nanoseconds since the epoch, with the resolution of the
+ * platform; `inode` and `device` are 0 where the platform has no such notion.
+ * `mode` holds the permission bits (07777).
+ */
+typedef struct {
+    XSUM_U64 size;
+    XSUM_U64 mtime_ns;
+    XSUM_U64 ctime_ns;
+    XSUM_U64 inode;
+    XSUM_U64 device;
+    XSUM_U32 mode;
+} XSUM_fileStat;
+
+/*
+ * Fills `st` for the file at filename, following symbolic links.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+XSUM_API int XSUM_statFile(const char* filename, XSUM_fileStat* st);
+
+/*
+ * fseek() to an absolute 64-bit offset, even where `long` is 32-bit.
+ * Returns 0 on success, -1 on failure.
+ */
+XSUM_API int XSUM_seekFile(FILE* stream, XSUM_U64 offset);
+
+/*
+ * Opens the file at filename for reading, with a single open() and fstat()
+ * where possible.
+ * If it is a regular file of less than `capacity` bytes, reads it entirely
+ * into `buffer`, closes it, sets `*size` and returns 0.
+ * Otherwise returns 1, and sets `*stream` to the file opened in binary mode,
+ * at its start, like XSUM_fopen(filename, "rb").
+ * Returns -1 on failure with errno set, EISDIR for a directory.
+ */
+XSUM_API int XSUM_openFile(const char* filename, void* buffer, size_t capacity,
+                           size_t* size, FILE** stream);
+
+/*
+ * Returns 1 if `stream` is a pipe, 0 otherwise.
+ * On Linux, also tries to enlarge the pipe's kernel buffer up to `size` bytes,
+ * so that a writer on another core can run ahead with fewer wake-ups.
+ */
+XSUM_API int XSUM_growPipe(FILE* stream, size_t size);
+
+/*
+ * If `in` and `out` are both pipes, duplicates up to `size` bytes of `in`
+ * into `out` without copying them through user space (Linux tee(2)),
+ * then consumes the same bytes from `in` into `buffer`.
+ * Neither stream must have been used through stdio.
+ * Returns the number of bytes forwarded, 0 at end of input, or -1 with errno
+ * set: EINVAL or ENOSYS mean nothing was done, and a copy is needed instead.
+ */
+XSUM_API long XSUM_teePipe(FILE* in, FILE* out, void* buffer, size_t size);
+
+/*
+ * Sparse files.
+ * XSUM_isSparseFile() returns 1 and sets `*size` if `stream` is a regular
+ * file positioned at its start, which has holes that this platform can
+ * locate without reading them. It returns 0 otherwise.
+ * XSUM_findData() sets [*dataStart, *dataEnd) to the first region of such a
+ * file which may contain data, at or after `offset`: anything else reads as
+ * zeroes. Returns 0 on success, 1 when only holes remain, -1 on failure.
+ */
+XSUM_API int XSUM_isSparseFile(FILE* stream, XSUM_U64* size);
+XSUM_API int XSUM_findData(FILE* stream, XSUM_U64 offset, XSUM_U64* dataStart, XSUM_U64* dataEnd);
+
+/*
+ * Extended attributes of the file at filename.
+ * XSUM_getXattr() returns the size of the value, XSUM_setXattr() returns 0.
+ * Both return -1 on failure with errno set, including on platforms
+ * without extended attributes.
+ */
+XSUM_API long XSUM_getXattr(const char* filename, const char* name, void* value, size_t size);
+XSUM_API int XSUM_setXattr(const char* filename, const char* name, const void* value, size_t size);
+
+/*
+ * Maps the whole file at filename read-only, or reads it in memory on
+ * platforms without mmap(). The result must be released by XSUM_unmapFile().
+ * Returns NULL on failure with errno set, EFBIG for a file larger than the
+ * address space, or with errno==0 for an empty file.
+ */
+XSUM_API void* XSUM_mapFile(const char* filename, size_t* size);
+XSUM_API void XSUM_unmapFile(void* data, size_t size);
+
+/*
+ * Reads bypassing the OS file cache: O_DIRECT, or F_NOCACHE on macOS.
+ * XSUM_openDirect() returns NULL on failure with errno set: EINVAL when the
+ * file system refuses such reads, ENOSYS on platforms without them.
+ * XSUM_readDirect() reads up to `size` bytes into `buffer`; both `buffer` and
+ * `size` must be multiples of XSUM_DIRECT_ALIGN. Returns the number of bytes
+ * read, 0 at the end of the file, or -1 on failure with errno set.
+ */
+#define XSUM_DIRECT_ALIGN 4096
+typedef struct XSUM_directFile_s XSUM_directFile;
+XSUM_API XSUM_directFile* XSUM_openDirect(const char* filename);
+XSUM_API long XSUM_readDirect(XSUM_directFile* file, void* buffer, size_t size);
+XSUM_API void XSUM_closeDirect(XSUM_directFile* file);
+
+/*
+ * Asks the OS to evict the cached content of the file at filename,
+ * so that the next read comes from the storage device.
+ * Returns 0 on success, -1 on failure with errno set, ENOSYS on platforms
+ * which can't do it.
+ */
+XSUM_API int XSUM_dropFileCache(const char* filename);
+
+/*
+ * Sets `*offset` to the position on the storage device of the first byte of
+ * the file at filename (Linux FIEMAP, or FIBMAP with enough privileges),
+ * so that files can be read in the order they are laid out on disk.
+ * Returns 0 on success, -1 if the position is unknown: the file is empty,
+ * its data is not stored in blocks, or the platform can't tell.
+ */
+XSUM_API int XSUM_getPhysicalOffset(const char* filename, XSUM_U64* offset);
+
 /*
  * UTF-8 stdio wrappers primarily for Windows
  */
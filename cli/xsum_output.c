@@ -28,6 +28,8 @@
 
 int XSUM_logLevel = 2;
 
+static FILE* XSUM_outputStream = NULL;   /* NULL: stdout */
+
 XSUM_ATTRIBUTE((__format__(__printf__, 1, 2)))
 XSUM_API int XSUM_log(const char* format, ...)
 {
@@ -46,11 +48,16 @@ XSUM_API int XSUM_output(const char* format, ...)
     int ret;
     va_list ap;
     va_start(ap, format);
-    ret = XSUM_vfprintf(stdout, format, ap);
+    ret = XSUM_vfprintf(XSUM_outputStream ? XSUM_outputStream : stdout, format, ap);
     va_end(ap);
     return ret;
 }
 
+XSUM_API void XSUM_setOutput(FILE* stream)
+{
+    XSUM_outputStream = stream;
+}
+
 XSUM_ATTRIBUTE((__format__(__printf__, 2, 3)))
 XSUM_API int XSUM_logVerbose(int minLevel, const char* format, ...)
 {
@@ -27,6 +27,7 @@
 #define XSUM_OUTPUT_H
 
 #include "xsum_config.h"
+#include <stdio.h>   /* FILE */
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,11 +51,16 @@ XSUM_ATTRIBUTE((__format__(__printf__, 2, 3)))
 XSUM_API int XSUM_logVerbose(int minLevel, const char *format, ...);
 
 /*
- * Same as printf(format, ...)
+ * Same as printf(format, ...), or fprintf() to the stream set by XSUM_setOutput()
  */
 XSUM_ATTRIBUTE((__format__(__printf__, 1, 2)))
 XSUM_API int XSUM_output(const char *format, ...);
 
+/*
+ * Redirects XSUM_output() to `stream`, or back to stdout if NULL.
+ */
+XSUM_API void XSUM_setOutput(FILE* stream);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,337 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_pool.h"
+#include <stdlib.h>   /* malloc, calloc, free */
+#include <assert.h>   /* assert */
+
+/*
+ * Thread primitives.
+ * Windows requires Vista+ for condition variables.
+ */
+#if XSUM_MULTITHREAD && defined(_WIN32)
+#  if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#    undef  _WIN32_WINNT
+#    define _WIN32_WINNT 0x0600
+#  endif
+#  include <windows.h>
+#  include <process.h>  /* _beginthreadex */
+    typedef HANDLE             XSUM_thread_t;
+    typedef CRITICAL_SECTION   XSUM_mutex_t;
+    typedef CONDITION_VARIABLE XSUM_cond_t;
+#   define XSUM_mutex_init(m)     InitializeCriticalSection(m)
+#   define XSUM_mutex_destroy(m)  DeleteCriticalSection(m)
+#   define XSUM_mutex_lock(m)     EnterCriticalSection(m)
+#   define XSUM_mutex_unlock(m)   LeaveCriticalSection(m)
+#   define XSUM_cond_init(c)      InitializeConditionVariable(c)
+#   define XSUM_cond_destroy(c)   ((void)(c))
+#   define XSUM_cond_wait(c, m)   SleepConditionVariableCS((c), (m), INFINITE)
+#   define XSUM_cond_signal(c)    WakeConditionVariable(c)
+#   define XSUM_cond_broadcast(c) WakeAllConditionVariable(c)
+#elif XSUM_MULTITHREAD
+#  include <pthread.h>
+    typedef pthread_t          XSUM_thread_t;
+    typedef pthread_mutex_t    XSUM_mutex_t;
+    typedef pthread_cond_t     XSUM_cond_t;
+#   define XSUM_mutex_init(m)     pthread_mutex_init((m), NULL)
+#   define XSUM_mutex_destroy(m)  pthread_mutex_destroy(m)
+#   define XSUM_mutex_lock(m)     pthread_mutex_lock(m)
+#   define XSUM_mutex_unlock(m)   pthread_mutex_unlock(m)
+#   define XSUM_cond_init(c)      pthread_cond_init((c), NULL)
+#   define XSUM_cond_destroy(c)   pthread_cond_destroy(c)
+#   define XSUM_cond_wait(c, m)   pthread_cond_wait((c), (m))
+#   define XSUM_cond_signal(c)    pthread_cond_signal(c)
+#   define XSUM_cond_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+typedef struct {
+    XSUM_poolJob_f job;
+    void*          opaque;
+    int*           completed;
+} XSUM_poolJob;
+
+struct XSUM_pool_s {
+    int nbThreads;
+#if XSUM_MULTITHREAD
+    XSUM_thread_t* threads;
+    XSUM_mutex_t   mutex;      /* protects the queue and the counters below */
+    XSUM_cond_t    jobCond;    /* a job was queued, or shutdown was requested */
+    XSUM_cond_t    doneCond;   /* a job has completed */
+    XSUM_mutex_t   userMutex;  /* see XSUM_pool_lock() */
+    /* Circular buffer, grown on demand */
+    XSUM_poolJob*  queue;
+    size_t         capacity;
+    size_t         head;
+    size_t         count;
+    int            nbBusy;
+    int            shutdown;
+#endif
+};
+
+#if XSUM_MULTITHREAD
+
+static void XSUM_pool_work(XSUM_pool* pool)
+{
+    XSUM_mutex_lock(&pool->mutex);
+    for (;;) {
+        XSUM_poolJob job;
+        while (pool->count == 0 && !pool->shutdown)
+            XSUM_cond_wait(&pool->jobCond, &pool->mutex);
+        if (pool->count == 0) break;   /* shutdown, and nothing left to do */
+        job = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+        pool->nbBusy++;
+        XSUM_mutex_unlock(&pool->mutex);
+
+        job.job(job.opaque);
+
+        XSUM_mutex_lock(&pool->mutex);
+        pool->nbBusy--;
+        if (job.completed != NULL) *job.completed = 1;
+        XSUM_cond_broadcast(&pool->doneCond);
+    }
+    XSUM_mutex_unlock(&pool->mutex);
+}
+
+#  if defined(_WIN32)
+static unsigned __stdcall XSUM_pool_thread(void* opaque)
+{
+    XSUM_pool_work((XSUM_pool*)opaque);
+    return 0;
+}
+static int XSUM_thread_create(XSUM_thread_t* thread, XSUM_pool* pool)
+{
+    *thread = (HANDLE)_beginthreadex(NULL, 0, XSUM_pool_thread, pool, 0, NULL);
+    return *thread == NULL;
+}
+static void XSUM_thread_join(XSUM_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#  else
+static void* XSUM_pool_thread(void* opaque)
+{
+    XSUM_pool_work((XSUM_pool*)opaque);
+    return NULL;
+}
+static int XSUM_thread_create(XSUM_thread_t* thread, XSUM_pool* pool)
+{
+    return pthread_create(thread, NULL, XSUM_pool_thread, pool);
+}
+static void XSUM_thread_join(XSUM_thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+#  endif
+
+/* Doubles the queue capacity. Must be called with the mutex held. */
+static int XSUM_pool_grow(XSUM_pool* pool)
+{
+    size_t const newCapacity = pool->capacity ? pool->capacity * 2 : 64;
+    XSUM_poolJob* const newQueue = (XSUM_poolJob*)malloc(newCapacity * sizeof(XSUM_poolJob));
+    size_t n;
+    if (newQueue == NULL) return 1;
+    for (n = 0; n < pool->count; n++)
+        newQueue[n] = pool->queue[(pool->head + n) % pool->capacity];
+    free(pool->queue);
+    pool->queue = newQueue;
+    pool->capacity = newCapacity;
+    pool->head = 0;
+    return 0;
+}
+
+#endif /* XSUM_MULTITHREAD */
+
+XSUM_API XSUM_pool* XSUM_pool_create(int nbThreads)
+{
+    XSUM_pool* const pool = (XSUM_pool*)calloc(1, sizeof(XSUM_pool));
+    if (pool == NULL) return NULL;
+#if XSUM_MULTITHREAD
+    if (nbThreads > 1) {
+        pool->threads = (XSUM_thread_t*)calloc((size_t)nbThreads, sizeof(XSUM_thread_t));
+        if (pool->threads == NULL) { free(pool); return NULL; }
+        XSUM_mutex_init(&pool->mutex);
+        XSUM_mutex_init(&pool->userMutex);
+        XSUM_cond_init(&pool->jobCond);
+        XSUM_cond_init(&pool->doneCond);
+        /* If the system refuses to create more threads, run with what we got */
+        while (pool->nbThreads < nbThreads
+            && !XSUM_thread_create(&pool->threads[pool->nbThreads], pool)) {
+            pool->nbThreads++;
+        }
+    }
+#else
+    (void)nbThreads;
+#endif
+    return pool;
+}
+
+XSUM_API void XSUM_pool_free(XSUM_pool* pool)
+{
+    if (pool == NULL) return;
+#if XSUM_MULTITHREAD
+    if (pool->threads != NULL) {
+        int t;
+        XSUM_mutex_lock(&pool->mutex);
+        pool->shutdown = 1;
+        XSUM_cond_broadcast(&pool->jobCond);
+        XSUM_mutex_unlock(&pool->mutex);
+        for (t = 0; t < pool->nbThreads; t++)
+            XSUM_thread_join(pool->threads[t]);
+        XSUM_cond_destroy(&pool->doneCond);
+        XSUM_cond_destroy(&pool->jobCond);
+        XSUM_mutex_destroy(&pool->userMutex);
+        XSUM_mutex_destroy(&pool->mutex);
+        free(pool->threads);
+        free(pool->queue);
+    }
+#endif
+    free(pool);
+}
+
+static void XSUM_pool_push(XSUM_pool* pool, XSUM_poolJob_f job, void* opaque, int* completed, int front)
+{
+    if (completed != NULL) *completed = 0;
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) {
+        XSUM_poolJob newJob;
+        newJob.job = job;
+        newJob.opaque = opaque;
+        newJob.completed = completed;
+        XSUM_mutex_lock(&pool->mutex);
+        if (pool->count < pool->capacity || !XSUM_pool_grow(pool)) {
+            if (front) {
+                pool->head = (pool->head + pool->capacity - 1) % pool->capacity;
+                pool->queue[pool->head] = newJob;
+            } else {
+                pool->queue[(pool->head + pool->count) % pool->capacity] = newJob;
+            }
+            pool->count++;
+            XSUM_cond_signal(&pool->jobCond);
+            XSUM_mutex_unlock(&pool->mutex);
+            return;
+        }
+        /* Out of memory for the queue: run the job right here */
+        XSUM_mutex_unlock(&pool->mutex);
+        job(opaque);
+        XSUM_mutex_lock(&pool->mutex);
+        if (completed != NULL) *completed = 1;
+        XSUM_cond_broadcast(&pool->doneCond);
+        XSUM_mutex_unlock(&pool->mutex);
+        return;
+    }
+#endif
+    (void)pool; (void)front;
+    job(opaque);
+    if (completed != NULL) *completed = 1;
+}
+
+XSUM_API void XSUM_pool_add(XSUM_pool* pool, XSUM_poolJob_f job, void* opaque, int* completed)
+{
+    XSUM_pool_push(pool, job, opaque, completed, 0);
+}
+
+XSUM_API void XSUM_pool_addFront(XSUM_pool* pool, XSUM_poolJob_f job, void* opaque, int* completed)
+{
+    XSUM_pool_push(pool, job, opaque, completed, 1);
+}
+
+XSUM_API void XSUM_pool_waitCompleted(XSUM_pool* pool, const int* completed)
+{
+    assert(completed != NULL);
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) {
+        XSUM_mutex_lock(&pool->mutex);
+        while (!*completed)
+            XSUM_cond_wait(&pool->doneCond, &pool->mutex);
+        XSUM_mutex_unlock(&pool->mutex);
+        return;
+    }
+#endif
+    (void)pool;
+    assert(*completed);
+}
+
+/* Returns the index of a completed job among `completed[]`, or `nb` */
+static size_t XSUM_pool_findCompleted(const int* const* completed, size_t nb)
+{
+    size_t n;
+    for (n = 0; n < nb; n++)
+        if (*completed[n]) break;
+    return n;
+}
+
+XSUM_API size_t XSUM_pool_waitAny(XSUM_pool* pool, const int* const* completed, size_t nb)
+{
+    size_t found;
+    assert(nb > 0);
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) {
+        XSUM_mutex_lock(&pool->mutex);
+        while ((found = XSUM_pool_findCompleted(completed, nb)) == nb)
+            XSUM_cond_wait(&pool->doneCond, &pool->mutex);
+        XSUM_mutex_unlock(&pool->mutex);
+        return found;
+    }
+#endif
+    (void)pool;
+    found = XSUM_pool_findCompleted(completed, nb);
+    assert(found < nb);
+    return found;
+}
+
+XSUM_API void XSUM_pool_waitAll(XSUM_pool* pool)
+{
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) {
+        XSUM_mutex_lock(&pool->mutex);
+        while (pool->count > 0 || pool->nbBusy > 0)
+            XSUM_cond_wait(&pool->doneCond, &pool->mutex);
+        XSUM_mutex_unlock(&pool->mutex);
+    }
+#else
+    (void)pool;
+#endif
+}
+
+XSUM_API void XSUM_pool_lock(XSUM_pool* pool)
+{
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) XSUM_mutex_lock(&pool->userMutex);
+#else
+    (void)pool;
+#endif
+}
+
+XSUM_API void XSUM_pool_unlock(XSUM_pool* pool)
+{
+#if XSUM_MULTITHREAD
+    if (pool->nbThreads > 0) XSUM_mutex_unlock(&pool->userMutex);
+#else
+    (void)pool;
+#endif
+}
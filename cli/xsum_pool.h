@@ -0,0 +1,109 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Minimal worker pool used by xxhsum to spread file hashing over several
+ * threads.
+ *
+ * Jobs are kept in a single double-ended queue protected by one mutex:
+ * workers always pick the job at the front, producers choose which end
+ * receives a new job. The cost of a job (opening and reading a file) dwarfs
+ * the cost of the lock, so there is no need for anything more elaborate.
+ *
+ * When the pool has no worker thread (nbThreads <= 1, or XSUM_MULTITHREAD==0),
+ * jobs are run immediately by the caller, so the same code path serves both
+ * the single-threaded and the multi-threaded modes.
+ */
+
+#ifndef XSUM_POOL_H
+#define XSUM_POOL_H
+
+#include "xsum_config.h"
+#include <stddef.h>   /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct XSUM_pool_s XSUM_pool;
+
+typedef void (*XSUM_poolJob_f)(void* opaque);
+
+/*
+ * Creates a pool running jobs on `nbThreads` worker threads.
+ * nbThreads <= 1 creates a pool without thread, running jobs synchronously.
+ * Returns NULL on allocation failure.
+ */
+XSUM_API XSUM_pool* XSUM_pool_create(int nbThreads);
+
+/*
+ * Waits for all queued jobs, then joins the workers and releases the pool.
+ * Accepts NULL.
+ */
+XSUM_API void XSUM_pool_free(XSUM_pool* pool);
+
+/*
+ * Queues `job(opaque)` at the back of the queue.
+ * If `completed` is not NULL, it is set to 0 now, and to 1 once the job has
+ * returned; see XSUM_pool_waitCompleted().
+ * Never blocks: the queue grows as needed. Can be called from within a job.
+ */
+XSUM_API void XSUM_pool_add(XSUM_pool* pool, XSUM_poolJob_f job, void* opaque, int* completed);
+
+/*
+ * Same as XSUM_pool_add(), but the job is queued at the front,
+ * so it is picked before any previously queued job.
+ */
+XSUM_API void XSUM_pool_addFront(XSUM_pool* pool, XSUM_poolJob_f job, void* opaque, int* completed);
+
+/*
+ * Blocks until the job associated with `completed` has returned.
+ */
+XSUM_API void XSUM_pool_waitCompleted(XSUM_pool* pool, const int* completed);
+
+/*
+ * Blocks until at least one of the `nb` jobs associated with `completed[]`
+ * has returned, then returns the index of one which has.
+ */
+XSUM_API size_t XSUM_pool_waitAny(XSUM_pool* pool, const int* const* completed, size_t nb);
+
+/*
+ * Blocks until the queue is empty and all workers are idle,
+ * including jobs queued by other jobs while waiting.
+ */
+XSUM_API void XSUM_pool_waitAll(XSUM_pool* pool);
+
+/*
+ * A mutex reserved to jobs, typically used to serialize output.
+ * No-op for synchronous pools.
+ */
+XSUM_API void XSUM_pool_lock(XSUM_pool* pool);
+XSUM_API void XSUM_pool_unlock(XSUM_pool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_POOL_H */
@@ -0,0 +1,190 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_resume.h"
+#include "xsum_os_specific.h"   /* XSUM_fopen */
+#include "xsum_output.h"        /* XSUM_log */
+#include "../xxhash.h"          /* XXH32, XXH64 */
+#include <stdlib.h>             /* malloc, free */
+#include <string.h>             /* memcpy, memcmp, strlen, strerror */
+#include <stdio.h>              /* FILE, sprintf, rename, remove */
+#include <errno.h>              /* errno */
+
+/*
+ * A state file is named after the XXH64 of the file name, in hexadecimal,
+ * with the suffix ".xst". Its header is stored in little endian order:
+ *
+ *   offset  size  field
+ *        0     8  XSUM_RESUME_MAGIC
+ *        8     4  format version (XSUM_RESUME_VERSION)
+ *       12     4  XXH_VERSION_NUMBER of the writer
+ *       16     4  byte order mark of the state: XSUM_RESUME_BOM, native order
+ *       20     4  state size
+ *       24     8  length
+ *       32     8  guard
+ *       40     8  inode
+ *       48     4  file name length, without terminator
+ *       52     4  XXH32 of the state
+ *
+ * followed by the file name, to detect collisions, then the state.
+ * The state is only returned if its checksum matches: a damaged state could
+ * otherwise resume into a wrong digest, or worse.
+ */
+#define XSUM_RESUME_MAGIC       "XXHSTATE"
+#define XSUM_RESUME_VERSION     2   /* 1: no state checksum */
+#define XSUM_RESUME_BOM         0x01020304U
+#define XSUM_RESUME_HEADER_SIZE 56
+#define XSUM_RESUME_SUFFIX      ".xst"
+
+static void XSUM_resume_writeLE32(unsigned char* p, XSUM_U32 v)
+{
+    p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16); p[3] = (unsigned char)(v >> 24);
+}
+
+static void XSUM_resume_writeLE64(unsigned char* p, XSUM_U64 v)
+{
+    XSUM_resume_writeLE32(p, (XSUM_U32)v);
+    XSUM_resume_writeLE32(p + 4, (XSUM_U32)(v >> 32));
+}
+
+static XSUM_U32 XSUM_resume_readLE32(const unsigned char* p)
+{
+    return (XSUM_U32)p[0] | ((XSUM_U32)p[1] << 8) | ((XSUM_U32)p[2] << 16) | ((XSUM_U32)p[3] << 24);
+}
+
+static XSUM_U64 XSUM_resume_readLE64(const unsigned char* p)
+{
+    return (XSUM_U64)XSUM_resume_readLE32(p) | ((XSUM_U64)XSUM_resume_readLE32(p + 4) << 32);
+}
+
+/* Returns the malloc'ed name of the state file of `fileName`, or NULL */
+static char* XSUM_resume_stateName(const char* stateDir, const char* fileName, const char* suffix)
+{
+    XSUM_U64 const key = XXH64(fileName, strlen(fileName), 0);
+    size_t const dirLen = strlen(stateDir);
+    size_t const nameSize = dirLen + 1 + 16 + strlen(XSUM_RESUME_SUFFIX) + strlen(suffix) + 1;
+    char* const name = (char*)malloc(nameSize);
+    if (name == NULL) return NULL;
+    memcpy(name, stateDir, dirLen);
+    sprintf(name + dirLen, "%s%08x%08x%s%s",
+            (dirLen > 0 && stateDir[dirLen-1] == '/') ? "" : "/",
+            (unsigned)(key >> 32), (unsigned)key, XSUM_RESUME_SUFFIX, suffix);
+    return name;
+}
+
+XSUM_API int XSUM_resume_load(const char* stateDir, const char* fileName,
+                              XSUM_resumePoint* point, void* state, size_t stateSize)
+{
+    char* const stateName = XSUM_resume_stateName(stateDir, fileName, "");
+    size_t const fileNameLen = strlen(fileName);
+    unsigned char header[XSUM_RESUME_HEADER_SIZE];
+    XSUM_U32 bom = 0;
+    int valid = 0;
+    FILE* f;
+
+    if (stateName == NULL) return 0;
+    f = XSUM_fopen(stateName, "rb");
+    free(stateName);
+    if (f == NULL) return 0;
+
+    if ( fread(header, sizeof(header), 1, f) == 1
+      && !memcmp(header, XSUM_RESUME_MAGIC, 8)
+      && XSUM_resume_readLE32(header + 8) == XSUM_RESUME_VERSION
+      && XSUM_resume_readLE32(header + 12) == XXH_VERSION_NUMBER
+      && XSUM_resume_readLE32(header + 20) == stateSize
+      && XSUM_resume_readLE32(header + 48) == fileNameLen ) {
+        memcpy(&bom, header + 16, sizeof(bom));
+        if (bom == XSUM_RESUME_BOM) {
+            char* const storedName = (char*)malloc(fileNameLen + 1);
+            if ( storedName != NULL
+              && fread(storedName, 1, fileNameLen, f) == fileNameLen
+              && !memcmp(storedName, fileName, fileNameLen)
+              && fread(state, stateSize, 1, f) == 1
+              && XXH32(state, stateSize, 0) == XSUM_resume_readLE32(header + 52) ) {
+                point->length = XSUM_resume_readLE64(header + 24);
+                point->guard  = XSUM_resume_readLE64(header + 32);
+                point->inode  = XSUM_resume_readLE64(header + 40);
+                valid = 1;
+            }
+            free(storedName);
+    }   }
+    fclose(f);
+    return valid;
+}
+
+XSUM_API int XSUM_resume_save(const char* stateDir, const char* fileName,
+                              const XSUM_resumePoint* point, const void* state, size_t stateSize)
+{
+    char* const stateName = XSUM_resume_stateName(stateDir, fileName, "");
+    char* const tmpName = XSUM_resume_stateName(stateDir, fileName, ".tmp");
+    size_t const fileNameLen = strlen(fileName);
+    unsigned char header[XSUM_RESUME_HEADER_SIZE];
+    XSUM_U32 const bom = XSUM_RESUME_BOM;
+    int error = 0;
+    FILE* f;
+
+    if (stateName == NULL || tmpName == NULL) {
+        XSUM_log("Error: Out of memory.\n");
+        free(stateName);
+        free(tmpName);
+        return 1;
+    }
+    f = XSUM_fopen(tmpName, "wb");
+    if (f == NULL) {
+        XSUM_log("xxhsum: %s: %s \n", tmpName, strerror(errno));
+        free(stateName);
+        free(tmpName);
+        return 1;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, XSUM_RESUME_MAGIC, 8);
+    XSUM_resume_writeLE32(header + 8, XSUM_RESUME_VERSION);
+    XSUM_resume_writeLE32(header + 12, XXH_VERSION_NUMBER);
+    memcpy(header + 16, &bom, sizeof(bom));
+    XSUM_resume_writeLE32(header + 20, (XSUM_U32)stateSize);
+    XSUM_resume_writeLE64(header + 24, point->length);
+    XSUM_resume_writeLE64(header + 32, point->guard);
+    XSUM_resume_writeLE64(header + 40, point->inode);
+    XSUM_resume_writeLE32(header + 48, (XSUM_U32)fileNameLen);
+    XSUM_resume_writeLE32(header + 52, XXH32(state, stateSize, 0));
+    error |= fwrite(header, sizeof(header), 1, f) != 1;
+    error |= fwrite(fileName, 1, fileNameLen, f) != fileNameLen;
+    error |= fwrite(state, stateSize, 1, f) != 1;
+    error |= fclose(f) != 0;
+
+#if defined(_WIN32)
+    if (!error) remove(stateName);   /* rename() doesn't replace files */
+#endif
+    if (error || rename(tmpName, stateName)) {
+        XSUM_log("xxhsum: %s: Could not save hashing state: %s \n", stateName, strerror(errno));
+        remove(tmpName);
+        error = 1;
+    }
+    free(stateName);
+    free(tmpName);
+    return error;
+}
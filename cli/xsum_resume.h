@@ -0,0 +1,85 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Saved hashing states, for --state-dir.
+ *
+ * Files which only grow, like logs and journals, don't need to be read again
+ * from the start: the streaming state reached at the end of the previous run
+ * is saved, and hashing continues from there when the file is longer.
+ * Each state is kept in its own file of the state directory, named after the
+ * hash of the file name, and replaced atomically.
+ *
+ * Before resuming, the caller must check that the data already hashed is
+ * unchanged: a "guard" digest of the XSUM_RESUME_GUARD_SIZE bytes preceding
+ * the saved length is recorded with the state for this purpose.
+ *
+ * States are opaque bytes to this module, protected by a checksum. They are
+ * only valid for the program which wrote them: a state of another size,
+ * version of xxHash or byte order is ignored. The caller must still check
+ * that the fields it relies on are in range before resuming.
+ */
+
+#ifndef XSUM_RESUME_H
+#define XSUM_RESUME_H
+
+#include "xsum_config.h"
+#include <stddef.h>             /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bytes before the resume point covered by the guard digest */
+#define XSUM_RESUME_GUARD_SIZE (64 * 1024)
+
+typedef struct {
+    XSUM_U64 length;   /* bytes of the file hashed into the state */
+    XSUM_U64 guard;    /* XXH3_64bits of the bytes preceding `length`, up to XSUM_RESUME_GUARD_SIZE */
+    XSUM_U64 inode;    /* of the file, so a replaced file is hashed from its start */
+} XSUM_resumePoint;
+
+/*
+ * Loads the state saved for `fileName` in `stateDir`.
+ * Returns 1 and fills `point` and `stateSize` bytes of `state` on success.
+ * Returns 0 when there is no valid state of this size for `fileName`.
+ * Can be called concurrently for different files.
+ */
+XSUM_API int XSUM_resume_load(const char* stateDir, const char* fileName,
+                              XSUM_resumePoint* point, void* state, size_t stateSize);
+
+/*
+ * Saves `stateSize` bytes of `state`, reached at `point` in `fileName`.
+ * Returns 0 on success, 1 after displaying an error message.
+ * Can be called concurrently for different files.
+ */
+XSUM_API int XSUM_resume_save(const char* stateDir, const char* fileName,
+                              const XSUM_resumePoint* point, const void* state, size_t stateSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_RESUME_H */
@@ -0,0 +1,193 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_stats.h"
+#include "xsum_os_specific.h"   /* XSUM_clockNs, XSUM_cpuTimeNs */
+#include "xsum_output.h"        /* XSUM_log */
+#include <string.h>             /* memset, strcpy */
+#include <stdio.h>              /* sprintf, fflush */
+
+/*
+ * File sizes are counted in buckets growing by powers of 4:
+ * empty, < 1 KB, < 4 KB, ..., < 1 GB, and >= 1 GB.
+ * Files resumed from --state-dir or served from --cache are counted by size,
+ * though little or nothing of them was read.
+ */
+#define XSUM_STATS_BUCKET_MIN 1024
+#define XSUM_STATS_NB_BUCKETS 13
+
+typedef struct {
+    XSUM_U64 startNs;
+    XSUM_U64 startCpuNs;
+    XSUM_U64 nbFiles;
+    XSUM_U64 nbCached;
+    XSUM_fileStats total;
+    XSUM_U64 bucketFiles[XSUM_STATS_NB_BUCKETS];
+    XSUM_U64 bucketBytes[XSUM_STATS_NB_BUCKETS];
+} XSUM_runStats;
+
+int XSUM_statsEnabled = 0;
+static XSUM_runStats XSUM_stats;
+
+static XSUM_U64 XSUM_stats_bucketLimit(int bucket)
+{
+    /* upper bound (excluded) of `bucket`, 0 for the last one */
+    if (bucket == 0) return 1;
+    if (bucket == XSUM_STATS_NB_BUCKETS - 1) return 0;
+    return (XSUM_U64)XSUM_STATS_BUCKET_MIN << (2 * (bucket - 1));
+}
+
+static int XSUM_stats_bucket(XSUM_U64 size)
+{
+    int bucket = 0;
+    while (bucket < XSUM_STATS_NB_BUCKETS - 1 && size >= XSUM_stats_bucketLimit(bucket))
+        bucket++;
+    return bucket;
+}
+
+XSUM_API void XSUM_stats_start(void)
+{
+    memset(&XSUM_stats, 0, sizeof(XSUM_stats));
+    XSUM_stats.startNs = XSUM_clockNs();
+    XSUM_stats.startCpuNs = XSUM_cpuTimeNs();
+}
+
+XSUM_API void XSUM_stats_addFile(const XSUM_fileStats* file, int cached)
+{
+    int n;
+    XSUM_stats.nbFiles++;
+    {   int const bucket = XSUM_stats_bucket(file->size);
+        XSUM_stats.bucketFiles[bucket]++;
+        XSUM_stats.bucketBytes[bucket] += file->size;
+    }
+    if (cached) {
+        XSUM_stats.nbCached++;
+        return;
+    }
+    XSUM_stats.total.bytes += file->bytes;
+    XSUM_stats.total.readNs += file->readNs;
+    for (n = 0; n < XSUM_STATS_ALGO_MAX; n++) {
+        XSUM_stats.total.hashNs[n] += file->hashNs[n];
+        XSUM_stats.total.hashBytes[n] += file->hashBytes[n];
+    }
+}
+
+static double XSUM_stats_seconds(XSUM_U64 ns) { return (double)ns / 1e9; }
+
+/* in GB/s, 0 when nothing was measured */
+static double XSUM_stats_speed(XSUM_U64 bytes, XSUM_U64 ns)
+{
+    return ns ? (double)bytes / (double)ns : 0.;
+}
+
+/* "< 4 KB" and such */
+static void XSUM_stats_bucketName(char* name, int bucket)
+{
+    static const char* const units[] = { "KB", "MB", "GB" };
+    XSUM_U64 const limit = XSUM_stats_bucketLimit(bucket);
+    if (bucket == 0) {
+        strcpy(name, "empty");
+    } else if (limit == 0) {
+        strcpy(name, ">= 1 GB");
+    } else {
+        int unit = 0;
+        XSUM_U64 value = limit / XSUM_STATS_BUCKET_MIN;
+        while (value >= 1024 && unit < 2) { value /= 1024; unit++; }
+        sprintf(name, "< %u %s", (unsigned)value, units[unit]);
+    }
+}
+
+XSUM_API void XSUM_stats_display(int json, const char* const algoNames[], size_t nbAlgos)
+{
+    const XSUM_runStats* const s = &XSUM_stats;
+    XSUM_U64 const wallNs = XSUM_clockNs() - s->startNs;
+    XSUM_U64 const cpuNs = XSUM_cpuTimeNs() - s->startCpuNs;
+    XSUM_U64 hashNs = 0;
+    size_t n;
+    int b;
+
+    for (n = 0; n < nbAlgos && n < XSUM_STATS_ALGO_MAX; n++)
+        hashNs += s->total.hashNs[n];
+    fflush(stdout);   /* after the checksum lines, on a terminal */
+
+    if (json) {
+        const char* separator = "";
+        XSUM_log("{\"files\": %llu, \"cached_files\": %llu, \"bytes\": %llu, "
+                 "\"wall_s\": %.6f, \"cpu_s\": %.6f, \"read_s\": %.6f, \"hash_s\": %.6f, "
+                 "\"read_gbps\": %.3f, \"algorithms\": [",
+                 (unsigned long long)s->nbFiles, (unsigned long long)s->nbCached,
+                 (unsigned long long)s->total.bytes,
+                 XSUM_stats_seconds(wallNs), XSUM_stats_seconds(cpuNs),
+                 XSUM_stats_seconds(s->total.readNs), XSUM_stats_seconds(hashNs),
+                 XSUM_stats_speed(s->total.bytes, s->total.readNs));
+        for (n = 0; n < nbAlgos && n < XSUM_STATS_ALGO_MAX; n++) {
+            if (s->total.hashBytes[n] == 0 && s->total.hashNs[n] == 0) continue;
+            XSUM_log("%s{\"name\": \"%s\", \"bytes\": %llu, \"hash_s\": %.6f, \"gbps\": %.3f}",
+                     separator, algoNames[n], (unsigned long long)s->total.hashBytes[n],
+                     XSUM_stats_seconds(s->total.hashNs[n]),
+                     XSUM_stats_speed(s->total.hashBytes[n], s->total.hashNs[n]));
+            separator = ", ";
+        }
+        XSUM_log("], \"sizes\": [");
+        separator = "";
+        for (b = 0; b < XSUM_STATS_NB_BUCKETS; b++) {
+            XSUM_U64 const limit = XSUM_stats_bucketLimit(b);
+            if (s->bucketFiles[b] == 0) continue;
+            if (limit) {
+                XSUM_log("%s{\"below\": %llu, ", separator, (unsigned long long)limit);
+            } else {
+                XSUM_log("%s{\"below\": null, ", separator);
+            }
+            XSUM_log("\"files\": %llu, \"bytes\": %llu}",
+                     (unsigned long long)s->bucketFiles[b], (unsigned long long)s->bucketBytes[b]);
+            separator = ", ";
+        }
+        XSUM_log("]}\n");
+        return;
+    }
+
+    XSUM_log("xxhsum: %llu files (%llu from cache), %.1f MB read in %.3f s, %.3f s of CPU \n",
+             (unsigned long long)s->nbFiles, (unsigned long long)s->nbCached,
+             (double)s->total.bytes / 1e6, XSUM_stats_seconds(wallNs), XSUM_stats_seconds(cpuNs));
+    XSUM_log("xxhsum: %.3f s reading (%.2f GB/s), %.3f s hashing, summed over threads: %s \n",
+             XSUM_stats_seconds(s->total.readNs), XSUM_stats_speed(s->total.bytes, s->total.readNs),
+             XSUM_stats_seconds(hashNs),
+             (s->total.readNs == 0 && hashNs == 0) ? "nothing read"
+             : (s->total.readNs > hashNs) ? "waiting for data" : "waiting for hash functions");
+    for (n = 0; n < nbAlgos && n < XSUM_STATS_ALGO_MAX; n++) {
+        if (s->total.hashBytes[n] == 0 && s->total.hashNs[n] == 0) continue;
+        XSUM_log("xxhsum: %-8s %.1f MB in %.3f s, %.2f GB/s \n",
+                 algoNames[n], (double)s->total.hashBytes[n] / 1e6,
+                 XSUM_stats_seconds(s->total.hashNs[n]),
+                 XSUM_stats_speed(s->total.hashBytes[n], s->total.hashNs[n]));
+    }
+    for (b = 0; b < XSUM_STATS_NB_BUCKETS; b++) {
+        char name[16];
+        if (s->bucketFiles[b] == 0) continue;
+        XSUM_stats_bucketName(name, b);
+        XSUM_log("xxhsum: %-8s %12llu files %12.1f MB \n", name,
+                 (unsigned long long)s->bucketFiles[b], (double)s->bucketBytes[b] / 1e6);
+    }
+}
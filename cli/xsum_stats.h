@@ -0,0 +1,85 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Run statistics, for --stats.
+ *
+ * Each file accumulates its own counters while it is read and hashed, on any
+ * thread, in an XSUM_fileStats. They are added to the totals of the run once
+ * the file is reported, which is serialized. Timings are taken once per block
+ * of data, never per byte, so that they can stay enabled for every run.
+ *
+ * Read and hash times are summed over all threads: with -T, they can exceed
+ * the wall time. Their ratio tells whether a run waits for its data or for
+ * its hash functions; the read throughput tells a page cache (several GB/s)
+ * from a disk.
+ */
+
+#ifndef XSUM_STATS_H
+#define XSUM_STATS_H
+
+#include "xsum_config.h"
+#include <stddef.h>             /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* largest number of algorithms measured separately */
+#define XSUM_STATS_ALGO_MAX 4
+
+typedef struct {
+    XSUM_U64 size;                             /* of the file; bytes read from a pipe */
+    XSUM_U64 bytes;                            /* read from the file */
+    XSUM_U64 readNs;                           /* blocked in open and read */
+    XSUM_U64 hashNs[XSUM_STATS_ALGO_MAX];      /* in hash functions, per algorithm */
+    XSUM_U64 hashBytes[XSUM_STATS_ALGO_MAX];   /* hashed, per algorithm */
+} XSUM_fileStats;
+
+/* Set by --stats: files are measured when non-zero */
+extern int XSUM_statsEnabled;
+
+/*
+ * Starts the clocks of the run.
+ */
+XSUM_API void XSUM_stats_start(void);
+
+/*
+ * Adds a file to the totals of the run. `cached` files were not read.
+ * Calls must be serialized by the caller.
+ */
+XSUM_API void XSUM_stats_addFile(const XSUM_fileStats* file, int cached);
+
+/*
+ * Displays the totals of the run on stderr, as text or as a JSON object.
+ * `algoNames[n]` names the algorithm measured in `hashNs[n]`.
+ */
+XSUM_API void XSUM_stats_display(int json, const char* const algoNames[], size_t nbAlgos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_STATS_H */
@@ -0,0 +1,400 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_tar.h"
+#include "xsum_output.h"   /* XSUM_log */
+#include <stdlib.h>        /* malloc, free */
+#include <string.h>        /* memcpy, memcmp, memchr, strlen, strerror */
+#include <errno.h>         /* errno */
+
+/*
+ * Archives are sequences of 512-byte blocks. Each member starts with a
+ * header block, followed by its content, padded to a whole number of blocks.
+ * The archive ends with blocks of zeroes.
+ *
+ * Header fields used, as offset / size:
+ *   name      0 / 100    NUL terminated, unless 100 bytes long
+ *   size    124 / 12     octal, or big endian binary if the first byte has its
+ *                        high bit set (GNU, for sizes of 8 GB and more)
+ *   chksum  148 / 8      octal sum of the header bytes, chksum counted as spaces
+ *   type    156 / 1      '0' or NUL: regular file, '7': contiguous file,
+ *                        'L': GNU long name of the next member,
+ *                        'x': pax records for the next member, 'g': global pax records
+ *   magic   257 / 6      "ustar" NUL for POSIX, "ustar " for GNU
+ *   prefix  345 / 155    POSIX only: directory prepended to the name
+ *   extended 482 / 1     GNU sparse only: sparse map continues in the next
+ *                        block, itself extended if its byte 504 is set
+ */
+#define XSUM_TAR_BLOCK_SIZE  512
+#define XSUM_TAR_NAME_MAX    (1 << 20)   /* largest long name or pax header accepted */
+
+struct XSUM_tar_s {
+    FILE*         stream;
+    const char*   archiveName;
+    XSUM_U64      remaining;   /* content bytes left in the current member */
+    XSUM_U64      padding;     /* bytes after them, up to the next header */
+    char*         nextName;    /* from a GNU long name or pax header, can be NULL */
+    int           hasNextSize;
+    XSUM_U64      nextSize;    /* from a pax header, valid if hasNextSize */
+    int           nextIsSparse;   /* pax header with GNU.sparse records */
+    char*         name;        /* of the current member */
+    int           failed;
+    int           ended;
+    unsigned char block[XSUM_TAR_BLOCK_SIZE];
+};
+
+static void XSUM_tar_fail(XSUM_tar* tar, const char* msg)
+{
+    if (!tar->failed)
+        XSUM_log("xxhsum: %s: %s \n", tar->archiveName, msg);
+    tar->failed = 1;
+}
+
+static int XSUM_tar_readFull(XSUM_tar* tar, void* buffer, size_t size)
+{
+    if (fread(buffer, 1, size, tar->stream) != size) {
+        XSUM_tar_fail(tar, ferror(tar->stream) ? strerror(errno) : "Truncated archive");
+        return -1;
+    }
+    return 0;
+}
+
+static int XSUM_tar_skip(XSUM_tar* tar, XSUM_U64 size)
+{
+    while (size > 0) {
+        size_t const toSkip = (size < XSUM_TAR_BLOCK_SIZE) ? (size_t)size : XSUM_TAR_BLOCK_SIZE;
+        if (XSUM_tar_readFull(tar, tar->block, toSkip)) return -1;
+        size -= toSkip;
+    }
+    return 0;
+}
+
+/* Returns 0 on success, -1 if the field is not a valid number */
+static int XSUM_tar_parseNumber(const unsigned char* field, size_t size, XSUM_U64* value)
+{
+    size_t n = 0;
+    *value = 0;
+    if (field[0] & 0x80) {
+        /* base-256, negative values are not valid sizes */
+        if (field[0] & 0x40) return -1;
+        *value = field[0] & 0x3F;
+        for (n = 1; n < size; n++) {
+            if (*value >> 56) return -1;
+            *value = (*value << 8) | field[n];
+        }
+        return 0;
+    }
+    while (n < size && field[n] == ' ') n++;
+    if (n == size || field[n] < '0' || field[n] > '7') return -1;
+    while (n < size && field[n] >= '0' && field[n] <= '7') {
+        if (*value >> 61) return -1;
+        *value = (*value << 3) | (XSUM_U64)(field[n] - '0');
+        n++;
+    }
+    /* terminated by spaces or NULs */
+    for (; n < size; n++) {
+        if (field[n] != ' ' && field[n] != 0) return -1;
+    }
+    return 0;
+}
+
+static int XSUM_tar_checksumIsValid(const unsigned char* block)
+{
+    XSUM_U64 expected;
+    XSUM_U64 sumUnsigned = 0;
+    long sumSigned = 0;   /* some historic implementations summed signed chars */
+    size_t n;
+    if (XSUM_tar_parseNumber(block + 148, 8, &expected)) return 0;
+    for (n = 0; n < XSUM_TAR_BLOCK_SIZE; n++) {
+        unsigned char const c = (n >= 148 && n < 156) ? ' ' : block[n];
+        sumUnsigned += c;
+        sumSigned += (c < 128) ? (long)c : (long)c - 256;
+    }
+    return (expected == sumUnsigned) || ((long)expected == sumSigned);
+}
+
+/* Reads the content of the current header's member, as a NUL terminated string */
+static char* XSUM_tar_readString(XSUM_tar* tar, XSUM_U64 size)
+{
+    XSUM_U64 const padding = (XSUM_TAR_BLOCK_SIZE - size % XSUM_TAR_BLOCK_SIZE) % XSUM_TAR_BLOCK_SIZE;
+    char* str;
+    if (size > XSUM_TAR_NAME_MAX) {
+        XSUM_tar_fail(tar, "Extended header too large");
+        return NULL;
+    }
+    str = (char*)malloc((size_t)size + 1);
+    if (str == NULL) {
+        XSUM_tar_fail(tar, "Out of memory");
+        return NULL;
+    }
+    if (XSUM_tar_readFull(tar, str, (size_t)size) || XSUM_tar_skip(tar, padding)) {
+        free(str);
+        return NULL;
+    }
+    str[size] = 0;
+    return str;
+}
+
+static size_t XSUM_tar_strnlen(const char* str, size_t maxSize)
+{
+    const char* const end = (const char*)memchr(str, 0, maxSize);
+    return (end == NULL) ? maxSize : (size_t)(end - str);
+}
+
+static char* XSUM_tar_strndup(const char* str, size_t size)
+{
+    char* const copy = (char*)malloc(size + 1);
+    if (copy == NULL) return NULL;
+    memcpy(copy, str, size);
+    copy[size] = 0;
+    return copy;
+}
+
+/*
+ * pax records are "<length> <key>=<value>\n", <length> counting the whole record.
+ * Only path and size are used, and GNU.sparse records detected,
+ * other records are ignored.
+ */
+static int XSUM_tar_parsePax(XSUM_tar* tar, const char* records, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size) {
+        size_t length = 0, n = pos;
+        const char* key;
+        const char* value;
+        const char* end;
+        while (n < size && records[n] >= '0' && records[n] <= '9') {
+            length = length * 10 + (size_t)(records[n] - '0');
+            if (length > size) break;
+            n++;
+        }
+        if (n == pos || n >= size || records[n] != ' '
+          || length <= n - pos || length > size - pos || records[pos + length - 1] != '\n') {
+            XSUM_tar_fail(tar, "Invalid pax extended header");
+            return -1;
+        }
+        key = records + n + 1;
+        end = records + pos + length - 1;
+        value = (const char*)memchr(key, '=', (size_t)(end - key));
+        if (value == NULL) {
+            XSUM_tar_fail(tar, "Invalid pax extended header");
+            return -1;
+        }
+        value++;
+        if ((size_t)(value - key) == 5 && !memcmp(key, "path=", 5)) {
+            free(tar->nextName);
+            tar->nextName = XSUM_tar_strndup(value, (size_t)(end - value));
+            if (tar->nextName == NULL) {
+                XSUM_tar_fail(tar, "Out of memory");
+                return -1;
+            }
+        } else if ((size_t)(value - key) == 5 && !memcmp(key, "size=", 5)) {
+            XSUM_U64 nextSize = 0;
+            const char* p;
+            if (value == end) {
+                XSUM_tar_fail(tar, "Invalid pax extended header");
+                return -1;
+            }
+            for (p = value; p < end; p++) {
+                if (*p < '0' || *p > '9' || nextSize > (XSUM_U64)-1 / 10 - 1) {
+                    XSUM_tar_fail(tar, "Invalid pax extended header");
+                    return -1;
+                }
+                nextSize = nextSize * 10 + (XSUM_U64)(*p - '0');
+            }
+            tar->nextSize = nextSize;
+            tar->hasNextSize = 1;
+        } else if ((size_t)(end - key) > 11 && !memcmp(key, "GNU.sparse.", 11)) {
+            tar->nextIsSparse = 1;
+        }
+        pos += length;
+    }
+    return 0;
+}
+
+/* Name of the member described by the current header */
+static char* XSUM_tar_memberName(XSUM_tar* tar)
+{
+    const char* const name = (const char*)tar->block;
+    const char* const prefix = (const char*)tar->block + 345;
+    size_t const nameSize = XSUM_tar_strnlen(name, 100);
+    size_t prefixSize = 0;
+    char* fullName;
+    if (tar->nextName != NULL) {
+        fullName = tar->nextName;
+        tar->nextName = NULL;
+        return fullName;
+    }
+    if (!memcmp(tar->block + 257, "ustar\0", 6))
+        prefixSize = XSUM_tar_strnlen(prefix, 155);
+    fullName = (char*)malloc(prefixSize + 1 + nameSize + 1);
+    if (fullName == NULL) {
+        XSUM_tar_fail(tar, "Out of memory");
+        return NULL;
+    }
+    if (prefixSize > 0) {
+        memcpy(fullName, prefix, prefixSize);
+        fullName[prefixSize++] = '/';
+    }
+    memcpy(fullName + prefixSize, name, nameSize);
+    fullName[prefixSize + nameSize] = 0;
+    return fullName;
+}
+
+XSUM_API XSUM_tar* XSUM_tar_create(FILE* stream, const char* archiveName)
+{
+    XSUM_tar* const tar = (XSUM_tar*)calloc(1, sizeof(XSUM_tar));
+    if (tar == NULL) return NULL;
+    tar->stream = stream;
+    tar->archiveName = archiveName;
+    return tar;
+}
+
+XSUM_API const char* XSUM_tar_next(XSUM_tar* tar, XSUM_U64* size)
+{
+    free(tar->name);
+    tar->name = NULL;
+    if (tar->failed || tar->ended) return NULL;
+    if (XSUM_tar_skip(tar, tar->remaining + tar->padding)) return NULL;
+    tar->remaining = tar->padding = 0;
+
+    for (;;) {
+        XSUM_U64 memberSize;
+        XSUM_U64 padding;
+        int type;
+        size_t const readSize = fread(tar->block, 1, XSUM_TAR_BLOCK_SIZE, tar->stream);
+        if (readSize == 0 && !ferror(tar->stream)) {
+            /* end of file without end blocks: tolerated, like tar does */
+            tar->ended = 1;
+            return NULL;
+        }
+        if (readSize != XSUM_TAR_BLOCK_SIZE) {
+            XSUM_tar_fail(tar, ferror(tar->stream) ? strerror(errno) : "Truncated archive");
+            return NULL;
+        }
+        {   size_t n = 0;
+            while (n < XSUM_TAR_BLOCK_SIZE && tar->block[n] == 0) n++;
+            if (n == XSUM_TAR_BLOCK_SIZE) {
+                /* end of archive: the rest is not read */
+                tar->ended = 1;
+                return NULL;
+        }   }
+        if (!XSUM_tar_checksumIsValid(tar->block) || XSUM_tar_parseNumber(tar->block + 124, 12, &memberSize)) {
+            XSUM_tar_fail(tar, "Not a valid tar archive");
+            return NULL;
+        }
+        type = tar->block[156];
+        padding = (XSUM_TAR_BLOCK_SIZE - memberSize % XSUM_TAR_BLOCK_SIZE) % XSUM_TAR_BLOCK_SIZE;
+
+        switch (type)
+        {
+        case 'L':   /* GNU long name */
+            free(tar->nextName);
+            tar->nextName = XSUM_tar_readString(tar, memberSize);
+            if (tar->nextName == NULL) return NULL;
+            continue;
+        case 'x':   /* pax extended header */
+            {   char* const records = XSUM_tar_readString(tar, memberSize);
+                int const failed = (records == NULL) || XSUM_tar_parsePax(tar, records, (size_t)memberSize);
+                free(records);
+                if (failed) return NULL;
+                continue;
+            }
+        case '0':
+        case '7':
+        case 0:
+            if (tar->hasNextSize) memberSize = tar->nextSize;
+            padding = (XSUM_TAR_BLOCK_SIZE - memberSize % XSUM_TAR_BLOCK_SIZE) % XSUM_TAR_BLOCK_SIZE;
+            tar->hasNextSize = 0;
+            tar->name = XSUM_tar_memberName(tar);
+            if (tar->name == NULL) return NULL;
+            if (tar->nextIsSparse) {
+                /* content is a sparse map followed by data blocks */
+                XSUM_log("xxhsum: %s: %s: sparse member skipped \n", tar->archiveName, tar->name);
+                tar->nextIsSparse = 0;
+                free(tar->name);
+                tar->name = NULL;
+                if (XSUM_tar_skip(tar, memberSize + padding)) return NULL;
+                continue;
+            }
+            if (type == 0 && tar->name[0] != 0 && tar->name[strlen(tar->name) - 1] == '/') {
+                /* pre-POSIX directory */
+                free(tar->name);
+                tar->name = NULL;
+                if (XSUM_tar_skip(tar, memberSize + padding)) return NULL;
+                continue;
+            }
+            tar->remaining = memberSize;
+            tar->padding = padding;
+            *size = memberSize;
+            return tar->name;
+        case 'S':   /* GNU sparse file: not hashed */
+            {   char* const name = XSUM_tar_memberName(tar);
+                int extended = tar->block[482];
+                if (name == NULL) return NULL;
+                XSUM_log("xxhsum: %s: %s: sparse member skipped \n", tar->archiveName, name);
+                free(name);
+                while (extended) {
+                    if (XSUM_tar_readFull(tar, tar->block, XSUM_TAR_BLOCK_SIZE)) return NULL;
+                    extended = tar->block[504];
+            }   }
+            break;
+        default:    /* links, directories, devices, global pax headers... */
+            /* pax records only apply to the next member */
+            free(tar->nextName);
+            tar->nextName = NULL;
+            break;
+        }
+        tar->hasNextSize = 0;
+        tar->nextIsSparse = 0;
+        if (XSUM_tar_skip(tar, memberSize + padding)) return NULL;
+    }
+}
+
+XSUM_API size_t XSUM_tar_read(XSUM_tar* tar, void* buffer, size_t size)
+{
+    size_t readSize;
+    if (tar->failed) return 0;
+    if (size > tar->remaining) size = (size_t)tar->remaining;
+    if (size == 0) return 0;
+    readSize = fread(buffer, 1, size, tar->stream);
+    tar->remaining -= readSize;
+    if (readSize < size)
+        XSUM_tar_fail(tar, ferror(tar->stream) ? strerror(errno) : "Truncated archive");
+    return readSize;
+}
+
+XSUM_API int XSUM_tar_failed(const XSUM_tar* tar)
+{
+    return tar->failed;
+}
+
+XSUM_API void XSUM_tar_free(XSUM_tar* tar)
+{
+    if (tar == NULL) return;
+    free(tar->nextName);
+    free(tar->name);
+    free(tar);
+}
@@ -0,0 +1,78 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Sequential reader of tar archives, for --tar.
+ *
+ * Understands POSIX ustar headers, GNU long names and numbers, and pax
+ * extended headers (path and size records). Headers and padding are consumed
+ * as the stream goes by, so the archive is read once, from start to end,
+ * and can be a pipe. Only regular file members are returned, their content
+ * being read directly into the caller's buffer.
+ */
+
+#ifndef XSUM_TAR_H
+#define XSUM_TAR_H
+
+#include "xsum_config.h"
+#include <stdio.h>    /* FILE */
+#include <stddef.h>   /* size_t */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct XSUM_tar_s XSUM_tar;
+
+/*
+ * Starts reading the archive `stream`, named `archiveName` in error messages.
+ * Returns NULL on allocation failure.
+ */
+XSUM_API XSUM_tar* XSUM_tar_create(FILE* stream, const char* archiveName);
+
+/*
+ * Skips the rest of the current member, then moves to the next regular file.
+ * Returns its path, valid until the next call, and sets `*size`.
+ * Returns NULL at the end of the archive, or after displaying an error
+ * message, in which case XSUM_tar_failed() is non-zero.
+ */
+XSUM_API const char* XSUM_tar_next(XSUM_tar* tar, XSUM_U64* size);
+
+/*
+ * Reads up to `size` bytes of the content of the current member.
+ * Returns the number of bytes read, 0 at the end of the member or on error.
+ */
+XSUM_API size_t XSUM_tar_read(XSUM_tar* tar, void* buffer, size_t size);
+
+XSUM_API int XSUM_tar_failed(const XSUM_tar* tar);
+
+/* Accepts NULL */
+XSUM_API void XSUM_tar_free(XSUM_tar* tar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_TAR_H */
@@ -0,0 +1,243 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+#include "xsum_watch.h"
+#include <errno.h>    /* errno, ENOSYS */
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+
+#include "xsum_os_specific.h"   /* XSUM_openDir, XSUM_pathJoin */
+#include <stdlib.h>             /* malloc, realloc, free */
+#include <string.h>             /* memcpy, memset, strlen, strncmp */
+#include <poll.h>               /* poll */
+#include <unistd.h>             /* read, close */
+#include <sys/inotify.h>        /* inotify_init1, inotify_add_watch */
+
+/* IN_MODIFY catches files which are kept open, IN_CLOSE_WRITE the end of writes */
+#define XSUM_WATCH_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE \
+                       | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW)
+
+#define XSUM_WATCH_BUFFER_SIZE (64 * 1024)
+
+struct XSUM_watch_s {
+    int     fd;
+    char**  dirs;          /* watched directory of each watch descriptor, or NULL */
+    size_t  nbDirs;
+    size_t  bufferSize;
+    size_t  bufferPos;
+    char*   path;          /* last path returned */
+    union {
+        struct inotify_event event;   /* alignment */
+        char bytes[XSUM_WATCH_BUFFER_SIZE];
+    } buffer;
+};
+
+XSUM_API XSUM_watch* XSUM_watch_create(void)
+{
+    XSUM_watch* const watch = (XSUM_watch*)calloc(1, sizeof(XSUM_watch));
+    if (watch == NULL) return NULL;
+    watch->fd = inotify_init1(IN_CLOEXEC);
+    if (watch->fd < 0) {
+        int const errorNb = errno;
+        free(watch);
+        errno = errorNb;
+        return NULL;
+    }
+    return watch;
+}
+
+/* Records that `wd` watches `dirName`, which is copied */
+static int XSUM_watch_setDir(XSUM_watch* watch, int wd, const char* dirName)
+{
+    size_t const index = (size_t)wd;
+    size_t const size = strlen(dirName) + 1;
+    char* const copy = (char*)malloc(size);
+    if (copy == NULL) return -1;
+    memcpy(copy, dirName, size);
+    if (index >= watch->nbDirs) {
+        size_t const newNbDirs = (index + 1) * 2;
+        char** const newDirs = (char**)realloc(watch->dirs, newNbDirs * sizeof(char*));
+        if (newDirs == NULL) {
+            free(copy);
+            return -1;
+        }
+        memset(newDirs + watch->nbDirs, 0, (newNbDirs - watch->nbDirs) * sizeof(char*));
+        watch->dirs = newDirs;
+        watch->nbDirs = newNbDirs;
+    }
+    free(watch->dirs[index]);
+    watch->dirs[index] = copy;
+    return 0;
+}
+
+XSUM_API int XSUM_watch_addTree(XSUM_watch* watch, const char* dirName)
+{
+    int const wd = inotify_add_watch(watch->fd, dirName, XSUM_WATCH_MASK);
+    if (wd < 0) return -1;
+    if (XSUM_watch_setDir(watch, wd, dirName)) {
+        errno = ENOMEM;
+        return -1;
+    }
+    {   XSUM_dir* const dir = XSUM_openDir(dirName);
+        const char* name;
+        XSUM_fileType type;
+        if (dir == NULL) return 0;   /* removed meanwhile */
+        while ((name = XSUM_readDir(dir, &type)) != NULL) {
+            char* const path = XSUM_pathJoin(dirName, name);
+            if (path == NULL) break;
+            if (type == XSUM_fileType_unknown) type = XSUM_getLinkType(path);
+            /* subdirectories which can't be watched are simply not followed */
+            if (type == XSUM_fileType_directory) (void)XSUM_watch_addTree(watch, path);
+            free(path);
+        }
+        XSUM_closeDir(dir);
+    }
+    return 0;
+}
+
+/* Stops watching `dirName` and the directories below it */
+static void XSUM_watch_forgetTree(XSUM_watch* watch, const char* dirName)
+{
+    size_t const len = strlen(dirName);
+    size_t wd;
+    for (wd = 0; wd < watch->nbDirs; wd++) {
+        const char* const dir = watch->dirs[wd];
+        if ( dir != NULL && !strncmp(dir, dirName, len)
+          && (dir[len] == '\0' || dir[len] == '/') ) {
+            (void)inotify_rm_watch(watch->fd, (int)wd);
+            free(watch->dirs[wd]);
+            watch->dirs[wd] = NULL;
+    }   }
+}
+
+XSUM_API int XSUM_watch_next(XSUM_watch* watch, int timeoutMs,
+                             XSUM_watchEventType* type, const char** path)
+{
+    for (;;) {
+        while (watch->bufferPos < watch->bufferSize) {
+            const struct inotify_event* const event =
+                (const struct inotify_event*)(const void*)(watch->buffer.bytes + watch->bufferPos);
+            size_t const wd = (size_t)event->wd;
+            watch->bufferPos += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                *type = XSUM_watchEvent_overflow;
+                *path = NULL;
+                return 1;
+            }
+            if (event->wd < 0 || wd >= watch->nbDirs || watch->dirs[wd] == NULL) continue;
+            if (event->mask & IN_IGNORED) {   /* the directory is gone */
+                free(watch->dirs[wd]);
+                watch->dirs[wd] = NULL;
+                continue;
+            }
+            if (event->len == 0) continue;   /* about the directory itself */
+
+            free(watch->path);
+            watch->path = XSUM_pathJoin(watch->dirs[wd], event->name);
+            if (watch->path == NULL) {
+                errno = ENOMEM;
+                return -1;
+            }
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    (void)XSUM_watch_addTree(watch, watch->path);
+                    *type = XSUM_watchEvent_dirAdded;
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    if (event->mask & IN_MOVED_FROM) XSUM_watch_forgetTree(watch, watch->path);
+                    *type = XSUM_watchEvent_dirRemoved;
+                } else {
+                    continue;
+                }
+            } else {
+                *type = XSUM_watchEvent_file;
+            }
+            *path = watch->path;
+            return 1;
+        }
+
+        {   struct pollfd pfd;
+            int ready;
+            ssize_t readSize;
+            pfd.fd = watch->fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            ready = poll(&pfd, 1, timeoutMs < 0 ? -1 : timeoutMs);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (ready == 0) return 0;
+            readSize = read(watch->fd, watch->buffer.bytes, sizeof(watch->buffer.bytes));
+            if (readSize < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            watch->bufferSize = (size_t)readSize;
+            watch->bufferPos = 0;
+    }   }
+}
+
+XSUM_API void XSUM_watch_free(XSUM_watch* watch)
+{
+    size_t wd;
+    if (watch == NULL) return;
+    close(watch->fd);
+    for (wd = 0; wd < watch->nbDirs; wd++)
+        free(watch->dirs[wd]);
+    free(watch->dirs);
+    free(watch->path);
+    free(watch);
+}
+
+#else  /* no change notification */
+
+XSUM_API XSUM_watch* XSUM_watch_create(void)
+{
+    errno = ENOSYS;
+    return NULL;
+}
+
+XSUM_API int XSUM_watch_addTree(XSUM_watch* watch, const char* dirName)
+{
+    (void)watch; (void)dirName;
+    errno = ENOSYS;
+    return -1;
+}
+
+XSUM_API int XSUM_watch_next(XSUM_watch* watch, int timeoutMs,
+                             XSUM_watchEventType* type, const char** path)
+{
+    (void)watch; (void)timeoutMs; (void)type; (void)path;
+    errno = ENOSYS;
+    return -1;
+}
+
+XSUM_API void XSUM_watch_free(XSUM_watch* watch)
+{
+    (void)watch;
+}
+
+#endif
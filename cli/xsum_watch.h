@@ -0,0 +1,79 @@
+/*
+ * xxhsum - Command line interface for xxhash algorithms
+ * Copyright (C) 2013-2023 Yann Collet
+ *
+ * GPL v2 License
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * You can contact the author at:
+ *   - xxHash homepage: https://www.xxhash.com
+ *   - xxHash source repository: https://github.com/Cyan4973/xxHash
+ */
+
+/*
+ * Change notifications for a directory tree, for --watch.
+ *
+ * Based on inotify on Linux: every directory of the tree is watched,
+ * including those created later. Elsewhere, XSUM_watch_create() fails
+ * with errno set to ENOSYS.
+ */
+
+#ifndef XSUM_WATCH_H
+#define XSUM_WATCH_H
+
+#include "xsum_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct XSUM_watch_s XSUM_watch;
+
+typedef enum {
+    XSUM_watchEvent_file,        /* a file was written, created, moved or removed */
+    XSUM_watchEvent_dirAdded,    /* a directory was created or moved in, and is now watched */
+    XSUM_watchEvent_dirRemoved,  /* a directory was removed or moved out */
+    XSUM_watchEvent_overflow     /* events were lost: everything may have changed */
+} XSUM_watchEventType;
+
+/*
+ * Returns NULL on failure, with errno set.
+ */
+XSUM_API XSUM_watch* XSUM_watch_create(void);
+
+/*
+ * Watches `dirName` and all the directories below it.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+XSUM_API int XSUM_watch_addTree(XSUM_watch* watch, const char* dirName);
+
+/*
+ * Waits up to `timeoutMs` milliseconds (forever if negative) for an event.
+ * Returns 1 and sets `*type` and `*path`, valid until the next call,
+ * 0 on timeout, or -1 on failure with errno set.
+ * Paths are built from the name given to XSUM_watch_addTree().
+ */
+XSUM_API int XSUM_watch_next(XSUM_watch* watch, int timeoutMs,
+                             XSUM_watchEventType* type, const char** path);
+
+/* Accepts NULL */
+XSUM_API void XSUM_watch_free(XSUM_watch* watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSUM_WATCH_H */
@@ -35,7 +35,21 @@
 #include "xsum_output.h"       /* XSUM_output */
 #include "xsum_sanity_check.h" /* XSUM_sanityCheck */
 #include "xsum_bench.h"        /* NBLOOPS_DEFAULT */
+#include "xsum_pool.h"         /* XSUM_pool_create */
+#include "xsum_cache.h"        /* XSUM_cache_lookup */
+#include "xsum_tar.h"          /* XSUM_tar_next */
+#include "xsum_index.h"        /* XSUM_index_find */
+#include "xsum_watch.h"        /* XSUM_watch_next */
+#include "xsum_resume.h"       /* XSUM_resume_load */
+#include "xsum_stats.h"        /* XSUM_stats_addFile */
 #ifdef XXH_INLINE_ALL
+#  include "xsum_pool.c"
+#  include "xsum_cache.c"
+#  include "xsum_tar.c"
+#  include "xsum_index.c"
+#  include "xsum_watch.c"
+#  include "xsum_resume.c"
+#  include "xsum_stats.c"
 #  include "xsum_os_specific.c"
 #  include "xsum_output.c"
 #  include "xsum_sanity_check.c"
@@ -49,6 +63,7 @@
 #include <string.h>     /* strerror, strcmp, memcpy */
 #include <assert.h>     /* assert */
 #include <errno.h>      /* errno */
+#include <time.h>       /* time */
 
 #define XXH_STATIC_LINKING_ONLY   /* *_state_t */
 #include "../xxhash.h"
@@ -99,6 +114,9 @@ typedef enum {
 /* Maximum acceptable line length. */
 #define MAX_LINE_LENGTH (32 KB)
 
+/* --disk-order: number of files sorted by position at once */
+#define XSUM_DISK_ORDER_DEFAULT 1024
+
 static size_t XSUM_DEFAULT_SAMPLE_SIZE = 100 KB;
 
 
@@ -212,6 +230,37 @@ static int XSUM_algoBitmask_Accepts(XSUM_U32 algoBitmask, AlgoSelected parsedLin
 }
 
 
+/* ********************************************************
+*  Algorithm List
+**********************************************************/
+#define XSUM_ALGO_MAX 4   /* number of AlgoSelected values */
+#if XSUM_STATS_ALGO_MAX < XSUM_ALGO_MAX
+#  error "XSUM_fileStats must hold all algorithms"
+#endif
+
+/* Algorithms selected with -H, in display order, without duplicates */
+typedef struct {
+    AlgoSelected algos[XSUM_ALGO_MAX];
+    int          nbAlgos;
+} AlgoList;
+
+static void XSUM_algoList_add(AlgoList* list, AlgoSelected algo) {
+    int n;
+    for (n = 0; n < list->nbAlgos; n++)
+        if (list->algos[n] == algo) return;
+    assert(list->nbAlgos < XSUM_ALGO_MAX);
+    list->algos[list->nbAlgos++] = algo;
+}
+
+static XSUM_U32 XSUM_algoList_bitmask(const AlgoList* list) {
+    XSUM_U32 algoBitmask = 0;
+    int n;
+    for (n = 0; n < list->nbAlgos; n++)
+        algoBitmask |= XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected(list->algos[n]);
+    return algoBitmask;
+}
+
+
 /* ********************************************************
 *  File Hashing
 **********************************************************/
@@ -219,21 +268,37 @@ static int XSUM_algoBitmask_Accepts(XSUM_U32 algoBitmask, AlgoSelected parsedLin
 #define XXHSUM32_DEFAULT_SEED 0                   /* Default seed for algo_xxh32 */
 #define XXHSUM64_DEFAULT_SEED 0                   /* Default seed for algo_xxh64 */
 
+/*
+ * Digests are displayed one hex string at a time, rather than one byte:
+ * on trees of small files, formatted output costs more than hashing.
+ */
+#define XSUM_HEX_CHUNK 16   /* bytes per XSUM_output() call */
+
+static void XSUM_display_hex(const XSUM_U8* p, size_t length, int littleEndian)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    char hex[2 * XSUM_HEX_CHUNK + 1];
+    size_t idx, pos = 0;
+    for (idx=0; idx<length; idx++) {
+        XSUM_U8 const byte = littleEndian ? p[length-1-idx] : p[idx];
+        hex[pos++] = hexDigits[byte >> 4];
+        hex[pos++] = hexDigits[byte & 15];
+        if (pos == 2 * XSUM_HEX_CHUNK || idx == length-1) {
+            hex[pos] = 0;
+            XSUM_output("%s", hex);
+            pos = 0;
+    }   }
+}
+
 /* for support of --little-endian display mode */
 static void XSUM_display_LittleEndian(const void* ptr, size_t length)
 {
-    const XSUM_U8* const p = (const XSUM_U8*)ptr;
-    size_t idx;
-    for (idx=length-1; idx<length; idx--)    /* intentional underflow to negative to detect end */
-        XSUM_output("%02x", p[idx]);
+    XSUM_display_hex((const XSUM_U8*)ptr, length, 1);
 }
 
 static void XSUM_display_BigEndian(const void* ptr, size_t length)
 {
-    const XSUM_U8* const p = (const XSUM_U8*)ptr;
-    size_t idx;
-    for (idx=0; idx<length; idx++)
-        XSUM_output("%02x", p[idx]);
+    XSUM_display_hex((const XSUM_U8*)ptr, length, 0);
 }
 
 typedef union {
@@ -243,70 +308,271 @@ typedef union {
 } Multihash;
 
 /*
- * XSUM_hashStream:
- * Reads data from `inFile`, generating an incremental hash of type hashType,
- * using `buffer` of size `blockSize` for temporary storage.
+ * Incremental hashing with every algorithm of `algoBitmask` at once.
  */
-static Multihash
-XSUM_hashStream(FILE* inFile,
-                AlgoSelected hashType,
-                void* buffer, size_t blockSize)
-{
+typedef struct {
+    XSUM_U32      algoBitmask;
     XXH32_state_t state32;
     XXH64_state_t state64;
     XXH3_state_t  state3;
+    XXH3_state_t  state128;
+    XSUM_fileStats* stats;   /* --stats, can be NULL */
+} MultihashState;
 
-    /* Init */
-    (void)XXH32_reset(&state32, XXHSUM32_DEFAULT_SEED);
-    (void)XXH64_reset(&state64, XXHSUM64_DEFAULT_SEED);
-    (void)XXH3_128bits_reset(&state3);
+/* Accounts for the time since `*lap` in hashing `size` bytes with `algo` */
+static void XSUM_statsLap(XSUM_fileStats* stats, AlgoSelected algo, size_t size, XSUM_U64* lap)
+{
+    XSUM_U64 const now = XSUM_clockNs();
+    stats->hashNs[algo] += now - *lap;
+    stats->hashBytes[algo] += size;
+    *lap = now;
+}
 
-    /* Load file & update hash */
-    {   size_t readSize;
-        while ((readSize = fread(buffer, 1, blockSize, inFile)) > 0) {
-            switch(hashType)
-            {
-            case algo_xxh32:
-                (void)XXH32_update(&state32, buffer, readSize);
-                break;
-            case algo_xxh64:
-                (void)XXH64_update(&state64, buffer, readSize);
-                break;
-            case algo_xxh128:
-                (void)XXH3_128bits_update(&state3, buffer, readSize);
-                break;
-            case algo_xxh3:
-                (void)XXH3_64bits_update(&state3, buffer, readSize);
-                break;
-            default:
-                assert(0);
-            }
+/* fread(), accounting for the time blocked and the bytes read */
+static size_t XSUM_statsRead(void* buffer, size_t size, FILE* inFile, XSUM_fileStats* stats)
+{
+    size_t readSize;
+    XSUM_U64 start;
+    if (stats == NULL) return fread(buffer, 1, size, inFile);
+    start = XSUM_clockNs();
+    readSize = fread(buffer, 1, size, inFile);
+    stats->readNs += XSUM_clockNs() - start;
+    stats->bytes += readSize;
+    return readSize;
+}
+
+static void XSUM_multihashReset(MultihashState* state, XSUM_U32 algoBitmask)
+{
+    state->algoBitmask = algoBitmask;
+    state->stats = NULL;
+    (void)XXH32_reset(&state->state32, XXHSUM32_DEFAULT_SEED);
+    (void)XXH64_reset(&state->state64, XXHSUM64_DEFAULT_SEED);
+    (void)XXH3_64bits_reset(&state->state3);
+    (void)XXH3_128bits_reset(&state->state128);
+}
+
+static void XSUM_multihashUpdate(MultihashState* state, const void* buffer, size_t size)
+{
+    XSUM_fileStats* const stats = state->stats;
+    XSUM_U64 lap = (stats != NULL) ? XSUM_clockNs() : 0;
+    if (state->algoBitmask & algo_bitmask_xxh32) {
+        (void)XXH32_update(&state->state32, buffer, size);
+        if (stats != NULL) XSUM_statsLap(stats, algo_xxh32, size, &lap);
+    }
+    if (state->algoBitmask & algo_bitmask_xxh64) {
+        (void)XXH64_update(&state->state64, buffer, size);
+        if (stats != NULL) XSUM_statsLap(stats, algo_xxh64, size, &lap);
+    }
+    if (state->algoBitmask & algo_bitmask_xxh128) {
+        (void)XXH3_128bits_update(&state->state128, buffer, size);
+        if (stats != NULL) XSUM_statsLap(stats, algo_xxh128, size, &lap);
+    }
+    if (state->algoBitmask & algo_bitmask_xxh3) {
+        (void)XXH3_64bits_update(&state->state3, buffer, size);
+        if (stats != NULL) XSUM_statsLap(stats, algo_xxh3, size, &lap);
+    }
+}
+
+static void XSUM_multihashDigest(const MultihashState* state, Multihash hashes[XSUM_ALGO_MAX])
+{
+    memset(hashes, 0, XSUM_ALGO_MAX * sizeof(Multihash));
+    if (state->algoBitmask & algo_bitmask_xxh32)
+        hashes[algo_xxh32].hash32 = XXH32_digest(&state->state32);
+    if (state->algoBitmask & algo_bitmask_xxh64)
+        hashes[algo_xxh64].hash64 = XXH64_digest(&state->state64);
+    if (state->algoBitmask & algo_bitmask_xxh128)
+        hashes[algo_xxh128].hash128 = XXH3_128bits_digest(&state->state128);
+    if (state->algoBitmask & algo_bitmask_xxh3)
+        hashes[algo_xxh3].hash64 = XXH3_64bits_digest(&state->state3);
+}
+
+/*
+ * Hashes a sparse file of `fileSize` bytes: data regions are read,
+ * while holes are hashed from a buffer of zeroes, without any I/O.
+ * The result is identical to a dense read.
+ * Returns 0 on success, 1 on read error.
+ */
+static int XSUM_hashSparseFile(FILE* inFile, XSUM_U64 fileSize, MultihashState* state,
+                               void* buffer, size_t blockSize)
+{
+    void* const zeroes = calloc(1, blockSize);
+    XSUM_U64 pos = 0;
+    if (zeroes == NULL) return 1;
+
+    while (pos < fileSize) {
+        XSUM_U64 dataStart = fileSize, dataEnd = fileSize;
+        int const found = XSUM_findData(inFile, pos, &dataStart, &dataEnd);
+        if (found < 0) {
+            /* can't locate holes anymore: read everything left */
+            dataStart = pos;
+            dataEnd = fileSize;
+        }
+        if (dataStart > fileSize) dataStart = fileSize;
+        if (dataEnd > fileSize) dataEnd = fileSize;
+
+        /* hole */
+        while (pos < dataStart) {
+            size_t const size = (dataStart - pos < blockSize) ? (size_t)(dataStart - pos) : blockSize;
+            XSUM_multihashUpdate(state, zeroes, size);
+            pos += size;
+        }
+
+        /* data */
+        if (pos < dataEnd && XSUM_seekFile(inFile, pos)) break;
+        while (pos < dataEnd) {
+            size_t const toRead = (dataEnd - pos < blockSize) ? (size_t)(dataEnd - pos) : blockSize;
+            size_t const readSize = XSUM_statsRead(buffer, toRead, inFile, state->stats);
+            XSUM_multihashUpdate(state, buffer, readSize);
+            pos += readSize;
+            if (readSize < toRead) break;
+        }
+        if (pos < dataEnd) break;   /* truncated or unreadable */
+    }
+    free(zeroes);
+    return (pos < fileSize) || ferror(inFile);
+}
+
+/*
+ * Updates `state` with the rest of `inFile`, from offset `start`,
+ * its current position. Returns the offset of the end of the data.
+ * Uses `buffer` of size `blockSize` for temporary storage.
+ * Holes of sparse files are not read.
+ */
+static XSUM_U64
+XSUM_multihashStream(FILE* inFile, XSUM_U64 start, MultihashState* state,
+                     void* buffer, size_t blockSize)
+{
+    XSUM_U64 fileSize, pos = start;
+
+    if (start == 0 && XSUM_isSparseFile(inFile, &fileSize)) {
+        if (XSUM_hashSparseFile(inFile, fileSize, state, buffer, blockSize)) {
+            XSUM_log("Error: a failure occurred reading the input file.\n");
+            exit(1);
+        }
+        pos = fileSize;
+    } else {
+        size_t readSize;
+        while ((readSize = XSUM_statsRead(buffer, blockSize, inFile, state->stats)) > 0) {
+            XSUM_multihashUpdate(state, buffer, readSize);
+            pos += readSize;
         }
         if (ferror(inFile)) {
             XSUM_log("Error: a failure occurred reading the input file.\n");
             exit(1);
     }   }
+    return pos;
+}
 
-    {   Multihash finalHash = {0};
-        switch(hashType)
-        {
-        case algo_xxh32:
-            finalHash.hash32 = XXH32_digest(&state32);
-            break;
-        case algo_xxh64:
-            finalHash.hash64 = XXH64_digest(&state64);
-            break;
-        case algo_xxh128:
-            finalHash.hash128 = XXH3_128bits_digest(&state3);
-            break;
-        case algo_xxh3:
-            finalHash.hash64 = XXH3_64bits_digest(&state3);
-            break;
-        default:
-            assert(0);
-        }
-        return finalHash;
+/*
+ * XSUM_hashStream:
+ * Reads data from `inFile` once, generating an incremental hash for each
+ * algorithm of `algoBitmask`: `hashes[algo]` receives the hash of `algo`.
+ * Uses `buffer` of size `blockSize` for temporary storage.
+ * Holes of sparse files are not read.
+ * Reads and hashing are measured into `stats`, unless it is NULL.
+ */
+static void
+XSUM_hashStream(FILE* inFile,
+                XSUM_U32 algoBitmask, Multihash hashes[XSUM_ALGO_MAX],
+                void* buffer, size_t blockSize, XSUM_fileStats* stats)
+{
+    MultihashState state;
+    XSUM_multihashReset(&state, algoBitmask);
+    state.stats = stats;
+    (void)XSUM_multihashStream(inFile, 0, &state, buffer, blockSize);
+    XSUM_multihashDigest(&state, hashes);
+}
+
+/*
+ * Digest of the bytes of `inFile` preceding offset `length`,
+ * up to XSUM_RESUME_GUARD_SIZE: see xsum_resume.h.
+ * Returns 0 on success, 1 if they can't be read.
+ */
+static int XSUM_resumeGuard(FILE* inFile, XSUM_U64 length, void* buffer, size_t blockSize, XSUM_U64* guard)
+{
+    size_t const size = (length < XSUM_RESUME_GUARD_SIZE) ? (size_t)length : XSUM_RESUME_GUARD_SIZE;
+    assert(size <= blockSize); (void)blockSize;
+    if (XSUM_seekFile(inFile, length - size)) return 1;
+    if (fread(buffer, 1, size, inFile) != size) return 1;
+    *guard = XXH3_64bits(buffer, size);
+    return 0;
+}
+
+/*
+ * Checks that a saved state can be resumed after `length` bytes: its
+ * buffered sizes are within their buffers, its lengths match, and its XXH3
+ * parameters are those of `fresh`. xxHash trusts these fields.
+ */
+static int XSUM_multihashStateIsValid(const MultihashState* state, const MultihashState* fresh, XSUM_U64 length)
+{
+    if (state->algoBitmask != fresh->algoBitmask) return 0;
+    if ( (state->algoBitmask & algo_bitmask_xxh32)
+      && ( state->state32.memsize >= sizeof(state->state32.mem32)
+        || state->state32.total_len_32 != (XXH32_hash_t)length
+        || state->state32.large_len != (length >= 16) ) )
+        return 0;
+    if ( (state->algoBitmask & algo_bitmask_xxh64)
+      && ( state->state64.memsize >= sizeof(state->state64.mem64)
+        || state->state64.total_len != length ) )
+        return 0;
+    if (state->algoBitmask & algo_bitmask_xxh3) {
+        const XXH3_state_t* const s3 = &state->state3;
+        if ( s3->bufferedSize > XXH3_INTERNALBUFFER_SIZE || s3->totalLen != length
+          || s3->nbStripesPerBlock != fresh->state3.nbStripesPerBlock
+          || s3->nbStripesSoFar > s3->nbStripesPerBlock
+          || s3->secretLimit != fresh->state3.secretLimit || s3->useSeed != fresh->state3.useSeed )
+            return 0;
+    }
+    if (state->algoBitmask & algo_bitmask_xxh128) {
+        const XXH3_state_t* const s128 = &state->state128;
+        if ( s128->bufferedSize > XXH3_INTERNALBUFFER_SIZE || s128->totalLen != length
+          || s128->nbStripesPerBlock != fresh->state128.nbStripesPerBlock
+          || s128->nbStripesSoFar > s128->nbStripesPerBlock
+          || s128->secretLimit != fresh->state128.secretLimit || s128->useSeed != fresh->state128.useSeed )
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * --state-dir: like XSUM_hashStream(), but starts from the state saved by
+ * the previous run when `inFile` only grew since, then saves the new state.
+ * `st` describes `inFile`.
+ */
+static void
+XSUM_hashStreamResumable(FILE* inFile, const char* fileName, const XSUM_fileStat* st,
+                         const char* stateDir,
+                         XSUM_U32 algoBitmask, Multihash hashes[XSUM_ALGO_MAX],
+                         void* buffer, size_t blockSize, XSUM_fileStats* stats)
+{
+    MultihashState state, fresh;
+    XSUM_resumePoint point;
+    XSUM_U64 start = 0, guard;
+
+    XSUM_multihashReset(&fresh, algoBitmask);
+    if ( XSUM_resume_load(stateDir, fileName, &point, &state, sizeof(state))
+      && XSUM_multihashStateIsValid(&state, &fresh, point.length)
+      && point.inode == st->inode
+      && point.length <= st->size
+      && !XSUM_resumeGuard(inFile, point.length, buffer, blockSize, &guard)
+      && guard == point.guard ) {
+        /* XXH3 states point to the default secret, in this process */
+        state.state3.extSecret = fresh.state3.extSecret;
+        state.state128.extSecret = fresh.state128.extSecret;
+        start = point.length;
+        XSUM_logVerbose(3, "xxhsum: %s: resuming after %llu bytes \n", fileName, (unsigned long long)start);
+    } else {
+        state = fresh;
+        rewind(inFile);
     }
+
+    state.stats = stats;
+    point.length = XSUM_multihashStream(inFile, start, &state, buffer, blockSize);
+    point.inode = st->inode;
+    state.stats = NULL;
+    if (!XSUM_resumeGuard(inFile, point.length, buffer, blockSize, &point.guard))
+        (void)XSUM_resume_save(stateDir, fileName, &point, &state, sizeof(state));
+    XSUM_multihashDigest(&state, hashes);
 }
 
                                        /* algo_xxh32, algo_xxh64, algo_xxh128 */
@@ -314,6 +580,46 @@ static const char* XSUM_algoName[] =    { "XXH32",    "XXH64",    "XXH128",    "
 static const char* XSUM_algoLE_name[] = { "XXH32_LE", "XXH64_LE", "XXH128_LE", "XXH3_LE" };
 static const size_t XSUM_algoLength[] = { 4,          8,          16,          8 };
 
+/* Writes the canonical (big endian) representation of `hash`, XSUM_algoLength[hashType] bytes */
+static void XSUM_canonicalFromMultihash(void* dst, AlgoSelected hashType, Multihash hash)
+{
+    switch (hashType)
+    {
+    case algo_xxh32:
+        XXH32_canonicalFromHash((XXH32_canonical_t*)dst, hash.hash32);
+        break;
+    case algo_xxh128:
+        XXH128_canonicalFromHash((XXH128_canonical_t*)dst, hash.hash128);
+        break;
+    case algo_xxh64:
+    case algo_xxh3:
+    default:
+        XXH64_canonicalFromHash((XXH64_canonical_t*)dst, hash.hash64);
+        break;
+    }
+}
+
+static Multihash XSUM_multihashFromCanonical(const void* src, AlgoSelected hashType)
+{
+    Multihash hash;
+    memset(&hash, 0, sizeof(hash));
+    switch (hashType)
+    {
+    case algo_xxh32:
+        hash.hash32 = XXH32_hashFromCanonical((const XXH32_canonical_t*)src);
+        break;
+    case algo_xxh128:
+        hash.hash128 = XXH128_hashFromCanonical((const XXH128_canonical_t*)src);
+        break;
+    case algo_xxh64:
+    case algo_xxh3:
+    default:
+        hash.hash64 = XXH64_hashFromCanonical((const XXH64_canonical_t*)src);
+        break;
+    }
+    return hash;
+}
+
 #define XSUM_TABLE_ELT_SIZE(table)   (sizeof(table) / sizeof(*table))
 
 typedef void (*XSUM_displayHash_f)(const void*, size_t);  /* display function signature */
@@ -372,125 +678,1797 @@ static void XSUM_printLine_GNU_internal(const char* filename,
         XSUM_output("\n");
 }   }
 
-static void XSUM_printLine_GNU(const char* filename,
-                               const void* canonicalHash, const AlgoSelected hashType)
+static void XSUM_printLine_GNU(const char* filename,
+                               const void* canonicalHash, const AlgoSelected hashType)
+{
+    XSUM_printLine_GNU_internal(filename, canonicalHash, hashType, XSUM_display_BigEndian);
+}
+
+static void XSUM_printLine_GNU_LE(const char* filename,
+                                  const void* canonicalHash, const AlgoSelected hashType)
+{
+    XSUM_printLine_GNU_internal(filename, canonicalHash, hashType, XSUM_display_LittleEndian);
+}
+
+typedef enum { big_endian, little_endian} Display_endianess;
+
+typedef enum { display_gnu, display_bsd } Display_convention;
+
+typedef void (*XSUM_displayLine_f)(const char*, const void*, AlgoSelected);  /* line display signature */
+
+static XSUM_displayLine_f XSUM_kDisplayLine_fTable[2][2] = {
+    { XSUM_printLine_GNU, XSUM_printLine_GNU_LE },
+    { XSUM_printLine_BSD, XSUM_printLine_BSD_LE }
+};
+
+typedef enum {
+    HashFile_ok,
+    HashFile_isDirectory,
+    HashFile_openFailed,
+    HashFile_outOfMemory
+} HashFileStatus;
+
+/*
+ * One file to hash.
+ * Filled by XSUM_hashFileJob(), which can run on any thread,
+ * then displayed by XSUM_displayHashFileJob().
+ */
+typedef struct {
+    const char*    fileName;
+    char*          ownedFileName;   /* freed with the job, can be NULL */
+    const AlgoList* algos;
+    HashFileStatus status;
+    int            errorNb;         /* errno, for HashFile_openFailed */
+    Multihash      hashes[XSUM_ALGO_MAX];   /* indexed by AlgoSelected */
+    XSUM_cache*    cache;           /* --cache, can be NULL */
+    const char*    stateDir;        /* --state-dir, can be NULL */
+    XSUM_fileStat  stat;            /* metadata before hashing, valid if hasStat */
+    int            hasStat;
+    XSUM_U32       cachedBitmask;   /* algorithms found in the cache */
+    XSUM_fileStats stats;           /* --stats */
+    int            completed;       /* see XSUM_pool_waitCompleted() */
+} HashFileJob;
+
+typedef struct {
+    AlgoList           algos;
+    Display_endianess  displayEndianess;
+    Display_convention convention;
+    int                recursive;
+    int                sortFiles;
+    int                nbThreads;
+    XSUM_cache*        cache;
+    XSUM_indexWriter*  index;       /* --index, can be NULL */
+    const char*        stateDir;    /* --state-dir, can be NULL */
+} HashFilesArg;
+
+/*
+ * Pipes deliver at most their kernel buffer per read:
+ * larger buffers and reads mean fewer system calls and wake-ups.
+ */
+#define XSUM_PIPE_SIZE       (1 MB)
+#define XSUM_PIPE_BLOCK_SIZE (256 KB)
+
+/*
+ * Files smaller than this are read with a single read() into a buffer on
+ * the stack, then hashed in one shot: on trees of small files, the per-file
+ * overhead of stdio, buffer allocation and streaming states dominates.
+ */
+#define XSUM_SMALL_FILE_SIZE (16 KB)
+
+static Multihash XSUM_hashBuffer(const void* buffer, size_t size, AlgoSelected algo)
+{
+    Multihash hash;
+    memset(&hash, 0, sizeof(hash));
+    switch (algo)
+    {
+    case algo_xxh32:
+        hash.hash32 = XXH32(buffer, size, XXHSUM32_DEFAULT_SEED);
+        break;
+    case algo_xxh64:
+        hash.hash64 = XXH64(buffer, size, XXHSUM64_DEFAULT_SEED);
+        break;
+    case algo_xxh128:
+        hash.hash128 = XXH3_128bits(buffer, size);
+        break;
+    case algo_xxh3:
+    default:
+        hash.hash64 = XXH3_64bits(buffer, size);
+        break;
+    }
+    return hash;
+}
+
+/* One-shot equivalent of XSUM_hashStream(), for data already in memory */
+static void XSUM_multihashBuffer(const void* buffer, size_t size,
+                                 XSUM_U32 algoBitmask, Multihash hashes[XSUM_ALGO_MAX],
+                                 XSUM_fileStats* stats)
+{
+    XSUM_U64 lap = (stats != NULL) ? XSUM_clockNs() : 0;
+    int algo;
+    memset(hashes, 0, XSUM_ALGO_MAX * sizeof(Multihash));
+    for (algo = 0; algo < XSUM_ALGO_MAX; algo++) {
+        if (algoBitmask & XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected((AlgoSelected)algo)) {
+            hashes[algo] = XSUM_hashBuffer(buffer, size, (AlgoSelected)algo);
+            if (stats != NULL) XSUM_statsLap(stats, (AlgoSelected)algo, size, &lap);
+    }   }
+}
+
+static void XSUM_hashFileJob_setHashes(HashFileJob* job, XSUM_U32 algoBitmask,
+                                       const Multihash hashes[XSUM_ALGO_MAX])
+{
+    int n;
+    for (n = 0; n < job->algos->nbAlgos; n++) {
+        AlgoSelected const algo = job->algos->algos[n];
+        if (algoBitmask & XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected(algo))
+            job->hashes[algo] = hashes[algo];
+    }
+    job->status = HashFile_ok;
+}
+
+static void XSUM_hashFileJob(void* opaque)
+{
+    HashFileJob* const job = (HashFileJob*)opaque;
+    size_t blockSize = 64 KB;
+    FILE* inFile;
+    unsigned char smallFile[XSUM_SMALL_FILE_SIZE];
+    XSUM_fileStats* const stats = XSUM_statsEnabled ? &job->stats : NULL;
+
+    /* Check file existence */
+    if (job->fileName == stdinName) {
+        inFile = stdin;
+        XSUM_setBinaryMode(stdin);
+        if (XSUM_growPipe(stdin, XSUM_PIPE_SIZE))
+            blockSize = XSUM_PIPE_BLOCK_SIZE;
+    } else {
+        size_t smallSize = 0;
+        XSUM_U64 openStart;
+        int opened;
+        if ( (job->cache != NULL || job->stateDir != NULL)
+          && XSUM_statFile(job->fileName, &job->stat) == 0 ) {
+            int n;
+            job->hasStat = 1;
+            if (stats != NULL) stats->size = job->stat.size;
+            for (n = 0; n < job->algos->nbAlgos && job->cache != NULL; n++) {
+                AlgoSelected const algo = job->algos->algos[n];
+                unsigned char digest[XSUM_CACHE_DIGEST_MAX];
+                if (XSUM_cache_lookup(job->cache, job->fileName, &job->stat,
+                                      (unsigned)algo, XSUM_algoName[algo],
+                                      digest, XSUM_algoLength[algo])) {
+                    job->hashes[algo] = XSUM_multihashFromCanonical(digest, algo);
+                    job->cachedBitmask |= XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected(algo);
+            }   }
+            if (job->cachedBitmask == XSUM_algoList_bitmask(job->algos)) {
+                job->status = HashFile_ok;
+                return;
+        }   }
+        /* --state-dir needs a stream, even for small files */
+        openStart = (stats != NULL) ? XSUM_clockNs() : 0;
+        opened = XSUM_openFile(job->fileName, smallFile, (job->stateDir == NULL) ? sizeof(smallFile) : 0,
+                               &smallSize, &inFile);
+        if (stats != NULL) {
+            stats->readNs += XSUM_clockNs() - openStart;
+            stats->bytes += smallSize;
+        }
+        if (opened < 0) {
+            job->status = (errno == EISDIR) ? HashFile_isDirectory : HashFile_openFailed;
+            job->errorNb = errno;
+            return;
+        }
+        if (stats != NULL && !job->hasStat)
+            stats->size = (opened == 0) ? smallSize : XSUM_getFileSize(job->fileName);
+        if (opened == 0) {
+            XSUM_U32 const algoBitmask = XSUM_algoList_bitmask(job->algos) & ~job->cachedBitmask;
+            Multihash hashes[XSUM_ALGO_MAX];
+            XSUM_multihashBuffer(smallFile, smallSize, algoBitmask, hashes, stats);
+            XSUM_hashFileJob_setHashes(job, algoBitmask, hashes);
+            return;
+    }   }
+
+    /* Memory allocation & streaming */
+    {   void* const buffer = malloc(blockSize);
+        if (buffer == NULL) {
+            job->status = HashFile_outOfMemory;
+            fclose(inFile);
+            return;
+        }
+
+        /* Stream file & update all hashes at once */
+        {   XSUM_U32 const algoBitmask = XSUM_algoList_bitmask(job->algos) & ~job->cachedBitmask;
+            Multihash hashes[XSUM_ALGO_MAX];
+            if (job->stateDir != NULL && job->hasStat) {
+                XSUM_hashStreamResumable(inFile, job->fileName, &job->stat, job->stateDir,
+                                         algoBitmask, hashes, buffer, blockSize, stats);
+            } else {
+                XSUM_hashStream(inFile, algoBitmask, hashes, buffer, blockSize, stats);
+            }
+            XSUM_hashFileJob_setHashes(job, algoBitmask, hashes);
+        }
+        if (stats != NULL && stats->size < stats->bytes)
+            stats->size = stats->bytes;   /* pipe, or growing file */
+
+        fclose(inFile);
+        free(buffer);
+    }
+}
+
+/*
+ * Records a freshly computed digest in the cache.
+ * Must be serialized, like XSUM_displayHashFileJob().
+ */
+static void XSUM_cacheHashFileJob(const HashFileJob* job)
+{
+    int n;
+    if (job->cache == NULL || job->status != HashFile_ok || !job->hasStat)
+        return;
+    for (n = 0; n < job->algos->nbAlgos; n++) {
+        AlgoSelected const algo = job->algos->algos[n];
+        unsigned char digest[XSUM_CACHE_DIGEST_MAX];
+        if (job->cachedBitmask & XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected(algo))
+            continue;
+        XSUM_canonicalFromMultihash(digest, algo, job->hashes[algo]);
+        XSUM_cache_store(job->cache, job->fileName, &job->stat,
+                         (unsigned)algo, XSUM_algoName[algo],
+                         digest, XSUM_algoLength[algo]);
+    }
+}
+
+/*
+ * Displays the checksum lines of `job`, or adds its digest to the --index.
+ * Returns 1 if the file could not be hashed.
+ */
+static int XSUM_displayHashFileJob(const HashFileJob* job, const HashFilesArg* arg)
+{
+    XSUM_displayLine_f const f_displayLine = XSUM_kDisplayLine_fTable[arg->convention][arg->displayEndianess];
+    const char* const fileName = (job->fileName == stdinName) ? stdinFileName : job->fileName;
+    assert(arg->displayEndianess==big_endian || arg->displayEndianess==little_endian);
+    assert(arg->convention==display_gnu || arg->convention==display_bsd);
+
+    switch (job->status)
+    {
+    case HashFile_ok:
+        if (XSUM_statsEnabled)
+            XSUM_stats_addFile(&job->stats, job->cachedBitmask == XSUM_algoList_bitmask(job->algos));
+        break;
+    case HashFile_isDirectory:
+        XSUM_log("xxhsum: %s: Is a directory \n", fileName);
+        return 1;
+    case HashFile_openFailed:
+        XSUM_log("Error: Could not open '%s': %s. \n", fileName, strerror(job->errorNb));
+        return 1;
+    case HashFile_outOfMemory:
+    default:
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+
+    /* display Hash values in selected format, one line per algorithm */
+    {   int n;
+        for (n = 0; n < job->algos->nbAlgos; n++) {
+            AlgoSelected const hashType = job->algos->algos[n];
+            unsigned char canonical[XSUM_CACHE_DIGEST_MAX];
+            XSUM_canonicalFromMultihash(canonical, hashType, job->hashes[hashType]);
+            if (arg->index == NULL) {
+                f_displayLine(fileName, canonical, hashType);
+            } else if (XSUM_indexWriter_add(arg->index, fileName, canonical)) {
+                XSUM_log("\nError: Out of memory.\n");
+                return 1;
+            }
+    }   }
+
+    return 0;
+}
+
+
+/* ********************************************************
+*  Ordered hashing of a list of files
+**********************************************************/
+
+/*
+ * Files are hashed by the pool, up to `nbSlots` at a time,
+ * but always displayed in submission order.
+ */
+typedef struct {
+    XSUM_pool*          pool;
+    const HashFilesArg* arg;
+    HashFileJob*        slots;
+    size_t              nbSlots;
+    size_t              nbSubmitted;
+    size_t              nbDisplayed;
+    int                 result;
+} HashFilesQueue;
+
+static void XSUM_hashFilesQueue_displayNext(HashFilesQueue* queue)
+{
+    HashFileJob* const job = &queue->slots[queue->nbDisplayed % queue->nbSlots];
+    assert(queue->nbDisplayed < queue->nbSubmitted);
+    XSUM_pool_waitCompleted(queue->pool, &job->completed);
+    XSUM_cacheHashFileJob(job);
+    queue->result |= XSUM_displayHashFileJob(job, queue->arg);
+    free(job->ownedFileName);
+    job->ownedFileName = NULL;
+    queue->nbDisplayed++;
+}
+
+/* Takes ownership of `ownedFileName` (can be NULL) */
+static void XSUM_hashFilesQueue_add(HashFilesQueue* queue, const char* fileName, char* ownedFileName)
+{
+    HashFileJob* job;
+    if (queue->nbSubmitted - queue->nbDisplayed == queue->nbSlots)
+        XSUM_hashFilesQueue_displayNext(queue);
+    job = &queue->slots[queue->nbSubmitted % queue->nbSlots];
+    memset(job, 0, sizeof(*job));
+    job->fileName = fileName;
+    job->ownedFileName = ownedFileName;
+    job->algos = &queue->arg->algos;
+    job->cache = queue->arg->cache;
+    job->stateDir = queue->arg->stateDir;
+    queue->nbSubmitted++;
+    XSUM_pool_add(queue->pool, XSUM_hashFileJob, job, &job->completed);
+}
+
+static void XSUM_hashFilesQueue_flush(HashFilesQueue* queue)
+{
+    while (queue->nbDisplayed < queue->nbSubmitted)
+        XSUM_hashFilesQueue_displayNext(queue);
+}
+
+
+/* ********************************************************
+*  Recursive traversal (-r)
+**********************************************************/
+
+/*
+ * Directories are listed by pool jobs, each subdirectory becoming a new job
+ * queued at the back, while files found are queued at the front:
+ * workers hash what is already known before expanding the tree further,
+ * which keeps the queue short even on very large trees.
+ *
+ * Unless --sort is requested, files are displayed as soon as they are hashed.
+ * Special files (fifo, device, socket) are skipped,
+ * and symbolic links to directories are not followed.
+ */
+typedef struct {
+    XSUM_pool*          pool;
+    const HashFilesArg* arg;
+    int                 result;        /* protected by XSUM_pool_lock() */
+    int                 collect;       /* collect file names instead of hashing them */
+    /* files collected for later hashing, protected by XSUM_pool_lock() */
+    char**              fileNames;
+    size_t              nbFiles;
+    size_t              capacity;
+} WalkCtx;
+
+typedef struct {
+    WalkCtx* ctx;
+    char*    dirName;
+} WalkDirJob;
+
+typedef struct {
+    HashFileJob job;
+    WalkCtx*    ctx;
+} WalkFileJob;
+
+static void XSUM_walkReportError(WalkCtx* ctx, const char* msg, const char* fileName)
+{
+    XSUM_pool_lock(ctx->pool);
+    XSUM_log("xxhsum: %s: %s \n", fileName, msg);
+    ctx->result = 1;
+    XSUM_pool_unlock(ctx->pool);
+}
+
+static void XSUM_walkHashFileJob(void* opaque)
+{
+    WalkFileJob* const walkJob = (WalkFileJob*)opaque;
+    WalkCtx* const ctx = walkJob->ctx;
+    XSUM_hashFileJob(&walkJob->job);
+    XSUM_pool_lock(ctx->pool);
+    XSUM_cacheHashFileJob(&walkJob->job);
+    ctx->result |= XSUM_displayHashFileJob(&walkJob->job, ctx->arg);
+    XSUM_pool_unlock(ctx->pool);
+    free(walkJob->job.ownedFileName);
+    free(walkJob);
+}
+
+/* Takes ownership of `fileName` */
+static void XSUM_walkFile(WalkCtx* ctx, char* fileName)
+{
+    if (ctx->collect) {
+        XSUM_pool_lock(ctx->pool);
+        if (ctx->nbFiles == ctx->capacity) {
+            size_t const newCapacity = ctx->capacity ? ctx->capacity * 2 : 1024;
+            char** const newNames = (char**)realloc(ctx->fileNames, newCapacity * sizeof(char*));
+            if (newNames == NULL) {
+                XSUM_pool_unlock(ctx->pool);
+                XSUM_walkReportError(ctx, "Out of memory", fileName);
+                free(fileName);
+                return;
+            }
+            ctx->fileNames = newNames;
+            ctx->capacity = newCapacity;
+        }
+        ctx->fileNames[ctx->nbFiles++] = fileName;
+        XSUM_pool_unlock(ctx->pool);
+        return;
+    }
+    {   WalkFileJob* const walkJob = (WalkFileJob*)calloc(1, sizeof(WalkFileJob));
+        if (walkJob == NULL) {
+            XSUM_walkReportError(ctx, "Out of memory", fileName);
+            free(fileName);
+            return;
+        }
+        walkJob->job.fileName = fileName;
+        walkJob->job.ownedFileName = fileName;
+        walkJob->job.algos = &ctx->arg->algos;
+        walkJob->job.cache = ctx->arg->cache;
+        walkJob->job.stateDir = ctx->arg->stateDir;
+        walkJob->ctx = ctx;
+        XSUM_pool_addFront(ctx->pool, XSUM_walkHashFileJob, walkJob, NULL);
+    }
+}
+
+static void XSUM_walkDirJob(void* opaque);
+
+/* Takes ownership of `dirName` */
+static void XSUM_walkDir(WalkCtx* ctx, char* dirName)
+{
+    WalkDirJob* const job = (WalkDirJob*)malloc(sizeof(WalkDirJob));
+    if (job == NULL) {
+        XSUM_walkReportError(ctx, "Out of memory", dirName);
+        free(dirName);
+        return;
+    }
+    job->ctx = ctx;
+    job->dirName = dirName;
+    XSUM_pool_add(ctx->pool, XSUM_walkDirJob, job, NULL);
+}
+
+static void XSUM_walkDirJob(void* opaque)
+{
+    WalkDirJob* const job = (WalkDirJob*)opaque;
+    WalkCtx* const ctx = job->ctx;
+    char** subDirs = NULL;
+    size_t nbSubDirs = 0, subDirsCapacity = 0;
+
+    {   XSUM_dir* const dir = XSUM_openDir(job->dirName);
+        const char* name;
+        XSUM_fileType type;
+        if (dir == NULL) {
+            XSUM_walkReportError(ctx, strerror(errno), job->dirName);
+            free(job->dirName);
+            free(job);
+            return;
+        }
+        while ((name = XSUM_readDir(dir, &type)) != NULL) {
+            char* const path = XSUM_pathJoin(job->dirName, name);
+            if (path == NULL) {
+                XSUM_walkReportError(ctx, "Out of memory", job->dirName);
+                break;
+            }
+            if (type == XSUM_fileType_unknown) {
+                type = XSUM_getLinkType(path);
+            }
+            if (type == XSUM_fileType_symlink) {
+                /* Follow links to files, but never to directories (loops) */
+                type = XSUM_getFileType(path);
+                if (type == XSUM_fileType_directory) type = XSUM_fileType_other;
+            }
+            switch (type)
+            {
+            case XSUM_fileType_regular:
+                XSUM_walkFile(ctx, path);
+                break;
+            case XSUM_fileType_directory:
+                /* Listed once this directory is closed, to bound open descriptors */
+                if (nbSubDirs == subDirsCapacity) {
+                    size_t const newCapacity = subDirsCapacity ? subDirsCapacity * 2 : 16;
+                    char** const newSubDirs = (char**)realloc(subDirs, newCapacity * sizeof(char*));
+                    if (newSubDirs == NULL) {
+                        XSUM_walkReportError(ctx, "Out of memory", path);
+                        free(path);
+                        break;
+                    }
+                    subDirs = newSubDirs;
+                    subDirsCapacity = newCapacity;
+                }
+                subDirs[nbSubDirs++] = path;
+                break;
+            case XSUM_fileType_unknown:
+            case XSUM_fileType_symlink:
+            case XSUM_fileType_other:
+            default:
+                XSUM_logVerbose(3, "xxhsum: %s: skipped \n", path);
+                free(path);
+                break;
+            }
+        }
+        XSUM_closeDir(dir);
+    }
+
+    {   size_t n;
+        for (n = 0; n < nbSubDirs; n++)
+            XSUM_walkDir(ctx, subDirs[n]);
+    }
+    free(subDirs);
+    free(job->dirName);
+    free(job);
+}
+
+static int XSUM_compareFileNames(const void* p1, const void* p2)
+{
+    return strcmp(*(const char* const*)p1, *(const char* const*)p2);
+}
+
+static char* XSUM_strdup(const char* str)
+{
+    size_t const size = strlen(str) + 1;
+    char* const copy = (char*)malloc(size);
+    if (copy != NULL) memcpy(copy, str, size);
+    return copy;
+}
+
+/* Walks the tree below `dirName`, and waits for all its jobs */
+static void XSUM_walkTree(WalkCtx* ctx, const char* dirName)
+{
+    char* const rootName = XSUM_strdup(dirName);
+    if (rootName == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        ctx->result = 1;
+        return;
+    }
+    XSUM_walkDir(ctx, rootName);
+    XSUM_pool_waitAll(ctx->pool);
+}
+
+/*
+ * Hashes all files below `dirName`.
+ * With --sort, files are queued into `queue` in path order instead.
+ */
+static int XSUM_hashDirectory(HashFilesQueue* queue, const char* dirName)
+{
+    WalkCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pool = queue->pool;
+    ctx.arg = queue->arg;
+    ctx.collect = queue->arg->sortFiles;
+    XSUM_walkTree(&ctx, dirName);
+
+    if (ctx.collect) {
+        size_t n;
+        if (ctx.nbFiles > 1)
+            qsort(ctx.fileNames, ctx.nbFiles, sizeof(char*), XSUM_compareFileNames);
+        for (n = 0; n < ctx.nbFiles; n++)
+            XSUM_hashFilesQueue_add(queue, ctx.fileNames[n], ctx.fileNames[n]);
+        XSUM_hashFilesQueue_flush(queue);
+        free(ctx.fileNames);
+    }
+    return ctx.result;
+}
+
+
+/*
+ * XSUM_hashFiles:
+ * If fnTotal==0, read from stdin instead.
+ */
+static int XSUM_hashFiles(const char* fnList[], int fnTotal, const HashFilesArg* arg)
+{
+    HashFilesQueue queue;
+    int fnNb;
+
+    memset(&queue, 0, sizeof(queue));
+    queue.arg = arg;
+    queue.pool = XSUM_pool_create(arg->nbThreads);
+    queue.nbSlots = 4 * (size_t)(arg->nbThreads > 1 ? arg->nbThreads : 1);
+    queue.slots = (HashFileJob*)calloc(queue.nbSlots, sizeof(HashFileJob));
+    if (queue.pool == NULL || queue.slots == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        XSUM_pool_free(queue.pool);
+        free(queue.slots);
+        return 1;
+    }
+
+    if (fnTotal==0)
+        XSUM_hashFilesQueue_add(&queue, stdinName, NULL);
+
+    for (fnNb=0; fnNb<fnTotal; fnNb++) {
+        if (arg->recursive && XSUM_isDirectory(fnList[fnNb])) {
+            /* preserve display order of previous arguments */
+            XSUM_hashFilesQueue_flush(&queue);
+            queue.result |= XSUM_hashDirectory(&queue, fnList[fnNb]);
+            continue;
+        }
+        XSUM_hashFilesQueue_add(&queue, fnList[fnNb], NULL);
+    }
+    XSUM_hashFilesQueue_flush(&queue);
+
+    XSUM_pool_free(queue.pool);
+    free(queue.slots);
+    if (fnTotal > 0) XSUM_logVerbose(2, "\r%70s\r", "");
+    return queue.result;
+}
+
+
+/* ********************************************************
+*  Passthrough (--tee)
+**********************************************************/
+
+/*
+ * Copies stdin to stdout while hashing it, then writes the checksum lines
+ * of "stdin" to `digestFileName`, or to stderr if NULL.
+ * When both are pipes, data is forwarded with tee(2), never copied through
+ * user space, and only read once for hashing.
+ */
+static int XSUM_teeStdin(const HashFilesArg* arg, const char* digestFileName)
+{
+    size_t const blockSize = XSUM_PIPE_BLOCK_SIZE;
+    void* const buffer = malloc(blockSize);
+    FILE* const digestFile = (digestFileName == NULL) ? stderr : XSUM_fopen(digestFileName, "w");
+    MultihashState state;
+    HashFileJob job;
+    int useTeePipe = 1;
+    int result = 0;
+
+    if (buffer == NULL || digestFile == NULL) {
+        if (buffer == NULL) XSUM_log("\nError: Out of memory.\n");
+        else XSUM_log("Error: Could not open '%s': %s. \n", digestFileName, strerror(errno));
+        free(buffer);
+        if (digestFile != NULL && digestFile != stderr) fclose(digestFile);
+        return 1;
+    }
+    XSUM_setBinaryMode(stdin);
+    XSUM_setBinaryMode(stdout);
+    (void)XSUM_growPipe(stdin, XSUM_PIPE_SIZE);
+    (void)XSUM_growPipe(stdout, XSUM_PIPE_SIZE);
+    XSUM_multihashReset(&state, XSUM_algoList_bitmask(&arg->algos));
+
+    for (;;) {
+        size_t readSize;
+        if (useTeePipe) {
+            long const teed = XSUM_teePipe(stdin, stdout, buffer, blockSize);
+            if (teed > 0) {
+                XSUM_multihashUpdate(&state, buffer, (size_t)teed);
+                continue;
+            }
+            if (teed == 0) break;
+            if (errno != EINVAL && errno != ENOSYS) {
+                XSUM_log("Error: a failure occurred forwarding the input: %s. \n", strerror(errno));
+                result = 1;
+                break;
+            }
+            useTeePipe = 0;   /* not two pipes: copy through the buffer */
+        }
+        readSize = fread(buffer, 1, blockSize, stdin);
+        if (readSize == 0) break;
+        XSUM_multihashUpdate(&state, buffer, readSize);
+        if (fwrite(buffer, 1, readSize, stdout) != readSize) {
+            XSUM_log("Error: a failure occurred writing the output: %s. \n", strerror(errno));
+            result = 1;
+            break;
+    }   }
+    if (ferror(stdin)) {
+        XSUM_log("Error: a failure occurred reading the input file.\n");
+        result = 1;
+    }
+    if (fflush(stdout)) {
+        XSUM_log("Error: a failure occurred writing the output: %s. \n", strerror(errno));
+        result = 1;
+    }
+    free(buffer);
+
+    /* The digest is only meaningful if all data went through */
+    if (result == 0) {
+        memset(&job, 0, sizeof(job));
+        job.fileName = stdinName;
+        job.algos = &arg->algos;
+        job.status = HashFile_ok;
+        XSUM_multihashDigest(&state, job.hashes);
+        XSUM_setOutput(digestFile);
+        (void)XSUM_displayHashFileJob(&job, arg);
+        XSUM_setOutput(NULL);
+    }
+    if (digestFile != stderr && fclose(digestFile)) {
+        XSUM_log("Error: Could not write '%s': %s. \n", digestFileName, strerror(errno));
+        result = 1;
+    }
+    return result;
+}
+
+
+/* ********************************************************
+*  Tar archives (--tar)
+**********************************************************/
+
+/*
+ * Displays checksum lines of each regular file member of the tar archive
+ * `inFile`, as if it had been extracted: the archive is read once,
+ * sequentially, and nothing is written to disk.
+ */
+static int XSUM_hashTarArchive(FILE* inFile, const char* archiveName, const HashFilesArg* arg,
+                               void* buffer, size_t blockSize)
+{
+    XSUM_tar* const tar = XSUM_tar_create(inFile, archiveName);
+    const char* memberName;
+    XSUM_U64 memberSize;
+    int result;
+    if (tar == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+    while ((memberName = XSUM_tar_next(tar, &memberSize)) != NULL) {
+        MultihashState state;
+        HashFileJob job;
+        size_t readSize;
+        XSUM_multihashReset(&state, XSUM_algoList_bitmask(&arg->algos));
+        while ((readSize = XSUM_tar_read(tar, buffer, blockSize)) > 0)
+            XSUM_multihashUpdate(&state, buffer, readSize);
+        if (XSUM_tar_failed(tar)) break;
+        memset(&job, 0, sizeof(job));
+        job.fileName = memberName;
+        job.algos = &arg->algos;
+        job.status = HashFile_ok;
+        XSUM_multihashDigest(&state, job.hashes);
+        (void)XSUM_displayHashFileJob(&job, arg);
+    }
+    result = XSUM_tar_failed(tar);
+    XSUM_tar_free(tar);
+    return result;
+}
+
+/*
+ * XSUM_hashTarFiles:
+ * If fnTotal==0, read the archive from stdin instead.
+ */
+static int XSUM_hashTarFiles(const char* fnList[], int fnTotal, const HashFilesArg* arg)
+{
+    size_t const blockSize = XSUM_PIPE_BLOCK_SIZE;
+    void* const buffer = malloc(blockSize);
+    int result = 0;
+    int fnNb;
+    if (buffer == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+    if (fnTotal == 0) {
+        XSUM_setBinaryMode(stdin);
+        (void)XSUM_growPipe(stdin, XSUM_PIPE_SIZE);
+        result = XSUM_hashTarArchive(stdin, stdinFileName, arg, buffer, blockSize);
+    }
+    for (fnNb = 0; fnNb < fnTotal; fnNb++) {
+        const char* const fileName = fnList[fnNb];
+        FILE* inFile;
+        if (!strcmp(fileName, stdinName)) {
+            XSUM_setBinaryMode(stdin);
+            (void)XSUM_growPipe(stdin, XSUM_PIPE_SIZE);
+            result |= XSUM_hashTarArchive(stdin, stdinFileName, arg, buffer, blockSize);
+            continue;
+        }
+        if (XSUM_isDirectory(fileName)) {
+            XSUM_log("xxhsum: %s: Is a directory \n", fileName);
+            result = 1;
+            continue;
+        }
+        inFile = XSUM_fopen(fileName, "rb");
+        if (inFile == NULL) {
+            XSUM_log("Error: Could not open '%s': %s. \n", fileName, strerror(errno));
+            result = 1;
+            continue;
+        }
+        result |= XSUM_hashTarArchive(inFile, fileName, arg, buffer, blockSize);
+        fclose(inFile);
+    }
+    free(buffer);
+    return result;
+}
+
+
+/* ********************************************************
+*  Duplicate files (--dupes)
+**********************************************************/
+
+/*
+ * Files are compared in stages, each stage only reading the files
+ * which the previous one could not tell apart:
+ * 1. size, from the file system: a file with a unique size has no duplicate;
+ * 2. fingerprint: XXH3 of XSUM_DUPES_NB_SAMPLES samples of XSUM_DUPES_SAMPLE_SIZE
+ *    bytes, at the start, middle and end of the file;
+ * 3. XXH128 of the whole content, only for files sharing a fingerprint.
+ * Files entirely covered by the samples get their XXH128 at stage 2.
+ * Empty files, and links to a file already listed, are ignored.
+ */
+#define XSUM_DUPES_SAMPLE_SIZE (4 KB)
+#define XSUM_DUPES_NB_SAMPLES  3
+
+typedef struct {
+    HashFileJob job;          /* full XXH128, owns the file name */
+    XSUM_U64    fingerprint;
+    int         hashed;       /* job.hashes[algo_xxh128] is valid */
+    int         excluded;     /* error, empty file, or same file as another entry */
+} DupeFile;
+
+typedef enum {
+    dupes_sameSize,
+    dupes_sameFingerprint,
+    dupes_sameContent
+} DupesLevel;
+
+static void XSUM_dupeStatJob(void* opaque)
+{
+    DupeFile* const file = (DupeFile*)opaque;
+    if (XSUM_isDirectory(file->job.fileName)) {
+        file->job.status = HashFile_isDirectory;
+        file->excluded = 1;
+        return;
+    }
+    if (XSUM_statFile(file->job.fileName, &file->job.stat)) {
+        file->job.status = HashFile_openFailed;
+        file->job.errorNb = errno;
+        file->excluded = 1;
+        return;
+    }
+    file->job.hasStat = 1;
+    if (file->job.stat.size == 0) file->excluded = 1;
+}
+
+static void XSUM_dupeFingerprintJob(void* opaque)
+{
+    DupeFile* const file = (DupeFile*)opaque;
+    XSUM_U64 const fileSize = file->job.stat.size;
+    size_t const sampleSize = XSUM_DUPES_SAMPLE_SIZE;
+    int const whole = fileSize <= (XSUM_U64)(XSUM_DUPES_NB_SAMPLES * sampleSize);
+    unsigned char* const buffer = (unsigned char*)malloc(XSUM_DUPES_NB_SAMPLES * sampleSize);
+    FILE* const inFile = XSUM_fopen(file->job.fileName, "rb");
+    size_t length = 0;
+
+    if (inFile == NULL || buffer == NULL) {
+        file->job.status = (inFile == NULL) ? HashFile_openFailed : HashFile_outOfMemory;
+        file->job.errorNb = errno;
+        file->excluded = 1;
+        if (inFile != NULL) fclose(inFile);
+        free(buffer);
+        return;
+    }
+    if (whole) {
+        length = fread(buffer, 1, (size_t)fileSize, inFile);
+    } else {
+        int n;
+        for (n = 0; n < XSUM_DUPES_NB_SAMPLES; n++) {
+            XSUM_U64 const offset = (fileSize - sampleSize) * (XSUM_U64)n / (XSUM_DUPES_NB_SAMPLES - 1);
+            if (XSUM_seekFile(inFile, offset)) break;
+            length += fread(buffer + length, 1, sampleSize, inFile);
+    }   }
+    fclose(inFile);
+
+    if (whole) {
+        file->job.hashes[algo_xxh128].hash128 = XXH3_128bits(buffer, length);
+        file->fingerprint = file->job.hashes[algo_xxh128].hash128.low64;
+        file->hashed = 1;
+    } else {
+        file->fingerprint = XXH3_64bits(buffer, length);
+    }
+    free(buffer);
+}
+
+static void XSUM_dupeHashJob(void* opaque)
+{
+    DupeFile* const file = (DupeFile*)opaque;
+    XSUM_hashFileJob(&file->job);
+    if (file->job.status == HashFile_ok) {
+        file->hashed = 1;
+    } else {
+        file->excluded = 1;
+    }
+}
+
+/* Excluded files last, then by decreasing size, fingerprint, content, and identity */
+static int XSUM_compareDupeFiles(const void* p1, const void* p2)
+{
+    const DupeFile* const f1 = (const DupeFile*)p1;
+    const DupeFile* const f2 = (const DupeFile*)p2;
+    if (f1->excluded != f2->excluded) return f1->excluded - f2->excluded;
+    if (f1->job.stat.size != f2->job.stat.size) return (f1->job.stat.size > f2->job.stat.size) ? -1 : 1;
+    if (f1->fingerprint != f2->fingerprint) return (f1->fingerprint < f2->fingerprint) ? -1 : 1;
+    if (f1->hashed && f2->hashed) {
+        int const cmp = XXH128_cmp(&f1->job.hashes[algo_xxh128].hash128, &f2->job.hashes[algo_xxh128].hash128);
+        if (cmp != 0) return cmp;
+    }
+    if (f1->job.stat.device != f2->job.stat.device) return (f1->job.stat.device < f2->job.stat.device) ? -1 : 1;
+    if (f1->job.stat.inode != f2->job.stat.inode) return (f1->job.stat.inode < f2->job.stat.inode) ? -1 : 1;
+    return strcmp(f1->job.fileName, f2->job.fileName);
+}
+
+static int XSUM_compareDupeNames(const void* p1, const void* p2)
+{
+    return strcmp(((const DupeFile*)p1)->job.fileName, ((const DupeFile*)p2)->job.fileName);
+}
+
+static int XSUM_sameDupes(const DupeFile* f1, const DupeFile* f2, DupesLevel level)
+{
+    if (f1->excluded || f2->excluded) return 0;
+    if (f1->job.stat.size != f2->job.stat.size) return 0;
+    if (level == dupes_sameSize) return 1;
+    if (f1->fingerprint != f2->fingerprint) return 0;
+    if (level == dupes_sameFingerprint) return 1;
+    return f1->hashed && f2->hashed
+        && XXH128_isEqual(f1->job.hashes[algo_xxh128].hash128, f2->job.hashes[algo_xxh128].hash128);
+}
+
+/* Returns the end of the run of files starting at `start` which are identical at `level` */
+static size_t XSUM_dupesRunEnd(const DupeFile* files, size_t nbFiles, size_t start, DupesLevel level)
+{
+    size_t end = start + 1;
+    while (end < nbFiles && XSUM_sameDupes(&files[start], &files[end], level))
+        end++;
+    return end;
+}
+
+/*
+ * Sorts `files`, then submits `job` for each file not hashed yet
+ * within runs of at least 2 files identical at `level`.
+ */
+static size_t XSUM_dupesSubmitRuns(XSUM_pool* pool, DupeFile* files, size_t nbFiles,
+                                   DupesLevel level, XSUM_poolJob_f job)
+{
+    size_t start = 0, nbSubmitted = 0;
+    qsort(files, nbFiles, sizeof(*files), XSUM_compareDupeFiles);
+    while (start < nbFiles) {
+        size_t const end = XSUM_dupesRunEnd(files, nbFiles, start, level);
+        if (end - start > 1) {
+            size_t n;
+            for (n = start; n < end; n++) {
+                if (files[n].hashed) continue;
+                XSUM_pool_add(pool, job, &files[n], NULL);
+                nbSubmitted++;
+        }   }
+        start = end;
+    }
+    XSUM_pool_waitAll(pool);
+    return nbSubmitted;
+}
+
+static int XSUM_displayDupes(DupeFile* files, size_t nbFiles, const HashFilesArg* arg,
+                             size_t* nbDupes, size_t* nbGroups)
+{
+    XSUM_displayLine_f const f_displayLine = XSUM_kDisplayLine_fTable[arg->convention][arg->displayEndianess];
+    size_t start = 0;
+    int result = 0;
+    *nbDupes = *nbGroups = 0;
+    qsort(files, nbFiles, sizeof(*files), XSUM_compareDupeFiles);
+    while (start < nbFiles) {
+        size_t const end = XSUM_dupesRunEnd(files, nbFiles, start, dupes_sameContent);
+        if (files[start].excluded) {
+            /* report errors, silently skip ignored files */
+            if (files[start].job.status != HashFile_ok)
+                result |= XSUM_displayHashFileJob(&files[start].job, arg);
+        } else if (end - start > 1 && files[start].hashed) {
+            size_t n;
+            qsort(files + start, end - start, sizeof(*files), XSUM_compareDupeNames);
+            if (*nbGroups > 0) XSUM_output("\n");
+            for (n = start; n < end; n++) {
+                unsigned char canonical[sizeof(XXH128_canonical_t)];
+                XSUM_canonicalFromMultihash(canonical, algo_xxh128, files[n].job.hashes[algo_xxh128]);
+                f_displayLine(files[n].job.fileName, canonical, algo_xxh128);
+            }
+            *nbDupes += end - start - 1;
+            (*nbGroups)++;
+        }
+        start = end;
+    }
+    return result;
+}
+
+/*
+ * XSUM_findDupes:
+ * Lists files of `fnList`, and of directories below them with -r,
+ * then displays groups of files with identical content,
+ * separated by empty lines, with their XXH128.
+ */
+static int XSUM_findDupes(const char* fnList[], int fnTotal, const HashFilesArg* arg)
+{
+    WalkCtx ctx;
+    DupeFile* files = NULL;
+    size_t n, nbSameSize, nbSameFingerprint, nbDupes = 0, nbGroups = 0;
+    int fnNb;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arg = arg;
+    ctx.collect = 1;
+    ctx.pool = XSUM_pool_create(arg->nbThreads);
+    if (ctx.pool == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+
+    /* List files */
+    for (fnNb = 0; fnNb < fnTotal; fnNb++) {
+        if (arg->recursive && XSUM_isDirectory(fnList[fnNb])) {
+            XSUM_walkTree(&ctx, fnList[fnNb]);
+        } else {
+            char* const fileName = XSUM_strdup(fnList[fnNb]);
+            if (fileName == NULL) {
+                XSUM_walkReportError(&ctx, "Out of memory", fnList[fnNb]);
+                continue;
+            }
+            XSUM_walkFile(&ctx, fileName);
+    }   }
+    if (ctx.nbFiles == 0) {
+        XSUM_pool_free(ctx.pool);
+        return ctx.result;
+    }
+    files = (DupeFile*)calloc(ctx.nbFiles, sizeof(DupeFile));
+    if (files == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        for (n = 0; n < ctx.nbFiles; n++) free(ctx.fileNames[n]);
+        free(ctx.fileNames);
+        XSUM_pool_free(ctx.pool);
+        return 1;
+    }
+    for (n = 0; n < ctx.nbFiles; n++) {
+        files[n].job.fileName = ctx.fileNames[n];
+        files[n].job.ownedFileName = ctx.fileNames[n];
+        files[n].job.algos = &arg->algos;
+        files[n].job.cache = arg->cache;
+        XSUM_pool_add(ctx.pool, XSUM_dupeStatJob, &files[n], NULL);
+    }
+    free(ctx.fileNames);
+    XSUM_pool_waitAll(ctx.pool);
+
+    /* Ignore the same file listed twice, or through hard links */
+    qsort(files, ctx.nbFiles, sizeof(*files), XSUM_compareDupeFiles);
+    {   size_t first = 0;
+        for (n = 1; n < ctx.nbFiles; n++) {
+            const DupeFile* const prev = &files[first];
+            if ( XSUM_sameDupes(prev, &files[n], dupes_sameSize)
+              && ( (prev->job.stat.inode != 0 && prev->job.stat.inode == files[n].job.stat.inode
+                    && prev->job.stat.device == files[n].job.stat.device)
+                || !strcmp(prev->job.fileName, files[n].job.fileName) ) ) {
+                XSUM_logVerbose(3, "xxhsum: %s: same file as %s \n", files[n].job.fileName, prev->job.fileName);
+                files[n].excluded = 1;
+                continue;
+            }
+            first = n;
+    }   }
+
+    nbSameSize = XSUM_dupesSubmitRuns(ctx.pool, files, ctx.nbFiles, dupes_sameSize, XSUM_dupeFingerprintJob);
+    nbSameFingerprint = XSUM_dupesSubmitRuns(ctx.pool, files, ctx.nbFiles, dupes_sameFingerprint, XSUM_dupeHashJob);
+    for (n = 0; n < ctx.nbFiles; n++) {
+        if (files[n].hashed) XSUM_cacheHashFileJob(&files[n].job);
+    }
+    ctx.result |= XSUM_displayDupes(files, ctx.nbFiles, arg, &nbDupes, &nbGroups);
+    XSUM_logVerbose(2, "xxhsum: %u files, %u sampled, %u read past the samples, %u duplicates in %u groups \n",
+                    (unsigned)ctx.nbFiles, (unsigned)nbSameSize, (unsigned)nbSameFingerprint,
+                    (unsigned)nbDupes, (unsigned)nbGroups);
+
+    for (n = 0; n < ctx.nbFiles; n++) free(files[n].job.ownedFileName);
+    free(files);
+    XSUM_pool_free(ctx.pool);
+    return ctx.result;
+}
+
+
+/* ********************************************************
+*  Directory tree hash (--tree-hash)
+**********************************************************/
+
+/*
+ * The digest of a directory is the XXH128 of the records of its entries,
+ * sorted by name (byte order). Each record is, with integers in little endian:
+ *   type        1 byte   'f' regular file, 'd' directory
+ *   mode        4 bytes  permission bits
+ *   size        8 bytes  file size, 0 for directories
+ *   name size   4 bytes
+ *   name
+ *   digest     16 bytes  XXH128 of the file, or digest of the directory,
+ *                        in canonical (big endian) representation
+ * The root digest depends neither on the name nor on the mode of the root
+ * directory, so trees can be compared wherever they are stored.
+ *
+ * Entries are selected like with -r: symbolic links to files are followed,
+ * links to directories and special files are ignored.
+ *
+ * The tree is built bottom-up: each directory counts its pending entries,
+ * and the job completing the last one computes the directory's digest,
+ * then completes the directory within its parent.
+ */
+typedef struct TreeNode_s TreeNode;
+
+typedef struct {
+    XSUM_pool*          pool;
+    const HashFilesArg* arg;
+    int                 result;       /* protected by XSUM_pool_lock() */
+    /* digests of all directories, for --tree-index, protected by XSUM_pool_lock() */
+    TreeNode**          dirs;
+    size_t              nbDirs;
+    size_t              dirsCapacity;
+} TreeCtx;
+
+struct TreeNode_s {
+    TreeCtx*     ctx;
+    TreeNode*    parent;
+    const char*  name;           /* last component of job.fileName */
+    int          isDir;
+    int          failed;         /* this entry, or one below it, could not be read */
+    int          registered;     /* directory listed in TreeCtx.dirs, freed from there */
+    HashFileJob  job;            /* job.fileName is the owned path */
+    unsigned char digest[sizeof(XXH128_canonical_t)];
+    /* directories only */
+    TreeNode**   children;
+    size_t       nbChildren;
+    size_t       pending;        /* protected by XSUM_pool_lock() */
+};
+
+static void XSUM_treeReportError(TreeCtx* ctx, const char* msg, const char* fileName)
+{
+    XSUM_pool_lock(ctx->pool);
+    XSUM_log("xxhsum: %s: %s \n", fileName, msg);
+    ctx->result = 1;
+    XSUM_pool_unlock(ctx->pool);
+}
+
+static void XSUM_treeFreeNode(TreeNode* node)
+{
+    size_t n;
+    for (n = 0; n < node->nbChildren; n++)
+        XSUM_treeFreeNode(node->children[n]);
+    free(node->children);
+    free(node->job.ownedFileName);
+    free(node);
+}
+
+/* Takes ownership of `path` */
+static TreeNode* XSUM_treeCreateNode(TreeCtx* ctx, TreeNode* parent, char* path, size_t nameOffset, int isDir)
+{
+    TreeNode* const node = (TreeNode*)calloc(1, sizeof(TreeNode));
+    if (node == NULL) {
+        XSUM_treeReportError(ctx, "Out of memory", path);
+        free(path);
+        return NULL;
+    }
+    node->ctx = ctx;
+    node->parent = parent;
+    node->isDir = isDir;
+    node->job.fileName = path;
+    node->job.ownedFileName = path;
+    node->job.algos = &ctx->arg->algos;
+    node->job.cache = ctx->arg->cache;
+    node->job.stateDir = ctx->arg->stateDir;
+    node->name = path + nameOffset;
+    return node;
+}
+
+static void XSUM_treeWriteLE(XXH3_state_t* state, XSUM_U64 value, size_t size)
+{
+    unsigned char bytes[8];
+    size_t n;
+    for (n = 0; n < size; n++)
+        bytes[n] = (unsigned char)(value >> (8 * n));
+    (void)XXH3_128bits_update(state, bytes, size);
+}
+
+static int XSUM_compareTreeNodes(const void* p1, const void* p2)
+{
+    return strcmp((*(const TreeNode* const*)p1)->name, (*(const TreeNode* const*)p2)->name);
+}
+
+static void XSUM_treeChildDone(TreeNode* dir);
+
+/* All entries of `dir` are complete: computes its digest, then completes it in its parent */
+static void XSUM_treeFinishDir(TreeNode* dir)
+{
+    TreeCtx* const ctx = dir->ctx;
+    XXH3_state_t state;
+    size_t n;
+
+    if (dir->nbChildren > 1)
+        qsort(dir->children, dir->nbChildren, sizeof(TreeNode*), XSUM_compareTreeNodes);
+    (void)XXH3_128bits_reset(&state);
+    for (n = 0; n < dir->nbChildren; n++) {
+        const TreeNode* const child = dir->children[n];
+        size_t const nameSize = strlen(child->name);
+        unsigned char const type = child->isDir ? 'd' : 'f';
+        dir->failed |= child->failed;
+        (void)XXH3_128bits_update(&state, &type, 1);
+        XSUM_treeWriteLE(&state, child->job.stat.mode, 4);
+        XSUM_treeWriteLE(&state, child->isDir ? 0 : child->job.stat.size, 8);
+        XSUM_treeWriteLE(&state, nameSize, 4);
+        (void)XXH3_128bits_update(&state, child->name, nameSize);
+        (void)XXH3_128bits_update(&state, child->digest, sizeof(child->digest));
+    }
+    XXH128_canonicalFromHash((XXH128_canonical_t*)(void*)dir->digest, XXH3_128bits_digest(&state));
+
+    /* entries are not needed anymore, only directories are kept for the index */
+    for (n = 0; n < dir->nbChildren; n++) {
+        if (!dir->children[n]->registered) XSUM_treeFreeNode(dir->children[n]);
+    }
+    free(dir->children);
+    dir->children = NULL;
+    dir->nbChildren = 0;
+
+    XSUM_pool_lock(ctx->pool);
+    if (ctx->nbDirs == ctx->dirsCapacity) {
+        size_t const newCapacity = ctx->dirsCapacity ? ctx->dirsCapacity * 2 : 256;
+        TreeNode** const newDirs = (TreeNode**)realloc(ctx->dirs, newCapacity * sizeof(TreeNode*));
+        if (newDirs != NULL) {
+            ctx->dirs = newDirs;
+            ctx->dirsCapacity = newCapacity;
+    }   }
+    if (ctx->nbDirs < ctx->dirsCapacity) {
+        ctx->dirs[ctx->nbDirs++] = dir;
+        dir->registered = 1;
+    } else {
+        XSUM_log("\nError: Out of memory.\n");
+        ctx->result = 1;
+        dir->failed = 1;
+    }
+    XSUM_pool_unlock(ctx->pool);
+
+    if (dir->parent != NULL) XSUM_treeChildDone(dir->parent);
+}
+
+static void XSUM_treeChildDone(TreeNode* dir)
+{
+    int last;
+    XSUM_pool_lock(dir->ctx->pool);
+    assert(dir->pending > 0);
+    last = (--dir->pending == 0);
+    XSUM_pool_unlock(dir->ctx->pool);
+    if (last) XSUM_treeFinishDir(dir);
+}
+
+static void XSUM_treeFileJob(void* opaque)
+{
+    TreeNode* const node = (TreeNode*)opaque;
+    TreeCtx* const ctx = node->ctx;
+    XSUM_fileStat const st = node->job.stat;
+    XSUM_hashFileJob(&node->job);
+    if (!node->job.hasStat) node->job.stat = st;   /* only filled with --cache */
+    XSUM_pool_lock(ctx->pool);
+    if (node->job.status == HashFile_ok) {
+        XSUM_cacheHashFileJob(&node->job);
+        XSUM_canonicalFromMultihash(node->digest, algo_xxh128, node->job.hashes[algo_xxh128]);
+    } else {
+        ctx->result |= XSUM_displayHashFileJob(&node->job, ctx->arg);
+        node->failed = 1;
+    }
+    XSUM_pool_unlock(ctx->pool);
+    XSUM_treeChildDone(node->parent);
+}
+
+static void XSUM_treeDirJob(void* opaque)
+{
+    TreeNode* const dir = (TreeNode*)opaque;
+    TreeCtx* const ctx = dir->ctx;
+    size_t capacity = 0;
+
+    {   XSUM_dir* const dirHandle = XSUM_openDir(dir->job.fileName);
+        const char* name;
+        XSUM_fileType type;
+        if (dirHandle == NULL) {
+            XSUM_treeReportError(ctx, strerror(errno), dir->job.fileName);
+            dir->failed = 1;
+            dir->pending = 1;
+            XSUM_treeChildDone(dir);
+            return;
+        }
+        while ((name = XSUM_readDir(dirHandle, &type)) != NULL) {
+            char* const path = XSUM_pathJoin(dir->job.fileName, name);
+            TreeNode* child;
+            if (path == NULL) {
+                XSUM_treeReportError(ctx, "Out of memory", dir->job.fileName);
+                dir->failed = 1;
+                break;
+            }
+            if (type == XSUM_fileType_unknown) {
+                type = XSUM_getLinkType(path);
+            }
+            if (type == XSUM_fileType_symlink) {
+                /* Follow links to files, but never to directories (loops) */
+                type = XSUM_getFileType(path);
+                if (type == XSUM_fileType_directory) type = XSUM_fileType_other;
+            }
+            if (type != XSUM_fileType_regular && type != XSUM_fileType_directory) {
+                XSUM_logVerbose(3, "xxhsum: %s: skipped \n", path);
+                free(path);
+                continue;
+            }
+            child = XSUM_treeCreateNode(ctx, dir, path, strlen(path) - strlen(name), type == XSUM_fileType_directory);
+            if (child == NULL) {
+                dir->failed = 1;
+                break;
+            }
+            if (XSUM_statFile(path, &child->job.stat)) {
+                XSUM_treeReportError(ctx, strerror(errno), path);
+                child->failed = 1;
+            }
+            if (dir->nbChildren == capacity) {
+                size_t const newCapacity = capacity ? capacity * 2 : 16;
+                TreeNode** const newChildren = (TreeNode**)realloc(dir->children, newCapacity * sizeof(TreeNode*));
+                if (newChildren == NULL) {
+                    XSUM_treeReportError(ctx, "Out of memory", path);
+                    XSUM_treeFreeNode(child);
+                    dir->failed = 1;
+                    break;
+                }
+                dir->children = newChildren;
+                capacity = newCapacity;
+            }
+            dir->children[dir->nbChildren++] = child;
+        }
+        XSUM_closeDir(dirHandle);
+    }
+
+    /* +1: the directory can't complete before all its entries are submitted */
+    dir->pending = dir->nbChildren + 1;
+    {   size_t n;
+        size_t const nbChildren = dir->nbChildren;
+        TreeNode** const children = dir->children;
+        for (n = 0; n < nbChildren; n++) {
+            TreeNode* const child = children[n];
+            if (child->failed) {
+                XSUM_treeChildDone(dir);
+            } else if (child->isDir) {
+                XSUM_pool_add(ctx->pool, XSUM_treeDirJob, child, NULL);
+            } else {
+                /* files first, so that directories complete early */
+                XSUM_pool_addFront(ctx->pool, XSUM_treeFileJob, child, NULL);
+    }   }   }
+    XSUM_treeChildDone(dir);
+}
+
+static int XSUM_compareTreeDirs(const void* p1, const void* p2)
+{
+    return strcmp((*(const TreeNode* const*)p1)->job.fileName, (*(const TreeNode* const*)p2)->job.fileName);
+}
+
+/*
+ * XSUM_treeHash:
+ * Displays the tree digest of each directory of `fnList`.
+ * If `indexFileName` is not NULL, the digests of all directories below
+ * the only directory of `fnList` are also written into it, as XXH128
+ * checksum lines sorted by path, relative to that directory (".").
+ */
+static int XSUM_treeHash(const char* fnList[], int fnTotal, const HashFilesArg* arg, const char* indexFileName)
+{
+    XSUM_displayLine_f const f_displayLine = XSUM_kDisplayLine_fTable[arg->convention][arg->displayEndianess];
+    FILE* indexFile = NULL;
+    TreeCtx ctx;
+    int fnNb;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.arg = arg;
+    ctx.pool = XSUM_pool_create(arg->nbThreads);
+    if (ctx.pool == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+    if (indexFileName != NULL) {
+        indexFile = XSUM_fopen(indexFileName, "w");
+        if (indexFile == NULL) {
+            XSUM_log("Error: Could not open '%s': %s. \n", indexFileName, strerror(errno));
+            XSUM_pool_free(ctx.pool);
+            return 1;
+    }   }
+
+    for (fnNb = 0; fnNb < fnTotal; fnNb++) {
+        const char* const dirName = fnList[fnNb];
+        char* const rootName = XSUM_strdup(dirName);
+        TreeNode* root;
+        size_t n;
+        if (!XSUM_isDirectory(dirName)) {
+            XSUM_log("xxhsum: %s: Not a directory \n", dirName);
+            ctx.result = 1;
+            free(rootName);
+            continue;
+        }
+        if (rootName == NULL) {
+            XSUM_log("\nError: Out of memory.\n");
+            ctx.result = 1;
+            continue;
+        }
+        root = XSUM_treeCreateNode(&ctx, NULL, rootName, 0, 1);
+        if (root == NULL) continue;
+        XSUM_pool_add(ctx.pool, XSUM_treeDirJob, root, NULL);
+        XSUM_pool_waitAll(ctx.pool);
+
+        if (!root->failed) {
+            f_displayLine(dirName, root->digest, algo_xxh128);
+            if (indexFile != NULL) {
+                size_t const rootSize = strlen(dirName);
+                if (ctx.nbDirs > 1)
+                    qsort(ctx.dirs, ctx.nbDirs, sizeof(TreeNode*), XSUM_compareTreeDirs);
+                XSUM_setOutput(indexFile);
+                for (n = 0; n < ctx.nbDirs; n++) {
+                    const char* path = ctx.dirs[n]->job.fileName + rootSize;
+                    if (*path == '/') path++;
+                    f_displayLine(*path ? path : ".", ctx.dirs[n]->digest, algo_xxh128);
+                }
+                XSUM_setOutput(NULL);
+        }   }
+        if (!root->registered) XSUM_treeFreeNode(root);
+        for (n = 0; n < ctx.nbDirs; n++)
+            XSUM_treeFreeNode(ctx.dirs[n]);
+        ctx.nbDirs = 0;
+    }
+
+    if (indexFile != NULL && fclose(indexFile)) {
+        XSUM_log("Error: Could not write '%s': %s. \n", indexFileName, strerror(errno));
+        ctx.result = 1;
+    }
+    free(ctx.dirs);
+    XSUM_pool_free(ctx.pool);
+    return ctx.result;
+}
+
+
+/* ********************************************************
+*  Watch mode (--watch)
+**********************************************************/
+
+/*
+ * Keeps the checksum lines of all files below a directory in a manifest,
+ * in path order. After a first pass over the whole tree, only the files
+ * reported as written, created, moved or removed are hashed again.
+ * Events are gathered until none arrived for `debounceMs`, but for at most
+ * XSUM_WATCH_MAX_DELAY seconds, so that a file written continuously doesn't
+ * postpone updates forever. The manifest is then replaced atomically.
+ */
+#define XSUM_WATCH_DEBOUNCE_DEFAULT 500   /* ms */
+#define XSUM_WATCH_MAX_DELAY        10    /* s */
+
+typedef struct {
+    char*       path;
+    Multihash   hashes[XSUM_ALGO_MAX];   /* indexed by AlgoSelected */
+} WatchEntry;
+
+typedef struct {
+    const HashFilesArg* arg;
+    XSUM_pool*    pool;
+    const char*   manifestName;
+    XSUM_fileStat manifestStat;   /* the manifest itself is never listed */
+    int           hasManifestStat;
+    WatchEntry*   entries;        /* sorted by path */
+    size_t        nbEntries;
+    size_t        capacity;
+    char**        dirty;          /* paths to hash again, possibly repeated */
+    size_t        nbDirty;
+    size_t        dirtyCapacity;
+    int           changed;        /* the manifest must be written again */
+} WatchState;
+
+/* Returns the position of `path` in entries, or where it would be inserted */
+static size_t XSUM_watchFind(const WatchState* state, const char* path, int* found)
 {
-    XSUM_printLine_GNU_internal(filename, canonicalHash, hashType, XSUM_display_BigEndian);
+    size_t low = 0, high = state->nbEntries;
+    *found = 0;
+    while (low < high) {
+        size_t const mid = low + (high - low) / 2;
+        int const cmp = strcmp(state->entries[mid].path, path);
+        if (cmp == 0) { *found = 1; return mid; }
+        if (cmp < 0) low = mid + 1; else high = mid;
+    }
+    return low;
 }
 
-static void XSUM_printLine_GNU_LE(const char* filename,
-                                  const void* canonicalHash, const AlgoSelected hashType)
+static void XSUM_watchRemoveEntries(WatchState* state, size_t first, size_t nb)
 {
-    XSUM_printLine_GNU_internal(filename, canonicalHash, hashType, XSUM_display_LittleEndian);
+    size_t n;
+    if (nb == 0) return;
+    for (n = first; n < first + nb; n++)
+        free(state->entries[n].path);
+    memmove(state->entries + first, state->entries + first + nb,
+            (state->nbEntries - first - nb) * sizeof(WatchEntry));
+    state->nbEntries -= nb;
+    state->changed = 1;
 }
 
-typedef enum { big_endian, little_endian} Display_endianess;
-
-typedef enum { display_gnu, display_bsd } Display_convention;
+static void XSUM_watchRemoveFile(WatchState* state, const char* path)
+{
+    int found;
+    size_t const pos = XSUM_watchFind(state, path, &found);
+    if (found) XSUM_watchRemoveEntries(state, pos, 1);
+}
 
-typedef void (*XSUM_displayLine_f)(const char*, const void*, AlgoSelected);  /* line display signature */
+/* Forgets all files below `dirName`, which sort together after "dirName/" */
+static int XSUM_watchRemoveTree(WatchState* state, const char* dirName)
+{
+    char* const prefix = XSUM_pathJoin(dirName, "");
+    size_t prefixLen, first, last;
+    int found;
+    if (prefix == NULL) return 1;
+    prefixLen = strlen(prefix);
+    first = XSUM_watchFind(state, prefix, &found);
+    last = first;
+    while (last < state->nbEntries && !strncmp(state->entries[last].path, prefix, prefixLen))
+        last++;
+    XSUM_watchRemoveEntries(state, first, last - first);
+    free(prefix);
+    return 0;
+}
 
-static XSUM_displayLine_f XSUM_kDisplayLine_fTable[2][2] = {
-    { XSUM_printLine_GNU, XSUM_printLine_GNU_LE },
-    { XSUM_printLine_BSD, XSUM_printLine_BSD_LE }
-};
+/* Takes ownership of `path` */
+static int XSUM_watchMarkDirty(WatchState* state, char* path)
+{
+    if (path == NULL) return 1;
+    if (state->nbDirty == state->dirtyCapacity) {
+        size_t const newCapacity = state->dirtyCapacity ? state->dirtyCapacity * 2 : 256;
+        char** const newDirty = (char**)realloc(state->dirty, newCapacity * sizeof(char*));
+        if (newDirty == NULL) {
+            free(path);
+            return 1;
+        }
+        state->dirty = newDirty;
+        state->dirtyCapacity = newCapacity;
+    }
+    state->dirty[state->nbDirty++] = path;
+    return 0;
+}
 
-static int XSUM_hashFile(const char* fileName,
-                         const AlgoSelected hashType,
-                         const Display_endianess displayEndianess,
-                         const Display_convention convention)
+/* Marks all files below `dirName` as dirty */
+static int XSUM_watchScan(WatchState* state, const char* dirName)
 {
-    size_t const blockSize = 64 KB;
-    XSUM_displayLine_f const f_displayLine = XSUM_kDisplayLine_fTable[convention][displayEndianess];
-    FILE* inFile;
-    Multihash hashValue;
-    assert(displayEndianess==big_endian || displayEndianess==little_endian);
-    assert(convention==display_gnu || convention==display_bsd);
+    WalkCtx ctx;
+    size_t n;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pool = state->pool;
+    ctx.arg = state->arg;
+    ctx.collect = 1;
+    XSUM_walkTree(&ctx, dirName);
+    for (n = 0; n < ctx.nbFiles; n++)
+        ctx.result |= XSUM_watchMarkDirty(state, ctx.fileNames[n]);
+    free(ctx.fileNames);
+    return ctx.result;
+}
 
-    /* Check file existence */
-    if (fileName == stdinName) {
-        inFile = stdin;
-        fileName = stdinFileName; /* "stdin" */
-        XSUM_setBinaryMode(stdin);
-    } else {
-        if (XSUM_isDirectory(fileName)) {
-            XSUM_log("xxhsum: %s: Is a directory \n", fileName);
-            return 1;
+/* Records the digests of `job`, taking ownership of its file name */
+static int XSUM_watchSetEntry(WatchState* state, HashFileJob* job)
+{
+    const AlgoList* const algos = &state->arg->algos;
+    int found, n;
+    size_t const pos = XSUM_watchFind(state, job->fileName, &found);
+    WatchEntry* entry;
+
+    if (!found) {
+        if (state->nbEntries == state->capacity) {
+            size_t const newCapacity = state->capacity ? state->capacity * 2 : 1024;
+            WatchEntry* const newEntries = (WatchEntry*)realloc(state->entries, newCapacity * sizeof(WatchEntry));
+            if (newEntries == NULL) return 1;
+            state->entries = newEntries;
+            state->capacity = newCapacity;
         }
-        inFile = XSUM_fopen( fileName, "rb" );
-        if (inFile==NULL) {
-            XSUM_log("Error: Could not open '%s': %s. \n", fileName, strerror(errno));
-            return 1;
-    }   }
+        memmove(state->entries + pos + 1, state->entries + pos,
+                (state->nbEntries - pos) * sizeof(WatchEntry));
+        state->nbEntries++;
+        state->entries[pos].path = job->ownedFileName;
+        job->ownedFileName = NULL;
+        state->changed = 1;
+    }
+    entry = &state->entries[pos];
+    for (n = 0; n < algos->nbAlgos; n++) {
+        AlgoSelected const algo = algos->algos[n];
+        unsigned char oldDigest[XSUM_CACHE_DIGEST_MAX], newDigest[XSUM_CACHE_DIGEST_MAX];
+        XSUM_canonicalFromMultihash(oldDigest, algo, entry->hashes[algo]);
+        XSUM_canonicalFromMultihash(newDigest, algo, job->hashes[algo]);
+        if (!found || memcmp(oldDigest, newDigest, XSUM_algoLength[algo])) state->changed = 1;
+        entry->hashes[algo] = job->hashes[algo];
+    }
+    return 0;
+}
 
-    /* Memory allocation & streaming */
-    {   void* const buffer = malloc(blockSize);
-        if (buffer == NULL) {
+/* Updates the entry of a hashed file, or drops it, then releases its path */
+static int XSUM_watchFinishJob(WatchState* state, HashFileJob* job)
+{
+    int result = 0;
+    if (job->status == HashFile_ok) {
+        XSUM_cacheHashFileJob(job);
+        if (XSUM_watchSetEntry(state, job)) {
             XSUM_log("\nError: Out of memory.\n");
-            fclose(inFile);
-            return 1;
+            result = 1;
         }
+    } else {
+        /* a file removed meanwhile is simply dropped */
+        if (!(job->status == HashFile_openFailed && job->errorNb == ENOENT))
+            result = XSUM_displayHashFileJob(job, state->arg);
+        XSUM_watchRemoveFile(state, job->fileName);
+    }
+    free(job->ownedFileName);
+    return result;
+}
 
-        /* Stream file & update hash */
-        hashValue = XSUM_hashStream(inFile, hashType, buffer, blockSize);
+/*
+ * Hashes the dirty files again, in parallel, then updates their entries.
+ * At most 4 jobs per thread are in flight: the oldest one is finished
+ * before its slot is reused, as in XSUM_hashFilesQueue_add().
+ */
+static int XSUM_watchUpdate(WatchState* state)
+{
+    const HashFilesArg* const arg = state->arg;
+    size_t const nbSlots = 4 * (size_t)(arg->nbThreads > 1 ? arg->nbThreads : 1);
+    HashFileJob* slots;
+    size_t n, nbSubmitted = 0, nbFinished = 0;
+    int result = 0;
 
-        fclose(inFile);
-        free(buffer);
+    if (state->nbDirty == 0) return 0;
+    slots = (HashFileJob*)calloc(nbSlots, sizeof(HashFileJob));
+    if (slots == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;   /* dirty files are kept for the next attempt */
     }
-
-    /* display Hash value in selected format */
-    switch(hashType)
-    {
-    case algo_xxh32:
-        {   XXH32_canonical_t hcbe32;
-            (void)XXH32_canonicalFromHash(&hcbe32, hashValue.hash32);
-            f_displayLine(fileName, &hcbe32, hashType);
-            break;
-        }
-    case algo_xxh64:
-        {   XXH64_canonical_t hcbe64;
-            (void)XXH64_canonicalFromHash(&hcbe64, hashValue.hash64);
-            f_displayLine(fileName, &hcbe64, hashType);
-            break;
+    if (state->nbDirty > 1)
+        qsort(state->dirty, state->nbDirty, sizeof(char*), XSUM_compareFileNames);
+
+    for (n = 0; n < state->nbDirty; n++) {
+        char* const path = state->dirty[n];
+        XSUM_fileStat st;
+        HashFileJob* job;
+        if (n + 1 < state->nbDirty && !strcmp(path, state->dirty[n+1])) {
+            free(path);   /* several events for the same file */
+            continue;
         }
-    case algo_xxh128:
-        {   XXH128_canonical_t hcbe128;
-            (void)XXH128_canonicalFromHash(&hcbe128, hashValue.hash128);
-            f_displayLine(fileName, &hcbe128, hashType);
-            break;
+        if ( XSUM_getFileType(path) != XSUM_fileType_regular
+          || XSUM_statFile(path, &st) != 0
+          || ( state->hasManifestStat
+            && st.device == state->manifestStat.device && st.inode == state->manifestStat.inode ) ) {
+            /* removed, no longer a regular file, or the manifest itself */
+            XSUM_watchRemoveFile(state, path);
+            free(path);
+            continue;
         }
-    case algo_xxh3:
-        {   XXH64_canonical_t hcbe64;
-            (void)XXH64_canonicalFromHash(&hcbe64, hashValue.hash64);
-            f_displayLine(fileName, &hcbe64, hashType);
-            break;
+        if (nbSubmitted - nbFinished == nbSlots) {
+            job = &slots[nbFinished % nbSlots];
+            XSUM_pool_waitCompleted(state->pool, &job->completed);
+            result |= XSUM_watchFinishJob(state, job);
+            nbFinished++;
         }
-    default:
-        assert(0);  /* not possible */
+        job = &slots[nbSubmitted % nbSlots];
+        memset(job, 0, sizeof(*job));
+        job->fileName = path;
+        job->ownedFileName = path;
+        job->algos = &arg->algos;
+        job->cache = arg->cache;
+        job->stateDir = arg->stateDir;
+        nbSubmitted++;
+        XSUM_pool_add(state->pool, XSUM_hashFileJob, job, &job->completed);
     }
+    state->nbDirty = 0;
 
-    return 0;
+    for ( ; nbFinished < nbSubmitted; nbFinished++) {
+        HashFileJob* const job = &slots[nbFinished % nbSlots];
+        XSUM_pool_waitCompleted(state->pool, &job->completed);
+        result |= XSUM_watchFinishJob(state, job);
+    }
+    free(slots);
+    return result;
 }
 
+/* Replaces the manifest with the current entries */
+static int XSUM_watchWriteManifest(WatchState* state)
+{
+    size_t const tmpNameSize = strlen(state->manifestName) + 5;
+    char* const tmpName = (char*)malloc(tmpNameSize);
+    FILE* f;
+    size_t n;
+    int error = 0;
+
+    if (tmpName == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        return 1;
+    }
+    memcpy(tmpName, state->manifestName, tmpNameSize - 5);
+    memcpy(tmpName + tmpNameSize - 5, ".tmp", 5);
+    f = XSUM_fopen(tmpName, "w");
+    if (f == NULL) {
+        XSUM_log("Error: Could not open '%s': %s. \n", tmpName, strerror(errno));
+        free(tmpName);
+        return 1;
+    }
+    XSUM_setOutput(f);
+    for (n = 0; n < state->nbEntries; n++) {
+        HashFileJob job;
+        memset(&job, 0, sizeof(job));
+        job.fileName = state->entries[n].path;
+        job.algos = &state->arg->algos;
+        job.status = HashFile_ok;
+        memcpy(job.hashes, state->entries[n].hashes, sizeof(job.hashes));
+        (void)XSUM_displayHashFileJob(&job, state->arg);
+    }
+    XSUM_setOutput(NULL);
+    error |= ferror(f);
+    error |= fclose(f) != 0;
+
+#if defined(_WIN32)
+    if (!error) remove(state->manifestName);   /* rename() doesn't replace files */
+#endif
+    if (error || rename(tmpName, state->manifestName)) {
+        XSUM_log("Error: Could not write '%s': %s. \n", state->manifestName, strerror(errno));
+        remove(tmpName);
+        error = 1;
+    }
+    free(tmpName);
+    state->hasManifestStat = XSUM_statFile(state->manifestName, &state->manifestStat) == 0;
+    state->changed = 0;
+    XSUM_logVerbose(3, "xxhsum: %s: %lu files \n", state->manifestName, (unsigned long)state->nbEntries);
+    return error;
+}
 
 /*
- * XSUM_hashFiles:
- * If fnTotal==0, read from stdin instead.
+ * --watch: never returns, unless the manifest can't be written
+ * or the tree can't be watched anymore.
  */
-static int XSUM_hashFiles(const char* fnList[], int fnTotal,
-                          AlgoSelected hashType,
-                          Display_endianess displayEndianess,
-                          Display_convention convention)
+static int XSUM_watchTree(const char* dirName, const char* manifestName,
+                          const HashFilesArg* arg, int debounceMs)
 {
-    int fnNb;
-    int result = 0;
+    XSUM_watch* const watch = XSUM_watch_create();
+    WatchState state;
+    time_t pendingSince = 0;
+    int result = 1;
+
+    if (watch == NULL) {
+        XSUM_log("xxhsum: %s: %s \n", dirName,
+                 errno == ENOSYS ? "--watch is not supported on this platform" : strerror(errno));
+        return 1;
+    }
+    memset(&state, 0, sizeof(state));
+    state.arg = arg;
+    state.manifestName = manifestName;
+    state.hasManifestStat = XSUM_statFile(manifestName, &state.manifestStat) == 0;
+    state.pool = XSUM_pool_create(arg->nbThreads);
+    if (state.pool == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        XSUM_watch_free(watch);
+        return 1;
+    }
 
-    if (fnTotal==0)
-        return XSUM_hashFile(stdinName, hashType, displayEndianess, convention);
+    /* subscribe first, so that changes made during the first pass are seen */
+    if (XSUM_watch_addTree(watch, dirName)) {
+        XSUM_log("xxhsum: %s: %s \n", dirName, strerror(errno));
+    } else {
+        (void)XSUM_watchScan(&state, dirName);
+        (void)XSUM_watchUpdate(&state);
+        if (!XSUM_watchWriteManifest(&state)) for (;;) {
+            XSUM_watchEventType type;
+            const char* path;
+            int const pending = state.nbDirty > 0 || state.changed;
+            int const ready = XSUM_watch_next(watch, pending ? debounceMs : -1, &type, &path);
+            if (ready < 0) {
+                XSUM_log("xxhsum: %s: %s \n", dirName, strerror(errno));
+                break;
+            }
+            if (ready > 0) {
+                if (!pending) pendingSince = time(NULL);
+                switch (type)
+                {
+                case XSUM_watchEvent_file:
+                    (void)XSUM_watchMarkDirty(&state, XSUM_strdup(path));
+                    break;
+                case XSUM_watchEvent_dirAdded:
+                    (void)XSUM_watchScan(&state, path);
+                    break;
+                case XSUM_watchEvent_dirRemoved:
+                    (void)XSUM_watchRemoveTree(&state, path);
+                    break;
+                case XSUM_watchEvent_overflow:
+                default:
+                    {   size_t n;
+                        XSUM_log("xxhsum: %s: too many changes, scanning the whole tree again \n", dirName);
+                        (void)XSUM_watch_addTree(watch, dirName);
+                        for (n = 0; n < state.nbEntries; n++)
+                            (void)XSUM_watchMarkDirty(&state, XSUM_strdup(state.entries[n].path));
+                        (void)XSUM_watchScan(&state, dirName);
+                        break;
+                }   }
+                if (time(NULL) - pendingSince < XSUM_WATCH_MAX_DELAY) continue;
+            }
+            /* quiet for debounceMs, or busy for too long */
+            (void)XSUM_watchUpdate(&state);
+            if (state.changed && XSUM_watchWriteManifest(&state)) break;
+    }   }
 
-    for (fnNb=0; fnNb<fnTotal; fnNb++)
-        result |= XSUM_hashFile(fnList[fnNb], hashType, displayEndianess, convention);
-    XSUM_logVerbose(2, "\r%70s\r", "");
+    {   size_t n;
+        for (n = 0; n < state.nbEntries; n++) free(state.entries[n].path);
+        for (n = 0; n < state.nbDirty; n++) free(state.dirty[n]);
+    }
+    free(state.entries);
+    free(state.dirty);
+    XSUM_pool_free(state.pool);
+    XSUM_watch_free(watch);
     return result;
 }
 
@@ -539,22 +2517,74 @@ typedef struct {
     unsigned long   nOpenOrReadFailures;
     unsigned long   nMixedFormatLines;
     unsigned long   nMissing;
+    unsigned long   nNotListed;     /* --only paths missing from the index */
     int             quit;
+    int             stoppedEarly;   /* --status: remaining lines were not verified */
 } ParseFileReport;
 
+typedef struct {
+    ParsedLine      parsedLine;     /* filename points to CheckFileJob.fileName */
+    unsigned long   lineNumber;
+    LineStatus      lineStatus;
+} CheckedLine;
+
+/*
+ * One file being verified, for one checksum line, or several consecutive
+ * lines naming it with different algorithms (as produced by -H1,2):
+ * the file is then read only once.
+ * Files are opened and hashed by the pool while the main thread keeps parsing,
+ * results are then reported in line order.
+ */
+typedef struct {
+    CheckedLine     lines[XSUM_ALGO_MAX];
+    int             nbLines;
+    char*           fileName;       /* copy of the filename, since lineBuf is reused */
+    size_t          fileNameSize;
+    int             errorNb;        /* errno, for LineStatus_failedToOpen */
+    char*           blockBuf;       /* NULL with --disk-order: allocated per file */
+    size_t          blockSize;
+    XSUM_fileStats  stats;          /* --stats */
+    int             completed;      /* see XSUM_pool_waitCompleted() */
+} CheckFileJob;
+
+/*
+ * --disk-order: where a file is stored, to read a batch of files
+ * in one sweep across the disk.
+ */
+typedef struct {
+    XSUM_U64        device;
+    int             rank;           /* 0: can't be found, 1: physical offset, 2: inode only */
+    XSUM_U64        position;       /* physical offset, or inode number */
+    size_t          slot;           /* in ParseFileArg.jobs */
+} DiskPosition;
+
 typedef struct {
     const char*     inFileName;
     FILE*           inFile;
     int             lineMax;
     char*           lineBuf;
-    size_t          blockSize;
-    char*           blockBuf;
+    XSUM_pool*      pool;
+    CheckFileJob*   jobs;           /* window of files in flight */
+    size_t          nbJobs;
+    size_t          nbSubmitted;
+    size_t          nbReported;
+    int             collecting;     /* jobs[nbSubmitted % nbJobs] is collecting lines */
     XSUM_U32        strictMode;
     XSUM_U32        statusOnly;
     XSUM_U32        ignoreMissing;
     XSUM_U32        warn;
     XSUM_U32        quiet;
     XSUM_U32        algoBitmask;
+    XSUM_index*     index;          /* binary index, instead of inFile */
+    const char* const* onlyList;    /* --only: paths to look up in the index */
+    int             nbOnly;
+    int             diskOrder;      /* --disk-order: jobs are read by position, nbJobs at a time */
+    int             completionOrder;/* --completion-order: files are reported as soon as verified */
+    size_t          nbDispatched;   /* --disk-order: jobs from nbDispatched to nbSubmitted wait */
+    DiskPosition*   positions;      /* --disk-order: nbJobs */
+    CheckFileJob**  pendingJobs;    /* --completion-order: unreported jobs, in read order */
+    const int**     pendingFlags;   /* --completion-order: `completed` of pendingJobs */
+    size_t          nbPending;
     ParseFileReport report;
 } ParseFileArg;
 
@@ -800,6 +2830,282 @@ static ParseLineResult XSUM_parseLine(ParsedLine* parsedLine, char* line, int re
 
 
 
+/*
+ * Opens and hashes the file of `job` once, then compares the digests of all its lines.
+ */
+static void XSUM_checkFileJob(void* opaque)
+{
+    CheckFileJob* const job = (CheckFileJob*)opaque;
+    XSUM_fileStats* const stats = XSUM_statsEnabled ? &job->stats : NULL;
+    XSUM_U64 const openStart = (stats != NULL) ? XSUM_clockNs() : 0;
+    int const fnameIsStdin = (strcmp(job->fileName, stdinFileName) == 0); /* "stdin" */
+    FILE* const fp = fnameIsStdin ? stdin : XSUM_fopen(job->fileName, "rb");
+    char* const blockBuf = (job->blockBuf != NULL) ? job->blockBuf : (char*)malloc(job->blockSize);
+    XSUM_U32 algoBitmask = 0;
+    Multihash hashes[XSUM_ALGO_MAX];
+    int n;
+
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->readNs = XSUM_clockNs() - openStart;
+        if (fp != NULL && fp != stdin) stats->size = XSUM_getFileSize(job->fileName);
+    }
+    if (fp == stdin) {
+        XSUM_setBinaryMode(stdin);
+    }
+    if (fp == NULL || blockBuf == NULL) {
+        job->errorNb = (fp == NULL) ? errno : ENOMEM;
+        for (n = 0; n < job->nbLines; n++)
+            job->lines[n].lineStatus = LineStatus_failedToOpen;
+        if (fp != NULL && fp != stdin) fclose(fp);
+        if (blockBuf != job->blockBuf) free(blockBuf);
+        return;
+    }
+    for (n = 0; n < job->nbLines; n++)
+        algoBitmask |= XSUM_algoBitmask_ComputeAlgoBitmaskFromAlgoSelected(job->lines[n].parsedLine.algo);
+    XSUM_hashStream(fp, algoBitmask, hashes, blockBuf, job->blockSize, stats);
+    if (stats != NULL && stats->size < stats->bytes)
+        stats->size = stats->bytes;   /* pipe, or growing file */
+    if (blockBuf != job->blockBuf) free(blockBuf);
+    for (n = 0; n < job->nbLines; n++) {
+        CheckedLine* const line = &job->lines[n];
+        AlgoSelected const algo = line->parsedLine.algo;
+        unsigned char canonical[sizeof(Canonical)];
+        XSUM_canonicalFromMultihash(canonical, algo, hashes[algo]);
+        line->lineStatus = memcmp(canonical, &line->parsedLine.canonical, XSUM_algoLength[algo])
+                         ? LineStatus_hashFailed : LineStatus_hashOk;
+    }
+    if (fp != stdin) fclose(fp);
+}
+
+/*
+ * Accounts for the lines of a verified file, and displays them.
+ */
+static void XSUM_reportFile(ParseFileArg* XSUM_parseFileArg, const CheckFileJob* job)
+{
+    const char* const inFileName = XSUM_parseFileArg->inFileName;
+    ParseFileReport* const report = &XSUM_parseFileArg->report;
+    int n;
+
+    if ( XSUM_statsEnabled && job->nbLines > 0
+      && ( job->lines[0].lineStatus == LineStatus_hashOk
+        || job->lines[0].lineStatus == LineStatus_hashFailed ) )
+        XSUM_stats_addFile(&job->stats, 0);
+    for (n = 0; n < job->nbLines; n++) {
+        const CheckedLine* const line = &job->lines[n];
+        switch (line->lineStatus)
+        {
+        default:
+            XSUM_log("%s: Error: Unknown error.\n", inFileName);
+            report->quit = 1;
+            break;
+
+        case LineStatus_failedToOpen:
+            if (XSUM_parseFileArg->ignoreMissing) {
+                report->nMissing++;
+            } else {
+                report->nOpenOrReadFailures++;
+                if (!XSUM_parseFileArg->statusOnly) {
+                    XSUM_output("%s:%lu: Could not open or read '%s': %s.\n",
+                        inFileName, line->lineNumber, job->fileName, strerror(job->errorNb));
+                }
+            }
+            break;
+
+        case LineStatus_hashOk:
+        case LineStatus_hashFailed:
+            {   int b = 1;
+                if (line->lineStatus == LineStatus_hashOk) {
+                    report->nMatchedChecksums++;
+                    /* If --quiet is specified, don't display "OK" */
+                    if (XSUM_parseFileArg->quiet) b = 0;
+                } else {
+                    report->nMismatchedChecksums++;
+                }
+
+                if (b && !XSUM_parseFileArg->statusOnly) {
+                    const int needsEscape = XSUM_filenameNeedsEscape(job->fileName);
+                    if (needsEscape) {
+                        XSUM_output("%c", '\\');
+                    }
+                    XSUM_printFilename(job->fileName, needsEscape);
+                    XSUM_output(": %s\n", line->lineStatus == LineStatus_hashOk ? "OK" : "FAILED");
+            }   }
+            break;
+        }
+    }
+}
+
+/*
+ * Waits for the oldest pending file, then reports it.
+ */
+static void XSUM_reportNextFile(ParseFileArg* XSUM_parseFileArg)
+{
+    CheckFileJob* const job = &XSUM_parseFileArg->jobs[XSUM_parseFileArg->nbReported % XSUM_parseFileArg->nbJobs];
+    assert(XSUM_parseFileArg->nbReported < XSUM_parseFileArg->nbSubmitted);
+    XSUM_pool_waitCompleted(XSUM_parseFileArg->pool, &job->completed);
+    XSUM_parseFileArg->nbReported++;
+    XSUM_reportFile(XSUM_parseFileArg, job);
+}
+
+/* --completion-order: `job` is being read, after those already pending */
+static void XSUM_addPending(ParseFileArg* XSUM_parseFileArg, CheckFileJob* job)
+{
+    if (!XSUM_parseFileArg->completionOrder) return;
+    assert(XSUM_parseFileArg->nbPending < XSUM_parseFileArg->nbJobs);
+    XSUM_parseFileArg->pendingJobs[XSUM_parseFileArg->nbPending] = job;
+    XSUM_parseFileArg->pendingFlags[XSUM_parseFileArg->nbPending] = &job->completed;
+    XSUM_parseFileArg->nbPending++;
+}
+
+/* Orders files by (device, rank, position), then in list order */
+static int XSUM_compareDiskPositions(const void* a, const void* b)
+{
+    const DiskPosition* const pa = (const DiskPosition*)a;
+    const DiskPosition* const pb = (const DiskPosition*)b;
+    if (pa->device != pb->device) return pa->device < pb->device ? -1 : 1;
+    if (pa->rank != pb->rank) return pa->rank < pb->rank ? -1 : 1;
+    if (pa->position != pb->position) return pa->position < pb->position ? -1 : 1;
+    return (pa->slot < pb->slot) ? -1 : (pa->slot > pb->slot);
+}
+
+/*
+ * --disk-order: queues the waiting jobs by position on disk,
+ * so that the batch is read in one sweep rather than in list order.
+ * Files whose physical offset is unknown are ordered by inode number,
+ * which most file systems allocate close to their data.
+ */
+static void XSUM_dispatchByPosition(ParseFileArg* XSUM_parseFileArg)
+{
+    size_t const nbWaiting = XSUM_parseFileArg->nbSubmitted - XSUM_parseFileArg->nbDispatched;
+    size_t n;
+
+    for (n = 0; n < nbWaiting; n++) {
+        DiskPosition* const pos = &XSUM_parseFileArg->positions[n];
+        size_t const slot = (XSUM_parseFileArg->nbDispatched + n) % XSUM_parseFileArg->nbJobs;
+        const char* const fileName = XSUM_parseFileArg->jobs[slot].fileName;
+        XSUM_fileStat st;
+        memset(pos, 0, sizeof(*pos));
+        pos->slot = slot;
+        if (XSUM_statFile(fileName, &st) != 0) continue;   /* fails quickly: first */
+        pos->device = st.device;
+        if (XSUM_getPhysicalOffset(fileName, &pos->position) == 0) {
+            pos->rank = 1;
+        } else {
+            pos->rank = 2;
+            pos->position = st.inode;
+    }   }
+    if (nbWaiting > 1)
+        qsort(XSUM_parseFileArg->positions, nbWaiting, sizeof(DiskPosition), XSUM_compareDiskPositions);
+    for (n = 0; n < nbWaiting; n++) {
+        CheckFileJob* const job = &XSUM_parseFileArg->jobs[XSUM_parseFileArg->positions[n].slot];
+        XSUM_addPending(XSUM_parseFileArg, job);
+        XSUM_pool_add(XSUM_parseFileArg->pool, XSUM_checkFileJob, job, &job->completed);
+    }
+    XSUM_parseFileArg->nbDispatched = XSUM_parseFileArg->nbSubmitted;
+}
+
+/*
+ * Reports all submitted files: in list order,
+ * or with --completion-order, as soon as each one is verified.
+ */
+static void XSUM_reportAllFiles(ParseFileArg* XSUM_parseFileArg)
+{
+    if (XSUM_parseFileArg->diskOrder)
+        XSUM_dispatchByPosition(XSUM_parseFileArg);
+    if (XSUM_parseFileArg->completionOrder) {
+        /* among completed files, the first one read is reported first */
+        while (XSUM_parseFileArg->nbPending > 0) {
+            size_t const done = XSUM_pool_waitAny(XSUM_parseFileArg->pool,
+                                    XSUM_parseFileArg->pendingFlags, XSUM_parseFileArg->nbPending);
+            size_t const nbAfter = XSUM_parseFileArg->nbPending - done - 1;
+            XSUM_reportFile(XSUM_parseFileArg, XSUM_parseFileArg->pendingJobs[done]);
+            memmove(XSUM_parseFileArg->pendingJobs + done, XSUM_parseFileArg->pendingJobs + done + 1,
+                    nbAfter * sizeof(CheckFileJob*));
+            memmove((void*)(XSUM_parseFileArg->pendingFlags + done), XSUM_parseFileArg->pendingFlags + done + 1,
+                    nbAfter * sizeof(const int*));
+            XSUM_parseFileArg->nbPending--;
+        }
+        XSUM_parseFileArg->nbReported = XSUM_parseFileArg->nbSubmitted;
+    }
+    while (XSUM_parseFileArg->nbReported < XSUM_parseFileArg->nbSubmitted)
+        XSUM_reportNextFile(XSUM_parseFileArg);
+}
+
+/*
+ * Queues verification of the job collecting lines.
+ * The "stdin" entry is verified by the caller, after all previous lines.
+ */
+static void XSUM_submitFile(ParseFileArg* XSUM_parseFileArg)
+{
+    CheckFileJob* const job = &XSUM_parseFileArg->jobs[XSUM_parseFileArg->nbSubmitted % XSUM_parseFileArg->nbJobs];
+    assert(XSUM_parseFileArg->collecting);
+    XSUM_parseFileArg->collecting = 0;
+
+    if (strcmp(job->fileName, stdinFileName) == 0) { /* "stdin" */
+        XSUM_reportAllFiles(XSUM_parseFileArg);
+        XSUM_parseFileArg->nbSubmitted++;
+        XSUM_parseFileArg->nbDispatched = XSUM_parseFileArg->nbSubmitted;
+        XSUM_checkFileJob(job);
+        job->completed = 1;
+        XSUM_addPending(XSUM_parseFileArg, job);
+    } else if (XSUM_parseFileArg->diskOrder) {
+        XSUM_parseFileArg->nbSubmitted++;   /* queued with its batch */
+    } else {
+        XSUM_parseFileArg->nbSubmitted++;
+        XSUM_pool_add(XSUM_parseFileArg->pool, XSUM_checkFileJob, job, &job->completed);
+    }
+}
+
+/*
+ * Adds `parsedLine` to the job collecting lines if it names the same file
+ * with another algorithm. Otherwise, submits that job and starts a new one,
+ * reporting older files if the window is full.
+ * Returns 0 on success, 1 on allocation failure.
+ */
+static int XSUM_addLine(ParseFileArg* XSUM_parseFileArg, const ParsedLine* parsedLine, unsigned long lineNumber)
+{
+    CheckFileJob* job = &XSUM_parseFileArg->jobs[XSUM_parseFileArg->nbSubmitted % XSUM_parseFileArg->nbJobs];
+
+    if (XSUM_parseFileArg->collecting) {
+        int sameFile = (job->nbLines < XSUM_ALGO_MAX) && !strcmp(job->fileName, parsedLine->filename);
+        int n;
+        for (n = 0; sameFile && n < job->nbLines; n++)
+            if (job->lines[n].parsedLine.algo == parsedLine->algo) sameFile = 0;
+        if (!sameFile) {
+            XSUM_submitFile(XSUM_parseFileArg);
+            job = &XSUM_parseFileArg->jobs[XSUM_parseFileArg->nbSubmitted % XSUM_parseFileArg->nbJobs];
+    }   }
+
+    if (!XSUM_parseFileArg->collecting) {
+        size_t const fileNameSize = strlen(parsedLine->filename) + 1;
+        if (XSUM_parseFileArg->nbSubmitted - XSUM_parseFileArg->nbReported == XSUM_parseFileArg->nbJobs) {
+            /* --disk-order: the batch is complete */
+            if (XSUM_parseFileArg->diskOrder) XSUM_reportAllFiles(XSUM_parseFileArg);
+            else XSUM_reportNextFile(XSUM_parseFileArg);
+        }
+        /* lineBuf is reused by the next line: keep a copy of the filename */
+        if (job->fileNameSize < fileNameSize) {
+            char* const fileName = (char*)realloc(job->fileName, fileNameSize);
+            if (fileName == NULL) return 1;
+            job->fileName = fileName;
+            job->fileNameSize = fileNameSize;
+        }
+        memcpy(job->fileName, parsedLine->filename, fileNameSize);
+        job->nbLines = 0;
+        job->errorNb = 0;
+        XSUM_parseFileArg->collecting = 1;
+    }
+
+    {   CheckedLine* const line = &job->lines[job->nbLines++];
+        line->parsedLine = *parsedLine;
+        line->parsedLine.filename = job->fileName;
+        line->lineNumber = lineNumber;
+        line->lineStatus = LineStatus_hashFailed;
+    }
+    return 0;
+}
+
 /*!
  * Parse xxHash checksum file.
  */
@@ -810,12 +3116,22 @@ static void XSUM_parseFile1(ParseFileArg* XSUM_parseFileArg, int rev)
 
     unsigned long lineNumber = 0;
     memset(report, 0, sizeof(*report));
+    XSUM_parseFileArg->nbSubmitted = 0;
+    XSUM_parseFileArg->nbReported = 0;
+    XSUM_parseFileArg->nbDispatched = 0;
+    XSUM_parseFileArg->collecting = 0;
 
     while (!report->quit) {
-        LineStatus lineStatus = LineStatus_hashFailed;
         ParsedLine parsedLine;
         memset(&parsedLine, 0, sizeof(parsedLine));
 
+        /* --status: the first failure decides the result, skip the rest */
+        if ( XSUM_parseFileArg->statusOnly
+          && (report->nMismatchedChecksums || report->nOpenOrReadFailures) ) {
+            report->stoppedEarly = 1;
+            break;
+        }
+
         lineNumber++;
         if (lineNumber == 0) {
             /* This is unlikely happen, but md5sum.c has this error check. */
@@ -874,87 +3190,102 @@ static void XSUM_parseFile1(ParseFileArg* XSUM_parseFileArg, int rev)
 
         report->nProperlyFormattedLines++;
 
-        do {
-            int const fnameIsStdin = (strcmp(parsedLine.filename, stdinFileName) == 0); /* "stdin" */
-            FILE* const fp = fnameIsStdin ? stdin : XSUM_fopen(parsedLine.filename, "rb");
-            if (fp == stdin) {
-                XSUM_setBinaryMode(stdin);
-            }
-            if (fp == NULL) {
-                lineStatus = LineStatus_failedToOpen;
-                break;
-            }
-            lineStatus = LineStatus_hashFailed;
-            {   Multihash const xxh = XSUM_hashStream(fp, parsedLine.algo, XSUM_parseFileArg->blockBuf, XSUM_parseFileArg->blockSize);
-                switch (parsedLine.algo)
-                {
-                case algo_xxh32:
-                    if (xxh.hash32 == XXH32_hashFromCanonical(&parsedLine.canonical.xxh32)) {
-                        lineStatus = LineStatus_hashOk;
-                    }
-                    break;
+        if (XSUM_addLine(XSUM_parseFileArg, &parsedLine, lineNumber)) {
+            XSUM_log("%s:%lu: Error: Out of memory.\n", inFileName, lineNumber);
+            report->quit = 1;
+        }
+    }   /* while (!report->quit) */
 
-                case algo_xxh64:
-                case algo_xxh3:
-                    if (xxh.hash64 == XXH64_hashFromCanonical(&parsedLine.canonical.xxh64)) {
-                        lineStatus = LineStatus_hashOk;
-                    }
-                    break;
+    if (XSUM_parseFileArg->collecting)
+        XSUM_submitFile(XSUM_parseFileArg);
+    /* lines preceding an early exit are still reported */
+    XSUM_reportAllFiles(XSUM_parseFileArg);
+}
 
-                case algo_xxh128:
-                    if (XXH128_isEqual(xxh.hash128, XXH128_hashFromCanonical(&parsedLine.canonical.xxh128))) {
-                        lineStatus = LineStatus_hashOk;
-                    }
-                    break;
+/*
+ * Verifies the entries of a binary index: all of them in path order, or only
+ * the paths given by --only, each one found by a binary search.
+ * Entry numbers stand for line numbers in messages.
+ */
+static void XSUM_parseIndex(ParseFileArg* XSUM_parseFileArg)
+{
+    const char* const inFileName = XSUM_parseFileArg->inFileName;
+    const XSUM_index* const index = XSUM_parseFileArg->index;
+    ParseFileReport* const report = &XSUM_parseFileArg->report;
+    size_t const nbLookups = XSUM_parseFileArg->nbOnly > 0 ? (size_t)XSUM_parseFileArg->nbOnly
+                                                            : XSUM_index_nbEntries(index);
+    AlgoSelected algo = algo_xxh32;
+    int algoFound = 0;
+    int a;
+    size_t n;
 
-                default:
-                    break;
-                }
-            }
-            if (fp != stdin) fclose(fp);
-        } while (0);
+    memset(report, 0, sizeof(*report));
+    XSUM_parseFileArg->nbSubmitted = 0;
+    XSUM_parseFileArg->nbReported = 0;
+    XSUM_parseFileArg->nbDispatched = 0;
+    XSUM_parseFileArg->collecting = 0;
+
+    for (a = 0; a < XSUM_ALGO_MAX; a++) {
+        if ( !strcmp(XSUM_index_algoName(index), XSUM_algoName[a])
+          && XSUM_index_digestSize(index) == XSUM_algoLength[a] ) {
+            algo = (AlgoSelected)a;
+            algoFound = 1;
+    }   }
+    if (!algoFound || !XSUM_algoBitmask_Accepts(XSUM_parseFileArg->algoBitmask, algo)) {
+        XSUM_log("%s: Error: %s digests are not accepted.\n", inFileName, XSUM_index_algoName(index));
+        report->quit = 1;
+        return;
+    }
 
-        switch (lineStatus)
-        {
-        default:
-            XSUM_log("%s: Error: Unknown error.\n", inFileName);
-            report->quit = 1;
+    for (n = 0; n < nbLookups && !report->quit; n++) {
+        ParsedLine parsedLine;
+        size_t entryNb = n;
+        const unsigned char* digest;
+        const char* path;
+
+        /* --status: the first failure decides the result, skip the rest */
+        if ( XSUM_parseFileArg->statusOnly
+          && (report->nMismatchedChecksums || report->nOpenOrReadFailures || report->nNotListed) ) {
+            report->stoppedEarly = 1;
             break;
+        }
 
-        case LineStatus_failedToOpen:
-            if (XSUM_parseFileArg->ignoreMissing) {
-                report->nMissing++;
-            } else {
-                report->nOpenOrReadFailures++;
-                if (!XSUM_parseFileArg->statusOnly) {
-                    XSUM_output("%s:%lu: Could not open or read '%s': %s.\n",
-                        inFileName, lineNumber, parsedLine.filename, strerror(errno));
-                }
+        if (XSUM_parseFileArg->nbOnly > 0) {
+            entryNb = XSUM_index_find(index, XSUM_parseFileArg->onlyList[n]);
+            if (entryNb == XSUM_INDEX_NOT_FOUND) {
+                /* keep messages in the order of --only */
+                if (XSUM_parseFileArg->collecting)
+                    XSUM_submitFile(XSUM_parseFileArg);
+                XSUM_reportAllFiles(XSUM_parseFileArg);
+                report->nNotListed++;
+                if (!XSUM_parseFileArg->statusOnly)
+                    XSUM_output("%s: '%s' is not listed.\n", inFileName, XSUM_parseFileArg->onlyList[n]);
+                continue;
+        }   }
+
+        digest = XSUM_index_entry(index, entryNb, &path);
+        if (digest == NULL) {
+            report->nImproperlyFormattedLines++;
+            if (XSUM_parseFileArg->warn) {
+                XSUM_log("%s:%lu: Error: Damaged index entry.\n",
+                        inFileName, (unsigned long)entryNb + 1);
             }
-            break;
+            continue;
+        }
+        report->nProperlyFormattedLines++;
 
-        case LineStatus_hashOk:
-        case LineStatus_hashFailed:
-            {   int b = 1;
-                if (lineStatus == LineStatus_hashOk) {
-                    report->nMatchedChecksums++;
-                    /* If --quiet is specified, don't display "OK" */
-                    if (XSUM_parseFileArg->quiet) b = 0;
-                } else {
-                    report->nMismatchedChecksums++;
-                }
+        memset(&parsedLine, 0, sizeof(parsedLine));
+        memcpy(&parsedLine.canonical, digest, XSUM_algoLength[algo]);
+        parsedLine.filename = path;
+        parsedLine.algo = algo;
+        if (XSUM_addLine(XSUM_parseFileArg, &parsedLine, (unsigned long)entryNb + 1)) {
+            XSUM_log("%s: Error: Out of memory.\n", inFileName);
+            report->quit = 1;
+    }   }
 
-                if (b && !XSUM_parseFileArg->statusOnly) {
-                    const int needsEscape = XSUM_filenameNeedsEscape(parsedLine.filename);
-                    if (needsEscape) {
-                        XSUM_output("%c", '\\');
-                    }
-                    XSUM_printFilename(parsedLine.filename, needsEscape);
-                    XSUM_output(": %s\n", lineStatus == LineStatus_hashOk ? "OK" : "FAILED");
-            }   }
-            break;
-        }
-    }   /* while (!report->quit) */
+    if (XSUM_parseFileArg->collecting)
+        XSUM_submitFile(XSUM_parseFileArg);
+    XSUM_reportAllFiles(XSUM_parseFileArg);
 }
 
 
@@ -967,6 +3298,11 @@ static void XSUM_parseFile1(ParseFileArg* XSUM_parseFileArg, int rev)
  *  If ignoreMissing != 0, ignore missing file.  But if no file was verified, returns 0 (failed).
  *  If warn != 0, print a warning message to stderr.
  *  If quiet != 0, suppress "OK" line.
+ *  nbThreads > 1 verifies files in parallel; lines are still reported in order.
+ *  inFileName can also be a binary index (--convert), in which case nbOnly > 0
+ *  restricts verification to the paths of onlyList.
+ *  diskOrder > 0 reads files by batches of diskOrder, each batch sorted by
+ *  position on disk; completionOrder then reports files as they are verified.
  *
  *  "All procedures are succeeded" means:
  *    - Checksum file contains at least one line and less than SIZE_T_MAX lines.
@@ -981,10 +3317,16 @@ static int XSUM_checkFile(const char* inFileName,
                           XSUM_U32 ignoreMissing,
                           XSUM_U32 warn,
                           XSUM_U32 quiet,
-                          XSUM_U32 algoBitmask)
+                          XSUM_U32 algoBitmask,
+                          int nbThreads,
+                          const char* const* onlyList,
+                          int nbOnly,
+                          size_t diskOrder,
+                          int completionOrder)
 {
     int result = 0;
     FILE* inFile = NULL;
+    XSUM_index* index = NULL;
     ParseFileArg XSUM_parseFileArgBody;
     ParseFileArg* const XSUM_parseFileArg = &XSUM_parseFileArgBody;
     ParseFileReport* const report = &XSUM_parseFileArg->report;
@@ -998,42 +3340,93 @@ static int XSUM_checkFile(const char* inFileName,
         inFileName = stdinFileName; /* "stdin" */
         inFile = stdin;
     } else {
-        inFile = XSUM_fopen( inFileName, "rt" );
+        int const isIndex = XSUM_index_open(inFileName, &index);
+        if (isIndex < 0) return 0;
+        if (!isIndex) inFile = XSUM_fopen( inFileName, "rt" );
     }
 
-    if (inFile == NULL) {
+    if (inFile == NULL && index == NULL) {
         XSUM_log("Error: Could not open '%s': %s\n", inFileName, strerror(errno));
         return 0;
     }
+    if (nbOnly > 0 && index == NULL) {
+        XSUM_log("%s: Error: --only requires a binary index (see --convert)\n", inFileName);
+        if (inFile != stdin) fclose(inFile);
+        return 0;
+    }
 
     XSUM_parseFileArg->inFileName  = inFileName;
     XSUM_parseFileArg->inFile      = inFile;
     XSUM_parseFileArg->lineMax     = DEFAULT_LINE_LENGTH;
     XSUM_parseFileArg->lineBuf     = (char*) malloc((size_t)XSUM_parseFileArg->lineMax);
-    XSUM_parseFileArg->blockSize   = 64 * 1024;
-    XSUM_parseFileArg->blockBuf    = (char*) malloc(XSUM_parseFileArg->blockSize);
+    XSUM_parseFileArg->pool        = XSUM_pool_create(nbThreads);
+    XSUM_parseFileArg->nbJobs      = diskOrder > 0 ? diskOrder : 4 * (size_t)(nbThreads > 1 ? nbThreads : 1);
+    XSUM_parseFileArg->jobs        = (CheckFileJob*) calloc(XSUM_parseFileArg->nbJobs, sizeof(CheckFileJob));
     XSUM_parseFileArg->strictMode  = strictMode;
     XSUM_parseFileArg->statusOnly  = statusOnly;
     XSUM_parseFileArg->ignoreMissing = ignoreMissing;
     XSUM_parseFileArg->warn        = warn;
     XSUM_parseFileArg->quiet       = quiet;
     XSUM_parseFileArg->algoBitmask = algoBitmask;
+    XSUM_parseFileArg->index       = index;
+    XSUM_parseFileArg->onlyList    = onlyList;
+    XSUM_parseFileArg->nbOnly      = nbOnly;
+    XSUM_parseFileArg->diskOrder   = diskOrder > 0;
+    XSUM_parseFileArg->completionOrder = completionOrder;
+    XSUM_parseFileArg->positions   = NULL;
+    XSUM_parseFileArg->pendingJobs = NULL;
+    XSUM_parseFileArg->pendingFlags = NULL;
+    XSUM_parseFileArg->nbPending   = 0;
+    if (diskOrder > 0) {
+        XSUM_parseFileArg->positions    = (DiskPosition*) malloc(diskOrder * sizeof(DiskPosition));
+        XSUM_parseFileArg->pendingJobs  = (CheckFileJob**) malloc(diskOrder * sizeof(CheckFileJob*));
+        XSUM_parseFileArg->pendingFlags = (const int**) malloc(diskOrder * sizeof(const int*));
+    }
 
     if ( (XSUM_parseFileArg->lineBuf == NULL)
-      || (XSUM_parseFileArg->blockBuf == NULL) ) {
+      || (XSUM_parseFileArg->pool == NULL)
+      || (XSUM_parseFileArg->jobs == NULL)
+      || (diskOrder > 0 && ( XSUM_parseFileArg->positions == NULL
+                          || XSUM_parseFileArg->pendingJobs == NULL
+                          || XSUM_parseFileArg->pendingFlags == NULL )) ) {
         XSUM_log("Error: : memory allocation failed \n");
         exit(1);
     }
-    XSUM_parseFile1(XSUM_parseFileArg, displayEndianess != big_endian);
+    {   size_t n;
+        for (n = 0; n < XSUM_parseFileArg->nbJobs; n++) {
+            CheckFileJob* const job = &XSUM_parseFileArg->jobs[n];
+            job->blockSize = 64 * 1024;
+            /* --disk-order: a batch can be large, buffers are allocated per file */
+            if (diskOrder > 0) continue;
+            job->blockBuf  = (char*) malloc(job->blockSize);
+            if (job->blockBuf == NULL) {
+                XSUM_log("Error: : memory allocation failed \n");
+                exit(1);
+    }   }   }
+    if (index != NULL) {
+        XSUM_parseIndex(XSUM_parseFileArg);
+    } else {
+        XSUM_parseFile1(XSUM_parseFileArg, displayEndianess != big_endian);
+    }
 
-    free(XSUM_parseFileArg->blockBuf);
+    XSUM_pool_free(XSUM_parseFileArg->pool);
+    {   size_t n;
+        for (n = 0; n < XSUM_parseFileArg->nbJobs; n++) {
+            free(XSUM_parseFileArg->jobs[n].blockBuf);
+            free(XSUM_parseFileArg->jobs[n].fileName);
+    }   }
+    free(XSUM_parseFileArg->jobs);
+    free(XSUM_parseFileArg->positions);
+    free(XSUM_parseFileArg->pendingJobs);
+    free((void*)XSUM_parseFileArg->pendingFlags);
     free(XSUM_parseFileArg->lineBuf);
 
-    if (inFile != stdin) fclose(inFile);
+    if (inFile != NULL && inFile != stdin) fclose(inFile);
+    XSUM_index_close(index);
 
     /* Show error/warning messages.  All messages are copied from md5sum.c
      */
-    if (report->nProperlyFormattedLines == 0) {
+    if (report->nProperlyFormattedLines == 0 && report->nNotListed == 0) {
         XSUM_log("%s: no properly formatted xxHash checksum lines found\n", inFileName);
     } else if (!statusOnly) {
         if (report->nImproperlyFormattedLines) {
@@ -1050,6 +3443,11 @@ static int XSUM_checkFile(const char* inFileName,
             XSUM_output("%lu computed %s did NOT match\n"
                 , report->nMismatchedChecksums
                 , report->nMismatchedChecksums == 1 ? "checksum" : "checksums");
+        }
+        if (report->nNotListed) {
+            XSUM_output("%lu requested %s not listed\n"
+                , report->nNotListed
+                , report->nNotListed == 1 ? "file is" : "files are");
     }   }
 
     /* Result (exit) code logic is copied from
@@ -1057,12 +3455,13 @@ static int XSUM_checkFile(const char* inFileName,
     result =   report->nProperlyFormattedLines != 0
             && report->nMismatchedChecksums == 0
             && report->nOpenOrReadFailures == 0
+            && report->nNotListed == 0
             && (!strictMode || report->nImproperlyFormattedLines == 0)
             && report->quit == 0;
 
     /* If "--ignore-missing" is enabled and there's no matched checksum, report it as error.
      * See https://github.com/coreutils/coreutils/blob/2f1cffe07ab0f0b4135a52d95f1689d7fc7f26c9/src/digest.c#L1325-L1328 */
-    if (ignoreMissing && report->nMatchedChecksums == 0) {
+    if (ignoreMissing && report->nMatchedChecksums == 0 && !report->stoppedEarly) {
         XSUM_output("%s: no file was verified\n", inFileName);
         result = 0;
     }
@@ -1078,23 +3477,433 @@ static int XSUM_checkFiles(const char* fnList[], int fnTotal,
                            XSUM_U32 ignoreMissing,
                            XSUM_U32 warn,
                            XSUM_U32 quiet,
-                           XSUM_U32 algoBitmask)
+                           XSUM_U32 algoBitmask,
+                           int nbThreads,
+                           const char* const* onlyList,
+                           int nbOnly,
+                           size_t diskOrder,
+                           int completionOrder)
 {
     int ok = 1;
 
     /* Special case for stdinName "-",
      * note: stdinName is not a string.  It's special pointer. */
     if (fnTotal==0) {
-        ok &= XSUM_checkFile(stdinName, displayEndianess, strictMode, statusOnly, ignoreMissing, warn, quiet, algoBitmask);
+        ok &= XSUM_checkFile(stdinName, displayEndianess, strictMode, statusOnly, ignoreMissing, warn, quiet, algoBitmask, nbThreads, onlyList, nbOnly, diskOrder, completionOrder);
     } else {
         int fnNb;
-        for (fnNb=0; fnNb<fnTotal; fnNb++)
-            ok &= XSUM_checkFile(fnList[fnNb], displayEndianess, strictMode, statusOnly, ignoreMissing, warn, quiet, algoBitmask);
-    }
+        for (fnNb=0; fnNb<fnTotal; fnNb++) {
+            ok &= XSUM_checkFile(fnList[fnNb], displayEndianess, strictMode, statusOnly, ignoreMissing, warn, quiet, algoBitmask, nbThreads, onlyList, nbOnly, diskOrder, completionOrder);
+            /* --status: the exit code is already decided */
+            if (statusOnly && !ok) break;
+    }   }
     return ok ? 0 : 1;
 }
 
 
+/*
+ * --convert: stores the lines of text checksum files into binary index
+ * `indexFileName`, without verifying them.
+ * The index holds a single algorithm: the one of the first line.
+ * Returns 0 on success, 1 if any line could not be converted.
+ */
+static int XSUM_convertFiles(const char* fnList[], int fnTotal, const char* indexFileName,
+                             const Display_endianess displayEndianess,
+                             XSUM_U32 algoBitmask)
+{
+    int const nbInputs = fnTotal > 0 ? fnTotal : 1;
+    XSUM_indexWriter* writer = NULL;
+    AlgoSelected algo = algo_xxh32;
+    char* lineBuf = NULL;
+    int lineMax = 0;
+    int result = 0;
+    int fnNb;
+
+    for (fnNb = 0; fnNb < nbInputs && result == 0; fnNb++) {
+        const char* const inFileName = fnTotal > 0 ? fnList[fnNb] : stdinFileName;
+        FILE* const inFile = fnTotal > 0 ? XSUM_fopen(inFileName, "rt") : stdin;
+        unsigned long lineNumber = 0;
+
+        if (inFile == NULL) {
+            XSUM_log("Error: Could not open '%s': %s\n", inFileName, strerror(errno));
+            result = 1;
+            break;
+        }
+        while (result == 0) {
+            ParsedLine parsedLine;
+            GetLineResult const getLineResult = XSUM_getLine(&lineBuf, &lineMax, inFile);
+            lineNumber++;
+            if (getLineResult == GetLine_comment) continue;
+            if (getLineResult == GetLine_eof) break;
+            if (getLineResult != GetLine_ok) {
+                XSUM_log("%s:%lu: Error: %s.\n", inFileName, lineNumber,
+                         getLineResult == GetLine_outOfMemory ? "Out of memory" : "Line too long");
+                result = 1;
+                break;
+            }
+            if (XSUM_parseLine(&parsedLine, lineBuf, displayEndianess != big_endian, algoBitmask) != ParseLine_ok) {
+                XSUM_log("%s:%lu: Error: Improperly formatted checksum line.\n", inFileName, lineNumber);
+                result = 1;
+                break;
+            }
+            if (writer == NULL) {
+                algo = parsedLine.algo;
+                writer = XSUM_indexWriter_create(XSUM_algoName[algo], XSUM_algoLength[algo]);
+                if (writer == NULL) { result = 1; break; }
+            }
+            if (parsedLine.algo != algo) {
+                XSUM_log("%s:%lu: Error: %s checksum line, but the index stores %s digests.\n",
+                         inFileName, lineNumber, XSUM_algoName[parsedLine.algo], XSUM_algoName[algo]);
+                result = 1;
+                break;
+            }
+            if (XSUM_indexWriter_add(writer, parsedLine.filename, &parsedLine.canonical)) {
+                XSUM_log("%s:%lu: Error: Out of memory.\n", inFileName, lineNumber);
+                result = 1;
+        }   }
+        if (inFile != stdin) fclose(inFile);
+    }
+
+    if (result == 0 && writer == NULL) {
+        XSUM_log("%s: no properly formatted xxHash checksum lines found\n",
+                 fnTotal > 0 ? fnList[fnTotal-1] : stdinFileName);
+        result = 1;
+    }
+    if (result == 0) result = XSUM_indexWriter_write(writer, indexFileName);
+    XSUM_indexWriter_free(writer);
+    free(lineBuf);
+    return result;
+}
+
+
+/* ********************************************************
+*  Block signatures (--chunk-size)
+**********************************************************/
+
+/*
+ * A signature lists the digest of each fixed-size block of a file,
+ * so that two versions of a large file can be compared block by block:
+ *
+ *      #xxhsum-signature <algorithm> <block size> <filename>
+ *      <block index> <hexadecimal digest>
+ *      ...
+ *      #end <file size>
+ *
+ * The file is read sequentially by the main thread,
+ * while blocks are hashed by the pool, up to `nbSlots` at a time.
+ */
+#define XSUM_SIGNATURE_TAG "#xxhsum-signature "
+#define XSUM_SIGNATURE_END "#end "
+#define XSUM_U64_STRING_SIZE 21   /* 20 decimal digits + '\0' */
+
+typedef struct {
+    void*        buffer;      /* blockSize bytes */
+    size_t       size;        /* bytes in this block */
+    AlgoSelected algo;
+    Multihash    hash;
+    int          completed;   /* see XSUM_pool_waitCompleted() */
+} SignatureBlockJob;
+
+/* Formats `value` in decimal, without depending on printf() support of 64-bit types */
+static const char* XSUM_u64ToString(char* buffer, XSUM_U64 value)
+{
+    char* p = buffer + XSUM_U64_STRING_SIZE - 1;
+    *p = '\0';
+    do {
+        *--p = (char)('0' + (int)(value % 10));
+        value /= 10;
+    } while (value != 0);
+    return p;
+}
+
+/* Reads a decimal number, returns 1 if there is none or if it overflows */
+static int XSUM_readU64FromChar(const char** stringPtr, XSUM_U64* value)
+{
+    XSUM_U64 result = 0;
+    if ((**stringPtr < '0') || (**stringPtr > '9')) return 1;
+    while ((**stringPtr >= '0') && (**stringPtr <= '9')) {
+        XSUM_U32 const digit = (XSUM_U32)(**stringPtr - '0');
+        if (result > ((XSUM_U64)-1 - digit) / 10) return 1;
+        result = result * 10 + digit;
+        (*stringPtr)++;
+    }
+    *value = result;
+    return 0;
+}
+
+static void XSUM_signatureBlockJob(void* opaque)
+{
+    SignatureBlockJob* const job = (SignatureBlockJob*)opaque;
+    job->hash = XSUM_hashBuffer(job->buffer, job->size, job->algo);
+}
+
+static void XSUM_displaySignatureBlock(XSUM_pool* pool, SignatureBlockJob* job, XSUM_U64 blockNb)
+{
+    char numBuf[XSUM_U64_STRING_SIZE];
+    unsigned char canonical[sizeof(Canonical)];
+    XSUM_pool_waitCompleted(pool, &job->completed);
+    XSUM_canonicalFromMultihash(canonical, job->algo, job->hash);
+    XSUM_output("%s ", XSUM_u64ToString(numBuf, blockNb));
+    XSUM_display_BigEndian(canonical, XSUM_algoLength[job->algo]);
+    XSUM_output("\n");
+}
+
+static int XSUM_signatureFile(const char* fileName, AlgoSelected algo, size_t blockSize,
+                              XSUM_pool* pool, SignatureBlockJob* slots, size_t nbSlots)
+{
+    const char* const displayName = (fileName == stdinName) ? stdinFileName : fileName;
+    char numBuf[XSUM_U64_STRING_SIZE];
+    XSUM_U64 fileSize = 0;
+    XSUM_U64 nbSubmitted = 0, nbDisplayed = 0;
+    FILE* inFile;
+
+    if (fileName == stdinName) {
+        inFile = stdin;
+        XSUM_setBinaryMode(stdin);
+    } else {
+        if (XSUM_isDirectory(fileName)) {
+            XSUM_log("xxhsum: %s: Is a directory \n", fileName);
+            return 1;
+        }
+        inFile = XSUM_fopen(fileName, "rb");
+        if (inFile == NULL) {
+            XSUM_log("Error: Could not open '%s': %s. \n", fileName, strerror(errno));
+            return 1;
+    }   }
+
+    XSUM_output("%s%s %s ", XSUM_SIGNATURE_TAG, XSUM_algoName[algo], XSUM_u64ToString(numBuf, blockSize));
+    XSUM_printFilename(displayName, XSUM_filenameNeedsEscape(displayName));
+    XSUM_output("\n");
+
+    for (;;) {
+        SignatureBlockJob* const job = &slots[nbSubmitted % nbSlots];
+        size_t readSize;
+        if (nbSubmitted - nbDisplayed == nbSlots) {
+            XSUM_displaySignatureBlock(pool, job, nbDisplayed);
+            nbDisplayed++;
+        }
+        readSize = fread(job->buffer, 1, blockSize, inFile);
+        if (readSize == 0) break;
+        fileSize += readSize;
+        job->size = readSize;
+        job->algo = algo;
+        XSUM_pool_add(pool, XSUM_signatureBlockJob, job, &job->completed);
+        nbSubmitted++;
+        if (readSize < blockSize) break;
+    }
+    while (nbDisplayed < nbSubmitted) {
+        XSUM_displaySignatureBlock(pool, &slots[nbDisplayed % nbSlots], nbDisplayed);
+        nbDisplayed++;
+    }
+    if (ferror(inFile)) {
+        XSUM_log("Error: a failure occurred reading the input file.\n");
+        exit(1);
+    }
+    XSUM_output("%s%s\n", XSUM_SIGNATURE_END, XSUM_u64ToString(numBuf, fileSize));
+
+    if (inFile != stdin) fclose(inFile);
+    return 0;
+}
+
+/*
+ * XSUM_signatureFiles:
+ * Outputs the signature of each file, one digest per block of `blockSize` bytes.
+ * If fnTotal==0, read from stdin instead.
+ */
+static int XSUM_signatureFiles(const char* fnList[], int fnTotal,
+                               AlgoSelected algo, size_t blockSize, int nbThreads)
+{
+    size_t const nbSlots = 2 * (size_t)(nbThreads > 1 ? nbThreads : 1);
+    XSUM_pool* const pool = XSUM_pool_create(nbThreads);
+    SignatureBlockJob* const slots = (SignatureBlockJob*)calloc(nbSlots, sizeof(SignatureBlockJob));
+    int result = 0;
+    size_t n;
+
+    if (pool == NULL || slots == NULL) {
+        XSUM_log("\nError: Out of memory.\n");
+        exit(1);
+    }
+    for (n = 0; n < nbSlots; n++) {
+        slots[n].buffer = malloc(blockSize);
+        if (slots[n].buffer == NULL) {
+            XSUM_log("\nError: Out of memory.\n");
+            exit(1);
+    }   }
+
+    if (fnTotal == 0) {
+        result |= XSUM_signatureFile(stdinName, algo, blockSize, pool, slots, nbSlots);
+    } else {
+        int fnNb;
+        for (fnNb = 0; fnNb < fnTotal; fnNb++)
+            result |= XSUM_signatureFile(fnList[fnNb], algo, blockSize, pool, slots, nbSlots);
+    }
+
+    XSUM_pool_free(pool);
+    for (n = 0; n < nbSlots; n++) free(slots[n].buffer);
+    free(slots);
+    return result;
+}
+
+typedef struct {
+    AlgoSelected   algo;
+    XSUM_U64       blockSize;
+    XSUM_U64       fileSize;
+    XSUM_U64       nbBlocks;
+    unsigned char* digests;     /* nbBlocks * XSUM_algoLength[algo] bytes */
+} Signature;
+
+/*
+ * Loads the signature stored in file `fileName`, which must contain exactly one.
+ * Returns 0 on success, 1 after displaying an error message.
+ */
+static int XSUM_loadSignature(const char* fileName, Signature* sig)
+{
+    FILE* const inFile = XSUM_fopen(fileName, "rt");
+    char* lineBuf = NULL;
+    int lineMax = 0;
+    unsigned long lineNumber = 0;
+    size_t capacity = 0;
+    int state = 0;   /* 0: expecting header, 1: blocks, 2: after #end */
+    const char* error = NULL;
+
+    memset(sig, 0, sizeof(*sig));
+    if (inFile == NULL) {
+        XSUM_log("Error: Could not open '%s': %s\n", fileName, strerror(errno));
+        return 1;
+    }
+
+    while (error == NULL) {
+        GetLineResult const getLineResult = XSUM_getLine(&lineBuf, &lineMax, inFile);
+        const char* p = lineBuf;
+        lineNumber++;
+        if (getLineResult == GetLine_eof) {
+            if (state != 2) error = "Truncated signature";
+            break;
+        }
+        if (getLineResult != GetLine_ok && getLineResult != GetLine_comment) {
+            error = "Could not read line";
+            break;
+        }
+        if (state == 2) {
+            error = "Only one signature per file is supported";
+        } else if (state == 0) {
+            /* #xxhsum-signature <algorithm> <block size> <filename> */
+            size_t const tagLength = sizeof(XSUM_SIGNATURE_TAG) - 1;
+            int algoNb = -1, n;
+            if (strncmp(p, XSUM_SIGNATURE_TAG, tagLength)) { error = "Not a signature"; break; }
+            p += tagLength;
+            for (n = 0; n < (int)XSUM_TABLE_ELT_SIZE(XSUM_algoName); n++) {
+                size_t const nameLength = strlen(XSUM_algoName[n]);
+                if (!strncmp(p, XSUM_algoName[n], nameLength) && p[nameLength] == ' ') {
+                    algoNb = n;
+                    p += nameLength + 1;
+                    break;
+            }   }
+            if (algoNb < 0) { error = "Unknown algorithm"; break; }
+            sig->algo = (AlgoSelected)algoNb;
+            if (XSUM_readU64FromChar(&p, &sig->blockSize) || sig->blockSize == 0) { error = "Invalid block size"; break; }
+            state = 1;
+        } else if (getLineResult == GetLine_comment) {
+            /* #end <file size> */
+            size_t const endLength = sizeof(XSUM_SIGNATURE_END) - 1;
+            if (strncmp(p, XSUM_SIGNATURE_END, endLength)) { error = "Invalid end of signature"; break; }
+            p += endLength;
+            if (XSUM_readU64FromChar(&p, &sig->fileSize) || *p != '\0') { error = "Invalid file size"; break; }
+            if ( sig->fileSize > sig->nbBlocks * sig->blockSize
+              || (sig->nbBlocks > 0 && sig->fileSize <= (sig->nbBlocks - 1) * sig->blockSize) ) {
+                error = "File size doesn't match the number of blocks";
+                break;
+            }
+            state = 2;
+        } else {
+            /* <block index> <hexadecimal digest> */
+            size_t const digestSize = XSUM_algoLength[sig->algo];
+            XSUM_U64 blockNb;
+            if (XSUM_readU64FromChar(&p, &blockNb) || blockNb != sig->nbBlocks || *p++ != ' ') {
+                error = "Invalid block line";
+                break;
+            }
+            if (strlen(p) != digestSize * 2) { error = "Invalid digest"; break; }
+            if (sig->nbBlocks == capacity) {
+                size_t const newCapacity = capacity ? capacity * 2 : 1024;
+                unsigned char* const newDigests = (unsigned char*)realloc(sig->digests, newCapacity * digestSize);
+                if (newDigests == NULL) { error = "Out of memory"; break; }
+                sig->digests = newDigests;
+                capacity = newCapacity;
+            }
+            if (XSUM_canonicalFromString(sig->digests + (size_t)sig->nbBlocks * digestSize, digestSize, p, 0)
+                    != CanonicalFromString_ok) {
+                error = "Invalid digest";
+                break;
+            }
+            sig->nbBlocks++;
+        }
+    }
+
+    free(lineBuf);
+    fclose(inFile);
+    if (error != NULL) {
+        XSUM_log("%s:%lu: Error: %s.\n", fileName, lineNumber, error);
+        free(sig->digests);
+        sig->digests = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+static void XSUM_displayRange(XSUM_U64 offset, XSUM_U64 end)
+{
+    char offsetBuf[XSUM_U64_STRING_SIZE];
+    char lengthBuf[XSUM_U64_STRING_SIZE];
+    XSUM_output("%s %s\n", XSUM_u64ToString(offsetBuf, offset), XSUM_u64ToString(lengthBuf, end - offset));
+}
+
+/*
+ * XSUM_compareSignatures:
+ * Displays the byte ranges which differ between the files described by
+ * signatures `oldName` and `newName`, as "<offset> <length>" lines.
+ * Nothing is displayed when both files are identical.
+ */
+static int XSUM_compareSignatures(const char* oldName, const char* newName)
+{
+    Signature oldSig, newSig;
+    int result = 1;
+
+    if (XSUM_loadSignature(oldName, &oldSig)) return 1;
+    if (XSUM_loadSignature(newName, &newSig)) {
+        free(oldSig.digests);
+        return 1;
+    }
+
+    if (oldSig.algo != newSig.algo || oldSig.blockSize != newSig.blockSize) {
+        XSUM_log("Error: '%s' and '%s' use different algorithms or block sizes.\n", oldName, newName);
+    } else {
+        size_t const digestSize = XSUM_algoLength[oldSig.algo];
+        XSUM_U64 const nbBlocks = oldSig.nbBlocks > newSig.nbBlocks ? oldSig.nbBlocks : newSig.nbBlocks;
+        XSUM_U64 const maxSize = oldSig.fileSize > newSig.fileSize ? oldSig.fileSize : newSig.fileSize;
+        XSUM_U64 rangeStart = 0;
+        int inRange = 0;
+        XSUM_U64 b;
+        for (b = 0; b < nbBlocks; b++) {
+            int const changed = (b >= oldSig.nbBlocks) || (b >= newSig.nbBlocks)
+                || memcmp(oldSig.digests + (size_t)b * digestSize, newSig.digests + (size_t)b * digestSize, digestSize);
+            if (changed && !inRange) {
+                rangeStart = b;
+                inRange = 1;
+            } else if (!changed && inRange) {
+                XSUM_displayRange(rangeStart * oldSig.blockSize, b * oldSig.blockSize);
+                inRange = 0;
+        }   }
+        if (inRange) XSUM_displayRange(rangeStart * oldSig.blockSize, maxSize);
+        result = 0;
+    }
+
+    free(oldSig.digests);
+    free(newSig.digests);
+    return result;
+}
+
+
 /* ********************************************************
 *  Main
 **********************************************************/
@@ -1106,7 +3915,7 @@ static int XSUM_usage(const char* exename)
     XSUM_log( "Usage: %s [options] [files] \n\n", exename);
     XSUM_log( "When no filename provided or when '-' is provided, uses stdin as input. \n");
     XSUM_log( "\nOptions: \n");
-    XSUM_log( "  -H#          select an xxhash algorithm (default: %i) \n", (int)g_defaultAlgo);
+    XSUM_log( "  -H#          select an xxhash algorithm (default: %i), or several: -H1,2 \n", (int)g_defaultAlgo);
     XSUM_log( "               0: XXH32 \n");
     XSUM_log( "               1: XXH64 \n");
     XSUM_log( "               2: XXH128 (also called XXH3_128bits) \n");
@@ -1128,14 +3937,41 @@ static int XSUM_usage_advanced(const char* exename)
     XSUM_log( "  -b                   Run benchmark \n");
     XSUM_log( "  -b#                  Bench only algorithm variant # \n");
     XSUM_log( "  -i#                  Number of times to run the benchmark (default: %i) \n", NBLOOPS_DEFAULT);
+    XSUM_log( "      --bench-io       Benchmark reading and hashing [files] with several I/O strategies \n");
+    XSUM_log( "  -b --threads=#,#,... Benchmark memory bandwidth scaling with each number of threads \n");
+    XSUM_log( "      --pin            Pin benchmark threads to cores \n");
+    XSUM_log( "      --format=csv|json  Also write benchmark results to stdout, with a description of the host \n");
+    XSUM_log( "      --baseline=FILE  Compare benchmark results with FILE, from --format=csv; fail if slower \n");
     XSUM_log( "  -q, --quiet          Don't display version header in benchmark mode \n");
+    XSUM_log( "  -r, --recursive      Hash files within directories, recursively \n");
+    XSUM_log( "      --sort           Display files found by -r in sorted path order \n");
+    XSUM_log( "  -T#, --threads=#     Hash or check files using # threads (default: 1, 0: one per core) \n");
+    XSUM_log( "      --cache=xattr    Reuse digests of unchanged files, kept in extended attributes \n");
+    XSUM_log( "      --cache=file:F   Reuse digests of unchanged files, kept in index file F \n");
+    XSUM_log( "      --state-dir=DIR  Save hashing states into DIR, to only read appended data next time \n");
+    XSUM_log( "      --stats[=json]   Display throughput, read and hash times, and file sizes on stderr \n");
+    XSUM_log( "      --chunk-size=#   Output a signature: one digest per block of # bytes (K, M suffixes allowed) \n");
+    XSUM_log( "      --compare-signature OLD NEW  Display byte ranges which differ between two signatures \n");
+    XSUM_log( "      --dupes          Display groups of files with identical content \n");
+    XSUM_log( "      --tee[=FILE]     Copy stdin to stdout, then write its checksum to stderr or FILE \n");
+    XSUM_log( "      --tar            Hash each file member of tar archives, without extracting them \n");
+    XSUM_log( "      --tree-hash      Display a digest of each directory tree, its content and metadata \n");
+    XSUM_log( "      --tree-index=F   With --tree-hash, write the digest of every directory into F \n");
+    XSUM_log( "      --index=FILE     Write checksums into binary index FILE, instead of text lines \n");
+    XSUM_log( "      --convert=FILE   Convert text checksum files into binary index FILE \n");
+    XSUM_log( "      --watch DIR      Keep the checksums of all files below DIR up to date in a manifest \n");
+    XSUM_log( "      --manifest=FILE  With --watch, the manifest to write \n");
+    XSUM_log( "      --debounce=#     With --watch, update the manifest # ms after the last change (default: %i) \n", XSUM_WATCH_DEBOUNCE_DEFAULT);
     XSUM_log( "\n");
-    XSUM_log( "The following five options are useful only when verifying checksums (-c): \n");
+    XSUM_log( "The following options are useful only when verifying checksums (-c): \n");
     XSUM_log( "  -q, --quiet          Don't print OK for each successfully verified file \n");
     XSUM_log( "      --status         Don't output anything, status code shows success \n");
     XSUM_log( "      --strict         Exit non-zero for improperly formatted checksum lines \n");
     XSUM_log( "      --warn           Warn about improperly formatted checksum lines \n");
     XSUM_log( "      --ignore-missing Don't fail or report status for missing files \n");
+    XSUM_log( "      --only=PATH      Only verify PATH, looked up in a binary index (repeatable) \n");
+    XSUM_log( "      --disk-order[=#] Read files by position on disk, sorting # files at a time (default: %i) \n", XSUM_DISK_ORDER_DEFAULT);
+    XSUM_log( "      --completion-order  With --disk-order, report files as soon as they are verified \n");
     return 0;
 }
 
@@ -1160,6 +3996,20 @@ static const char* XSUM_lastNameFromPath(const char* path)
     return name;
 }
 
+/*!
+ * XSUM_longCommandWArg():
+ * Checks if *stringPtr begins with `longCommand`.
+ * If yes, @return 1 and advances *stringPtr to the position which immediately follows longCommand.
+ * @return 0 and doesn't modify *stringPtr otherwise.
+ */
+static int XSUM_longCommandWArg(const char** stringPtr, const char* longCommand)
+{
+    size_t const comSize = strlen(longCommand);
+    int const result = !strncmp(*stringPtr, longCommand, comSize);
+    if (result) *stringPtr += comSize;
+    return result;
+}
+
 /*!
  * XSUM_readU32FromCharChecked():
  * @return 0 if success, and store the result in *value.
@@ -1214,17 +4064,48 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
     int i, filenamesStart = 0;
     const char* const exename = XSUM_lastNameFromPath(argv[0]);
     XSUM_U32 benchmarkMode = 0;
+    int benchIO = 0;
     XSUM_U32 fileCheckMode = 0;
     XSUM_U32 strictMode    = 0;
     XSUM_U32 statusOnly    = 0;
     XSUM_U32 warn          = 0;
     XSUM_U32 ignoreMissing = 0;
     XSUM_U32 algoBitmask   = algo_bitmask_all;
+    XSUM_U32 recursive     = 0;
+    XSUM_U32 sortFiles     = 0;
+    int nbThreads = 1;
+    const char* cacheSpec = NULL;
+    const char* stateDir = NULL;
+    size_t chunkSize = 0;
+    int compareSignature = 0;
+    int findDupes = 0;
+    int teeMode = 0;
+    int tarMode = 0;
+    int treeHash = 0;
+    const char* treeIndexFile = NULL;
+    const char* teeDigestFile = NULL;
+    const char* indexFile = NULL;
+    const char* convertFile = NULL;
+    const char** onlyList = NULL;
+    int nbOnly = 0;
+    size_t diskOrder = 0;
+    int completionOrder = 0;
+    int watchMode = 0;
+    int statsMode = 0;   /* 1: text, 2: JSON */
+    const char* manifestFile = NULL;
+    int debounceMs = -1;
     int explicitStdin = 0;
     XSUM_U32 selectBenchIDs= 0;  /* 0 == use default k_testIDs_default, kBenchAll == bench all */
     static const XSUM_U32 kBenchAll = 99;
     size_t keySize    = XSUM_DEFAULT_SAMPLE_SIZE;
+    size_t benchBlockSize = 0;   /* -B for --bench-io and thread scaling: 0 == default */
+    int threadCounts[XSUM_BENCH_THREADS_MAX];   /* -b with -T# or --threads=#,#,...: thread scaling */
+    int nbThreadCounts = 0;
+    int pinThreads = 0;
+    int benchFormat = XSUM_benchFormat_text;
+    const char* benchBaseline = NULL;
     AlgoSelected algo     = g_defaultAlgo;
+    AlgoList algoList     = { { algo_xxh32 }, 0 };   /* set by -H, `algo` when empty */
     Display_endianess displayEndianess = big_endian;
     Display_convention convention = display_gnu;
     int nbIterations = NBLOOPS_DEFAULT;
@@ -1242,6 +4123,7 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
         if (!strcmp(argument, "--check")) { fileCheckMode = 1; continue; }
         if (!strcmp(argument, "--benchmark-all")) { benchmarkMode = 1; selectBenchIDs = kBenchAll; continue; }
         if (!strcmp(argument, "--bench-all")) { benchmarkMode = 1; selectBenchIDs = kBenchAll; continue; }
+        if (!strcmp(argument, "--bench-io")) { benchmarkMode = 1; benchIO = 1; continue; }
         if (!strcmp(argument, "--quiet")) { XSUM_logLevel--; continue; }
         if (!strcmp(argument, "--little-endian")) { displayEndianess = little_endian; continue; }
         if (!strcmp(argument, "--strict")) { strictMode = 1; continue; }
@@ -1252,6 +4134,90 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
         if (!strcmp(argument, "--help")) { return XSUM_usage_advanced(exename); }
         if (!strcmp(argument, "--version")) { XSUM_log(FULL_WELCOME_MESSAGE(exename)); XSUM_sanityCheck(); return 0; }
         if (!strcmp(argument, "--tag")) { convention = display_bsd; continue; }
+        if (!strcmp(argument, "--recursive")) { recursive = 1; continue; }
+        if (!strcmp(argument, "--sort")) { sortFiles = 1; continue; }
+        if (XSUM_longCommandWArg(&argument, "--threads=")) {
+            nbThreadCounts = 0;
+            do {
+                if (*argument == ',') argument++;
+                if (nbThreadCounts == XSUM_BENCH_THREADS_MAX) return XSUM_badusage(exename);
+                threadCounts[nbThreadCounts++] = (int)XSUM_readU32FromChar(&argument);
+            } while (*argument == ',');
+            if (*argument != 0) return XSUM_badusage(exename);
+            nbThreads = threadCounts[0];
+            continue;
+        }
+        if (!strcmp(argument, "--pin")) { pinThreads = 1; continue; }
+        if (!strcmp(argument, "--format=csv")) { benchFormat = XSUM_benchFormat_csv; continue; }
+        if (!strcmp(argument, "--format=json")) { benchFormat = XSUM_benchFormat_json; continue; }
+        if (XSUM_longCommandWArg(&argument, "--baseline=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            benchBaseline = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--cache=")) { cacheSpec = argument; continue; }
+        if (XSUM_longCommandWArg(&argument, "--state-dir=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            stateDir = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--chunk-size=")) {
+            chunkSize = XSUM_readU32FromChar(&argument);
+            if (*argument != 0 || chunkSize == 0) return XSUM_badusage(exename);
+            continue;
+        }
+        if (!strcmp(argument, "--compare-signature")) { compareSignature = 1; continue; }
+        if (!strcmp(argument, "--dupes")) { findDupes = 1; continue; }
+        if (!strcmp(argument, "--tee")) { teeMode = 1; continue; }
+        if (!strcmp(argument, "--tar")) { tarMode = 1; continue; }
+        if (!strcmp(argument, "--tree-hash")) { treeHash = 1; continue; }
+        if (XSUM_longCommandWArg(&argument, "--tree-index=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            treeIndexFile = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--index=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            indexFile = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--convert=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            convertFile = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--only=")) {
+            /* at most one per argument */
+            if (onlyList == NULL) onlyList = (const char**)malloc((size_t)argc * sizeof(*onlyList));
+            if (onlyList == NULL) errorOut("Error: Out of memory.");
+            onlyList[nbOnly++] = argument;
+            continue;
+        }
+        if (!strcmp(argument, "--disk-order")) { diskOrder = XSUM_DISK_ORDER_DEFAULT; continue; }
+        if (XSUM_longCommandWArg(&argument, "--disk-order=")) {
+            diskOrder = XSUM_readU32FromChar(&argument);
+            if (*argument != 0 || diskOrder == 0) return XSUM_badusage(exename);
+            continue;
+        }
+        if (!strcmp(argument, "--completion-order")) { completionOrder = 1; continue; }
+        if (!strcmp(argument, "--watch")) { watchMode = 1; continue; }
+        if (!strcmp(argument, "--stats")) { statsMode = 1; continue; }
+        if (!strcmp(argument, "--stats=json")) { statsMode = 2; continue; }
+        if (XSUM_longCommandWArg(&argument, "--manifest=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            manifestFile = argument;
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--debounce=")) {
+            debounceMs = (int)XSUM_readU32FromChar(&argument);
+            if (*argument != 0) return XSUM_badusage(exename);
+            continue;
+        }
+        if (XSUM_longCommandWArg(&argument, "--tee=")) {
+            if (*argument == 0) return XSUM_badusage(exename);
+            teeMode = 1; teeDigestFile = argument;
+            continue;
+        }
 
         if (!strcmp(argument, "--")) {
             if (filenamesStart==0 && i!=argc-1) filenamesStart=i+1; /* only supports a continuous list of filenames */
@@ -1281,17 +4247,25 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
 
             /* select hash algorithm */
             case 'H': argument++;
-                switch(XSUM_readU32FromChar(&argument)) {
-                    case 0 :
-                    case 32: algo = algo_xxh32; break;
-                    case 1 :
-                    case 64: algo = algo_xxh64; break;
-                    case 2 :
-                    case 128: algo = algo_xxh128; break;
-                    case 3 :
-                        algo = algo_xxh3; break;
-                    default:
-                        return XSUM_badusage(exename);
+                algoList.nbAlgos = 0;
+                for (;;) {
+                    switch(XSUM_readU32FromChar(&argument)) {
+                        case 0 :
+                        case 32: algo = algo_xxh32; break;
+                        case 1 :
+                        case 64: algo = algo_xxh64; break;
+                        case 2 :
+                        case 128: algo = algo_xxh128; break;
+                        case 3 :
+                            algo = algo_xxh3; break;
+                        default:
+                            return XSUM_badusage(exename);
+                    }
+                    XSUM_algoList_add(&algoList, algo);
+                    /* -H1,2 : several algorithms, computed in one pass */
+                    if (*argument != ',') break;
+                    argument++;
+                    if (*argument < '0' || *argument > '9') return XSUM_badusage(exename);
                 }
                 break;
 
@@ -1332,6 +4306,21 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
             case 'B':
                 argument++;
                 keySize = XSUM_readU32FromChar(&argument);
+                benchBlockSize = keySize;
+                break;
+
+            /* Recurse into directories */
+            case 'r':
+                recursive = 1;
+                argument++;
+                break;
+
+            /* Number of hashing threads (0 == one per core) */
+            case 'T':
+                argument++;
+                nbThreads = (int)XSUM_readU32FromChar(&argument);
+                threadCounts[0] = nbThreads;
+                nbThreadCounts = 1;
                 break;
 
             /* Modify verbosity of benchmark output (hidden option) */
@@ -1348,11 +4337,24 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
 
     /* Check benchmark mode */
     if (benchmarkMode) {
+        int const reported = (benchFormat != XSUM_benchFormat_text || benchBaseline != NULL);
         XSUM_logVerbose(2, FULL_WELCOME_MESSAGE(exename) );
         XSUM_sanityCheck();
         g_nbIterations = nbIterations;
         if (selectBenchIDs == 0) memcpy(g_testIDs, k_testIDs_default, (size_t)g_nbTestFunctions);
         if (selectBenchIDs == kBenchAll) memset(g_testIDs, 1, (size_t)g_nbTestFunctions);
+        if (benchIO) {
+            if (filenamesStart==0 || nbThreadCounts > 1 || pinThreads || reported) return XSUM_badusage(exename);
+            return XSUM_benchFilesIO(argv+filenamesStart, argc-filenamesStart, benchBlockSize,
+                                     nbThreadCounts ? nbThreads : -1 /* default */);
+        }
+        if (nbThreadCounts > 0) {
+            if (filenamesStart!=0 || reported) return XSUM_badusage(exename);
+            return XSUM_benchThreads(threadCounts, nbThreadCounts, benchBlockSize, pinThreads);
+        }
+        if (pinThreads) return XSUM_badusage(exename);
+        if (benchBaseline != NULL && XSUM_benchLoadBaseline(benchBaseline)) return 1;
+        g_benchFormat = benchFormat;
         if (filenamesStart==0) return XSUM_benchInternal(keySize);
         return XSUM_benchFiles(argv+filenamesStart, argc-filenamesStart);
     }
@@ -1362,10 +4364,134 @@ XSUM_API int XSUM_main(int argc, const char* argv[])
         return XSUM_badusage(exename);
 
     if (filenamesStart==0) filenamesStart = argc;
+    if (nbThreads == 0) nbThreads = XSUM_getNbCores();
+    if (compareSignature) {
+        if (argc - filenamesStart != 2) return XSUM_badusage(exename);
+        return XSUM_compareSignatures(argv[filenamesStart], argv[filenamesStart+1]);
+    }
+    if (nbThreadCounts > 1 || pinThreads || benchFormat != XSUM_benchFormat_text || benchBaseline != NULL)
+        return XSUM_badusage(exename);
+    if (nbOnly > 0 && !fileCheckMode) return XSUM_badusage(exename);
+    if ((diskOrder > 0 && !fileCheckMode) || (completionOrder && diskOrder == 0)) return XSUM_badusage(exename);
+    if ((manifestFile != NULL || debounceMs >= 0) && !watchMode) return XSUM_badusage(exename);
+    if (watchMode && fileCheckMode) return XSUM_badusage(exename);
+    if (stateDir != NULL && fileCheckMode) return XSUM_badusage(exename);
+    if (convertFile != NULL) {
+        if (fileCheckMode || indexFile != NULL) return XSUM_badusage(exename);
+        return XSUM_convertFiles(argv+filenamesStart, argc-filenamesStart, convertFile, displayEndianess, algoBitmask);
+    }
     if (fileCheckMode) {
-        return XSUM_checkFiles(argv+filenamesStart, argc-filenamesStart,
-                          displayEndianess, strictMode, statusOnly, ignoreMissing, warn, (XSUM_logLevel < 2) /*quiet*/, algoBitmask);
+        int result;
+        if (indexFile != NULL) return XSUM_badusage(exename);
+        if (statsMode) {
+            XSUM_statsEnabled = 1;
+            XSUM_stats_start();
+        }
+        result = XSUM_checkFiles(argv+filenamesStart, argc-filenamesStart,
+                          displayEndianess, strictMode, statusOnly, ignoreMissing, warn, (XSUM_logLevel < 2) /*quiet*/, algoBitmask, nbThreads,
+                          onlyList, nbOnly, diskOrder, completionOrder);
+        free((void*)onlyList);
+        if (statsMode) XSUM_stats_display(statsMode == 2, XSUM_algoName, XSUM_ALGO_MAX);
+        return result;
     } else {
-        return XSUM_hashFiles(argv+filenamesStart, argc-filenamesStart, algo, displayEndianess, convention);
+        HashFilesArg hashFilesArg;
+        int result;
+        if (algoList.nbAlgos == 0) XSUM_algoList_add(&algoList, algo);
+        if (findDupes) {
+            /* files are compared with XXH3 fingerprints, then XXH128 */
+            if (chunkSize > 0 || filenamesStart == argc) return XSUM_badusage(exename);
+            algoList.nbAlgos = 0;
+            XSUM_algoList_add(&algoList, algo_xxh128);
+        }
+        if (treeIndexFile != NULL && (!treeHash || argc - filenamesStart != 1)) return XSUM_badusage(exename);
+        if (treeHash) {
+            /* directories only, digests are XXH128 */
+            if (findDupes || chunkSize > 0 || teeMode || tarMode || filenamesStart == argc)
+                return XSUM_badusage(exename);
+            algoList.nbAlgos = 0;
+            XSUM_algoList_add(&algoList, algo_xxh128);
+        }
+        if (tarMode) {
+            /* members of archives, read sequentially */
+            if (findDupes || chunkSize > 0 || recursive || cacheSpec != NULL || teeMode) return XSUM_badusage(exename);
+        }
+        if (teeMode) {
+            /* stdin only, forwarded to stdout */
+            if (findDupes || chunkSize > 0 || recursive || cacheSpec != NULL) return XSUM_badusage(exename);
+            if (filenamesStart < argc && !(argc - filenamesStart == 1 && !strcmp(argv[filenamesStart], stdinName)))
+                return XSUM_badusage(exename);
+        }
+        if (watchMode) {
+            /* a single directory, checksum lines only */
+            if ( findDupes || treeHash || chunkSize > 0 || teeMode || tarMode || indexFile != NULL
+              || manifestFile == NULL || argc - filenamesStart != 1 )
+                return XSUM_badusage(exename);
+            recursive = 1;
+        }
+        if (stateDir != NULL) {
+            /* only files are hashed with XSUM_hashFileJob() */
+            if (findDupes || chunkSize > 0 || teeMode || tarMode) return XSUM_badusage(exename);
+            if (!XSUM_isDirectory(stateDir)) {
+                XSUM_log("xxhsum: %s: Not a directory \n", stateDir);
+                return 1;
+        }   }
+        if (indexFile != NULL) {
+            /* an index holds the digests of a single algorithm */
+            if (findDupes || treeHash || chunkSize > 0 || algoList.nbAlgos > 1) return XSUM_badusage(exename);
+        }
+        if (statsMode) {
+            /* files hashed and displayed one by one */
+            if (findDupes || treeHash || watchMode || teeMode || tarMode || chunkSize > 0)
+                return XSUM_badusage(exename);
+        }
+        if (chunkSize > 0) {
+            /* one signature per file: a single algorithm, and no directory */
+            if (algoList.nbAlgos > 1 || recursive) return XSUM_badusage(exename);
+            return XSUM_signatureFiles(argv+filenamesStart, argc-filenamesStart, algoList.algos[0], chunkSize, nbThreads);
+        }
+        hashFilesArg.algos            = algoList;
+        hashFilesArg.displayEndianess = displayEndianess;
+        hashFilesArg.convention       = convention;
+        hashFilesArg.recursive        = (int)recursive;
+        hashFilesArg.sortFiles        = (int)sortFiles;
+        hashFilesArg.nbThreads        = nbThreads;
+        hashFilesArg.cache            = NULL;
+        hashFilesArg.index            = NULL;
+        hashFilesArg.stateDir         = stateDir;
+        if (indexFile != NULL) {
+            AlgoSelected const indexAlgo = algoList.algos[0];
+            hashFilesArg.index = XSUM_indexWriter_create(XSUM_algoName[indexAlgo], XSUM_algoLength[indexAlgo]);
+            if (hashFilesArg.index == NULL) return 1;
+        }
+        if (cacheSpec != NULL) {
+            hashFilesArg.cache = XSUM_cache_create(cacheSpec);
+            if (hashFilesArg.cache == NULL) return 1;
+        }
+        if (statsMode) {
+            XSUM_statsEnabled = 1;
+            XSUM_stats_start();
+        }
+        if (watchMode) {
+            result = XSUM_watchTree(argv[filenamesStart], manifestFile, &hashFilesArg,
+                                    debounceMs >= 0 ? debounceMs : XSUM_WATCH_DEBOUNCE_DEFAULT);
+        } else if (treeHash) {
+            result = XSUM_treeHash(argv+filenamesStart, argc-filenamesStart, &hashFilesArg, treeIndexFile);
+        } else if (tarMode) {
+            result = XSUM_hashTarFiles(argv+filenamesStart, argc-filenamesStart, &hashFilesArg);
+        } else if (teeMode) {
+            result = XSUM_teeStdin(&hashFilesArg, teeDigestFile);
+        } else if (findDupes) {
+            result = XSUM_findDupes(argv+filenamesStart, argc-filenamesStart, &hashFilesArg);
+        } else {
+            result = XSUM_hashFiles(argv+filenamesStart, argc-filenamesStart, &hashFilesArg);
+        }
+        result |= XSUM_cache_free(hashFilesArg.cache);
+        if (hashFilesArg.index != NULL) {
+            /* files which could not be read are reported, and left out */
+            result |= XSUM_indexWriter_write(hashFilesArg.index, indexFile);
+            XSUM_indexWriter_free(hashFilesArg.index);
+        }
+        if (statsMode) XSUM_stats_display(statsMode == 2, XSUM_algoName, XSUM_ALGO_MAX);
+        return result;
     }
 }
@@ -53,13 +53,16 @@ typedef size_t (*sizeFunction_f)(size_t targetSize);
 
 /*
  * bench_hash_internal():
- * Benchmarks hashfn repeateadly over single input of size `size`
+ * Benchmarks hashfn repeateadly over single input,
+ * hashing sizes[n] bytes for block n. All sizes must be <= size.
  * return: nb of hashes per second
+ * counters: optional, receives hardware counters per hash
  */
 static double
 bench_hash_internal(BMK_benchFn_t hashfn, void* payload,
-                    size_t nbBlocks, sizeFunction_f selectSize, size_t size,
-                    unsigned total_time_ms, unsigned iter_time_ms)
+                    size_t nbBlocks, const size_t* sizes, size_t size,
+                    unsigned total_time_ms, unsigned iter_time_ms,
+                    BMK_perfCounts_t* counters)
 {
     BMK_timedFnState_shell shell;
     BMK_timedFnState_t* const txf = BMK_initStatic_timedFnState(&shell, sizeof(shell), total_time_ms, iter_time_ms);
@@ -74,17 +77,15 @@ bench_hash_internal(BMK_benchFn_t hashfn, void* payload,
     size_t const dstSize = FAKE_DSTSIZE;
     char dstBuffer_static[FAKE_DSTSIZE] = {0};
 
-    #define NB_BLOCKS_MAX 1024
-    const void* srcBuffers[NB_BLOCKS_MAX];
-    size_t srcSizes[NB_BLOCKS_MAX];
-    void* dstBuffers[NB_BLOCKS_MAX];
-    size_t dstCapacities[NB_BLOCKS_MAX];
-    assert(nbBlocks < NB_BLOCKS_MAX);
+    const void** const srcBuffers = (const void**)malloc(nbBlocks * sizeof(*srcBuffers));
+    void** const dstBuffers = (void**)malloc(nbBlocks * sizeof(*dstBuffers));
+    size_t* const dstCapacities = (size_t*)malloc(nbBlocks * sizeof(*dstCapacities));
+    assert(srcBuffers != NULL && dstBuffers != NULL && dstCapacities != NULL);
 
     assert(size > 0);
     for (size_t n=0; n < nbBlocks; n++) {
+        assert(sizes[n] <= size);
         srcBuffers[n] = srcBuffer;
-        srcSizes[n] = selectSize(size);
         dstBuffers[n] = dstBuffer_static;
         dstCapacities[n] = dstSize;
     }
@@ -98,7 +99,7 @@ bench_hash_internal(BMK_benchFn_t hashfn, void* payload,
         .errorFn = NULL,
         .blockCount = nbBlocks,
         .srcBuffers = srcBuffers,
-        .srcSizes = srcSizes,
+        .srcSizes = sizes,
         .dstBuffers = dstBuffers,
         .dstCapacities = dstCapacities,
         .blockResults = NULL
@@ -113,6 +114,15 @@ bench_hash_internal(BMK_benchFn_t hashfn, void* payload,
 
     BMK_runTime_t const runTime = BMK_extract_runTime(result);
 
+    if (counters != NULL) {
+        *counters = runTime.counters;
+        for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++)
+            counters->count[n] /= (double)nbBlocks;
+    }
+
+    free(dstCapacities);
+    free(dstBuffers);
+    free(srcBuffers);
     free(srcBuffer);
     assert(runTime.nanoSecPerRun != 0);
     return (1000000000U / runTime.nanoSecPerRun) * nbBlocks;
@@ -151,7 +161,8 @@ benchLatency(const void* src, size_t srcSize,
 double bench_hash(BMK_benchFn_t hashfn,
                   BMK_benchMode benchMode,
                   size_t size, BMK_sizeMode sizeMode,
-                  unsigned total_time_ms, unsigned iter_time_ms)
+                  unsigned total_time_ms, unsigned iter_time_ms,
+                  BMK_perfCounts_t* counters)
 {
     sizeFunction_f const sizef = (sizeMode == BMK_fixedSize) ? identity : rand_1_N;
     BMK_benchFn_t const benchfn = (benchMode == BMK_throughput) ? hashfn : benchLatency;
@@ -160,7 +171,186 @@ double bench_hash(BMK_benchFn_t hashfn,
     size_t nbBlocks = (SIZE_TO_HASH_PER_ROUND / size) + 1;
     if (nbBlocks > NB_HASH_ROUNDS_MAX) nbBlocks = NB_HASH_ROUNDS_MAX;
 
+    size_t sizes[NB_HASH_ROUNDS_MAX];
+    for (size_t n=0; n < nbBlocks; n++) sizes[n] = sizef(size);
+
+    return bench_hash_internal(benchfn, (void *)payload,
+                               nbBlocks, sizes, size,
+                               total_time_ms, iter_time_ms,
+                               counters);
+}
+
+double bench_hash_lengths(BMK_benchFn_t hashfn,
+                          BMK_benchMode benchMode,
+                          const size_t* lengths, size_t nbLengths,
+                          unsigned total_time_ms, unsigned iter_time_ms,
+                          BMK_perfCounts_t* counters)
+{
+    BMK_benchFn_t const benchfn = (benchMode == BMK_throughput) ? hashfn : benchLatency;
+    BMK_benchFn_t const payload = (benchMode == BMK_throughput) ? NULL : hashfn;
+    size_t maxLength = 1;
+
+    assert(nbLengths > 0);
+    for (size_t n=0; n < nbLengths; n++)
+        if (lengths[n] > maxLength) maxLength = lengths[n];
+
     return bench_hash_internal(benchfn, (void *)payload,
-                               nbBlocks, sizef, size,
-                               total_time_ms, iter_time_ms);
+                               nbLengths, lengths, maxLength,
+                               total_time_ms, iter_time_ms,
+                               counters);
+}
+
+
+/* ===  working set sweep  === */
+
+#define WS_LINE_SIZE      64
+#define WS_KEYS_PER_CALL 256
+
+typedef struct {
+    BMK_benchFn_t hashfn;
+    const unsigned char* base;
+    size_t slotSize;     /* distance between 2 keys, multiple of WS_LINE_SIZE */
+    size_t nbSlots;
+    size_t pos;          /* next slot to hash, carried over successive calls */
+    BMK_wsOrder order;
+    void* scratch;       /* slotSize bytes, handed to hashfn as dst */
+} ws_walker;
+
+static size_t ws_nextSlot(const ws_walker* w, size_t pos)
+{
+    if (w->order == BMK_pointerChase) {
+        unsigned next;   /* load depends on the current key : defeats prefetching */
+        memcpy(&next, w->base + pos * w->slotSize, sizeof(next));
+        return next;
+    }
+    return (pos + 1 == w->nbSlots) ? 0 : pos + 1;
+}
+
+/* hashes WS_KEYS_PER_CALL different keys per invocation */
+static size_t
+ws_walk(const void* src, size_t srcSize,
+        void* dst, size_t dstCapacity,
+        void* customPayload)
+{
+    ws_walker* const w = (ws_walker*)customPayload;
+    size_t acc = 0;
+    size_t pos = w->pos;
+    (void)src; (void)dst; (void)dstCapacity;
+    for (int n = 0; n < WS_KEYS_PER_CALL; n++) {
+        acc += w->hashfn(w->base + pos * w->slotSize, srcSize, w->scratch, w->slotSize, NULL);
+        pos = ws_nextSlot(w, pos);
+    }
+    w->pos = pos;
+    return acc;
+}
+
+/* baseline : same walk, but each cache line of each key is only touched
+ * by a volatile load, without any call : a lower bound on the cost per key */
+static size_t
+ws_touch(const void* src, size_t srcSize,
+         void* dst, size_t dstCapacity,
+         void* customPayload)
+{
+    ws_walker* const w = (ws_walker*)customPayload;
+    size_t acc = 0;
+    size_t pos = w->pos;
+    (void)src; (void)dst; (void)dstCapacity;
+    for (int n = 0; n < WS_KEYS_PER_CALL; n++) {
+        const volatile unsigned char* const key = w->base + pos * w->slotSize;
+        for (size_t l = 0; l < srcSize; l += WS_LINE_SIZE) acc += key[l];
+        pos = ws_nextSlot(w, pos);
+    }
+    w->pos = pos;
+    return acc;
+}
+
+/* links all slots into a single random cycle (Sattolo's algorithm) */
+static void ws_linkSlots(unsigned char* base, size_t slotSize, size_t nbSlots)
+{
+    unsigned* const perm = (unsigned*)malloc(nbSlots * sizeof(*perm));
+    unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+    assert(perm != NULL);
+    assert(nbSlots <= (unsigned)-1);
+    for (size_t n = 0; n < nbSlots; n++) perm[n] = (unsigned)n;
+    for (size_t n = nbSlots - 1; n > 0; n--) {
+        size_t j;
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        j = (size_t)((rng >> 33) % n);   /* j < n : guarantees a single cycle */
+        unsigned const t = perm[n]; perm[n] = perm[j]; perm[j] = t;
+    }
+    /* perm is a cyclic permutation : slot n is followed by slot perm[n] */
+    for (size_t n = 0; n < nbSlots; n++)
+        memcpy(base + n * slotSize, &perm[n], sizeof(perm[n]));
+    free(perm);
+}
+
+double bench_hash_workingSet(BMK_benchFn_t hashfn,
+                             size_t size, size_t workingSetSize, BMK_wsOrder order,
+                             unsigned total_time_ms, unsigned iter_time_ms,
+                             BMK_perfCounts_t* counters)
+{
+    BMK_timedFnState_shell shell;
+    BMK_timedFnState_t* const txf = BMK_initStatic_timedFnState(&shell, sizeof(shell), total_time_ms, iter_time_ms);
+    assert(txf != NULL);
+    assert(size > 0);
+
+    size_t const slotSize = ((size + WS_LINE_SIZE - 1) / WS_LINE_SIZE) * WS_LINE_SIZE;
+    size_t const nbSlots = (workingSetSize > slotSize) ? workingSetSize / slotSize : 1;
+    unsigned char* const wsBuffer = (unsigned char*)malloc(nbSlots * slotSize);
+    void* const scratch = malloc(slotSize);
+    assert(wsBuffer != NULL);
+    assert(scratch != NULL);
+    initBuffer(wsBuffer, nbSlots * slotSize);
+    if (order == BMK_pointerChase) ws_linkSlots(wsBuffer, slotSize, nbSlots);
+
+    ws_walker walker = {
+        .hashfn = hashfn,
+        .base = wsBuffer,
+        .slotSize = slotSize,
+        .nbSlots = nbSlots,
+        .pos = 0,
+        .order = order,
+        .scratch = scratch
+    };
+
+    /* a single block : ws_walk() / ws_touch() find their keys through the walker */
+    const void* srcBuffers[1] = { wsBuffer };
+    size_t srcSizes[1] = { size };
+    char dstBuffer_static[FAKE_DSTSIZE] = {0};
+    void* dstBuffers[1] = { dstBuffer_static };
+    size_t dstCapacities[1] = { FAKE_DSTSIZE };
+
+    BMK_benchParams_t params = {
+        .benchFn = (hashfn != NULL) ? ws_walk : ws_touch,
+        .benchPayload = &walker,
+        .initFn = NULL,
+        .initPayload = NULL,
+        .errorFn = NULL,
+        .blockCount = 1,
+        .srcBuffers = srcBuffers,
+        .srcSizes = srcSizes,
+        .dstBuffers = dstBuffers,
+        .dstCapacities = dstCapacities,
+        .blockResults = NULL
+    };
+    BMK_runOutcome_t result;
+
+    memset(&result, 0, sizeof(result));
+    while (!BMK_isCompleted_TimedFn(txf)) {
+        result = BMK_benchTimedFn(txf, params);
+        assert(BMK_isSuccessful_runOutcome(result));
+    }
+
+    BMK_runTime_t const runTime = BMK_extract_runTime(result);
+
+    if (counters != NULL) {
+        *counters = runTime.counters;
+        for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++)
+            counters->count[n] /= (double)WS_KEYS_PER_CALL;
+    }
+
+    free(scratch);
+    free(wsBuffer);
+    assert(runTime.nanoSecPerRun != 0);
+    return (1000000000U / runTime.nanoSecPerRun) * WS_KEYS_PER_CALL;
 }
@@ -46,17 +46,52 @@ typedef enum { BMK_fixedSize,   /* hash always `size` bytes */
                BMK_randomSize,  /* hash a random nb of bytes, between 1 and `size` (inclusive) */
 } BMK_sizeMode;
 
+typedef enum { BMK_sequential,    /* keys are visited in memory order : prefetchers can help */
+               BMK_pointerChase,  /* keys form a random cycle, each key stores the index of the next one */
+} BMK_wsOrder;
+
 /*
  * bench_hash():
  * Returns speed expressed as nb hashes per second.
  * total_time_ms: time spent benchmarking the hash function with given parameters
  * iter_time_ms: time spent for one round. If multiple rounds are run,
  *               bench_hash() will report the speed of best round.
+ * counters: optional (can be NULL), receives hardware counters per hash
+ *           measured during the best round (see perfcounters.h).
  */
 double bench_hash(BMK_benchFn_t hashfn,
                   BMK_benchMode benchMode,
                   size_t size, BMK_sizeMode sizeMode,
-                  unsigned total_time_ms, unsigned iter_time_ms);
+                  unsigned total_time_ms, unsigned iter_time_ms,
+                  BMK_perfCounts_t* counters);
+
+/*
+ * bench_hash_lengths():
+ * Same as bench_hash(), but block n hashes exactly lengths[n] bytes.
+ * `lengths` is generated by the caller, outside of the timed region,
+ * typically from one of the distributions of keyLengths.h.
+ * Returns speed expressed as nb hashes per second.
+ */
+double bench_hash_lengths(BMK_benchFn_t hashfn,
+                          BMK_benchMode benchMode,
+                          const size_t* lengths, size_t nbLengths,
+                          unsigned total_time_ms, unsigned iter_time_ms,
+                          BMK_perfCounts_t* counters);
+
+/*
+ * bench_hash_workingSet():
+ * Same as bench_hash() in throughput mode, but each hash reads a different key
+ * of `size` bytes, taken from a working set of `workingSetSize` bytes.
+ * Keys start on separate cache lines, so the working set size decides
+ * which cache level (or DRAM) serves them.
+ * hashfn == NULL measures the baseline instead : each cache line of each key
+ * is only touched, which bounds the achievable speed for this walk.
+ * Returns speed expressed as nb hashes per second.
+ */
+double bench_hash_workingSet(BMK_benchFn_t hashfn,
+                             size_t size, size_t workingSetSize, BMK_wsOrder order,
+                             unsigned total_time_ms, unsigned iter_time_ms,
+                             BMK_perfCounts_t* counters);
 
 
 
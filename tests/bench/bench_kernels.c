@@ -0,0 +1,332 @@
+/*
+*  Per-kernel, per-length heatmap benchmark
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+/* Benchmarks each XXH3 kernel (XXH_VECTOR variant) linked into this binary,
+ * over a sweep of input lengths and source alignments,
+ * and writes one CSV line per (kernel, length, alignment) on stdout,
+ * ready to be pivoted into a heatmap. Progress is displayed on stderr. */
+
+
+/* ===  Dependencies  === */
+
+#include <stdio.h>       /* printf, fprintf */
+#include <stdlib.h>      /* malloc */
+#include <string.h>      /* strlen, strncmp */
+#include <limits.h>      /* INT_MAX */
+#include "benchfn.h"
+#include "bhKernels.h"
+
+#undef NDEBUG
+#include <assert.h>
+
+
+/* ===  Kernels  === */
+
+typedef struct {
+    const char* name;
+    int (*isSupported)(void);   /* NULL : always supported */
+    BMK_benchFn_t xxh3_64b;
+    BMK_benchFn_t xxh3_128b;
+    int (*vector)(void);
+} BH_kernelEntry;
+
+/* BH_KERNELS_X86 and BH_KERNELS_NEON are set by the Makefile,
+ * together with the list of kernel objects to link (KERNEL_OBJS) */
+#if defined(BH_KERNELS_X86) && BH_KERNELS_X86
+#  if defined(__GNUC__)
+static int has_sse2(void)   { __builtin_cpu_init(); return __builtin_cpu_supports("sse2"); }
+static int has_avx2(void)   { __builtin_cpu_init(); return __builtin_cpu_supports("avx2"); }
+static int has_avx512(void) { __builtin_cpu_init(); return __builtin_cpu_supports("avx512f"); }
+#  else
+#    error "runtime cpu detection requires gcc or clang"
+#  endif
+#endif
+
+#define BH_KERNEL_ENTRY(k, check) { #k, check, bhKernel_##k##_XXH3_64b, bhKernel_##k##_XXH3_128b, bhKernel_##k##_vector }
+static const BH_kernelEntry g_kernels[] = {
+    BH_KERNEL_ENTRY(scalar, NULL),
+#if defined(BH_KERNELS_X86) && BH_KERNELS_X86
+    BH_KERNEL_ENTRY(sse2, has_sse2),
+    BH_KERNEL_ENTRY(avx2, has_avx2),
+    BH_KERNEL_ENTRY(avx512, has_avx512),
+#endif
+#if defined(BH_KERNELS_NEON) && BH_KERNELS_NEON
+    BH_KERNEL_ENTRY(neon, NULL),
+#endif
+};
+#define NB_KERNELS ((int)(sizeof(g_kernels) / sizeof(g_kernels[0])))
+
+static int kernelSupported(const BH_kernelEntry* k)
+{
+    return (k->isSupported == NULL) || k->isSupported();
+}
+
+
+/* ===  Length sweep  === */
+
+/* Every length up to 256 covers the 16 / 128 / 240 bytes boundaries,
+ * steps of 8 up to 1088 cover the 1024 bytes stripe boundary,
+ * then lengths grow by ~1/8 (multiples of 64) up to maxLen. */
+static size_t nextLength(size_t len, size_t maxLen)
+{
+    size_t next;
+    if (len < 256) next = len + 1;
+    else if (len < 1088) next = len + 8;
+    else next = ((len + (len >> 3) + 63) / 64) * 64;
+    if ((next > maxLen) && (len < maxLen)) next = maxLen;
+    return next;
+}
+
+
+/* ===  Benchmark  === */
+
+#define SIZE_TO_HASH_PER_ROUND 200000
+#define NB_BLOCKS_MAX 1000
+#define FAKE_DSTSIZE 32
+
+/* @return : nb of hashes per second */
+static double bench_kernel(BMK_benchFn_t hashfn, const void* src, size_t len,
+                           unsigned total_time_ms, unsigned iter_time_ms)
+{
+    BMK_timedFnState_shell shell;
+    BMK_timedFnState_t* const txf = BMK_initStatic_timedFnState(&shell, sizeof(shell), total_time_ms, iter_time_ms);
+    char dstBuffer_static[FAKE_DSTSIZE] = {0};
+    const void* srcBuffers[NB_BLOCKS_MAX];
+    size_t srcSizes[NB_BLOCKS_MAX];
+    void* dstBuffers[NB_BLOCKS_MAX];
+    size_t dstCapacities[NB_BLOCKS_MAX];
+    size_t nbBlocks = (SIZE_TO_HASH_PER_ROUND / (len + 1)) + 1;
+    if (nbBlocks > NB_BLOCKS_MAX) nbBlocks = NB_BLOCKS_MAX;
+    assert(txf != NULL);
+
+    for (size_t n = 0; n < nbBlocks; n++) {
+        srcBuffers[n] = src;
+        srcSizes[n] = len;
+        dstBuffers[n] = dstBuffer_static;
+        dstCapacities[n] = FAKE_DSTSIZE;
+    }
+
+    BMK_benchParams_t params = {
+        .benchFn = hashfn,
+        .benchPayload = NULL,
+        .initFn = NULL,
+        .initPayload = NULL,
+        .errorFn = NULL,
+        .blockCount = nbBlocks,
+        .srcBuffers = srcBuffers,
+        .srcSizes = srcSizes,
+        .dstBuffers = dstBuffers,
+        .dstCapacities = dstCapacities,
+        .blockResults = NULL
+    };
+    BMK_runOutcome_t result;
+
+    memset(&result, 0, sizeof(result));
+    while (!BMK_isCompleted_TimedFn(txf)) {
+        result = BMK_benchTimedFn(txf, params);
+        assert(BMK_isSuccessful_runOutcome(result));
+    }
+
+    BMK_runTime_t const runTime = BMK_extract_runTime(result);
+    assert(runTime.nanoSecPerRun != 0);
+    return (1000000000U / runTime.nanoSecPerRun) * nbBlocks;
+}
+
+
+/* ===  parse command line  === */
+
+static int isCommand(const char* string, const char* longCommand)
+{
+    size_t const comSize = strlen(longCommand);
+    return !strncmp(string, longCommand, comSize);
+}
+
+static int longCommandWArg(const char** stringPtr, const char* longCommand)
+{
+    size_t const comSize = strlen(longCommand);
+    int const result = isCommand(*stringPtr, longCommand);
+    if (result) *stringPtr += comSize;
+    return result;
+}
+
+/* Allows and interprets K and M suffixes (KB, KiB, MB, MiB) */
+static int readIntFromChar(const char** stringPtr)
+{
+    static int const max = (INT_MAX / 10) - 1;
+    int result = 0;
+    while ((**stringPtr >='0') && (**stringPtr <='9')) {
+        assert(result < max);
+        result *= 10;
+        result += (unsigned)(**stringPtr - '0');
+        (*stringPtr)++ ;
+    }
+    if ((**stringPtr=='K') || (**stringPtr=='M')) {
+        int const maxK = INT_MAX >> 10;
+        assert(result < maxK);
+        result <<= 10;
+        if (**stringPtr=='M') {
+            assert(result < maxK);
+            result <<= 10;
+        }
+        (*stringPtr)++;  /* skip `K` or `M` */
+        if (**stringPtr=='i') (*stringPtr)++;
+        if (**stringPtr=='B') (*stringPtr)++;
+    }
+    return result;
+}
+
+
+/* ===   default values - can be redefined at compilation time   === */
+
+#ifndef MAXLEN_DEFAULT
+#  define MAXLEN_DEFAULT  (1 << 20)
+#endif
+#ifndef TIME_MS_DEFAULT
+#  define TIME_MS_DEFAULT 30   /* per measurement */
+#endif
+#define ALIGN_MAX      63
+#define NB_ALIGNS_MAX  16
+
+
+static int list_kernels(void)
+{
+    for (int k = 0; k < NB_KERNELS; k++) {
+        /* vector() is compiled for its kernel's isa : only call it when supported */
+        if (kernelSupported(&g_kernels[k]))
+            printf("%-7s (XXH_VECTOR=%i) : supported \n", g_kernels[k].name, g_kernels[k].vector());
+        else
+            printf("%-7s : not supported by this cpu \n", g_kernels[k].name);
+    }
+    return 0;
+}
+
+static int help(const char* exename)
+{
+    printf("Usage: %s [options]... \n", exename);
+    printf("Benchmarks XXH3 for each XXH_VECTOR kernel built into this binary, \n");
+    printf("over a sweep of input lengths, and outputs one CSV line per \n");
+    printf("(kernel, length, alignment) : GB/s and ns/hash. \n\n");
+    printf("Options: \n");
+    printf("  --list          List kernels and whether this cpu supports them \n");
+    printf("  --kernel=NAME   Only benchmark kernel NAME \n");
+    printf("  --128           Benchmark XXH3_128bits instead of XXH3_64bits \n");
+    printf("  --minlen=LEN    Starting length (default: 0) \n");
+    printf("  --maxlen=LEN    End length (default: %i) \n", MAXLEN_DEFAULT);
+    printf("  --align=LIST    Source offsets from a 64-byte boundary (default: 0,1) \n");
+    printf("  --time=MS       Duration of each measurement (default: %i) \n", TIME_MS_DEFAULT);
+    return 0;
+}
+
+static int badusage(const char* exename)
+{
+    printf("Bad command ... \n");
+    help(exename);
+    return 1;
+}
+
+int main(int argc, const char* argv[])
+{
+    const char* const exename = argv[0];
+    const char* kernelName = NULL;
+    int use128 = 0;
+    size_t minLen = 0;
+    size_t maxLen = MAXLEN_DEFAULT;
+    int aligns[NB_ALIGNS_MAX] = { 0, 1 };
+    int nbAligns = 2;
+    unsigned time_ms = TIME_MS_DEFAULT;
+
+    for (int arg_nb = 1; arg_nb < argc; arg_nb++) {
+        const char** arg = argv + arg_nb;
+        if (isCommand(*arg, "-h")) return help(exename);
+        if (isCommand(*arg, "--list")) return list_kernels();
+        if (longCommandWArg(arg, "--kernel=")) { kernelName = *arg; continue; }
+        if (isCommand(*arg, "--128")) { use128 = 1; continue; }
+        if (longCommandWArg(arg, "--minlen=")) { minLen = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--maxlen=")) { maxLen = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--time=")) { time_ms = (unsigned)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--align=")) {
+            nbAligns = 0;
+            for (;;) {
+                if ((**arg < '0') || (**arg > '9') || (nbAligns == NB_ALIGNS_MAX)) return badusage(exename);
+                aligns[nbAligns] = readIntFromChar(arg);
+                if (aligns[nbAligns] > ALIGN_MAX) return badusage(exename);
+                nbAligns++;
+                if (**arg == 0) break;
+                if (**arg != ',') return badusage(exename);
+                (*arg)++;
+            }
+            continue;
+        }
+        return badusage(exename);
+    }
+    if (minLen > maxLen) return badusage(exename);
+    if (time_ms == 0) time_ms = 1;
+
+    {   int found = (kernelName == NULL);
+        for (int k = 0; k < NB_KERNELS; k++)
+            found |= (kernelName != NULL) && !strcmp(kernelName, g_kernels[k].name);
+        if (!found) {
+            fprintf(stderr, "unknown kernel %s \n", kernelName);
+            return 1;
+    }   }
+
+    /* 64-byte aligned base, with room for the largest offset */
+    unsigned char* const buffer = (unsigned char*)malloc(maxLen + 2 * (ALIGN_MAX + 1));
+    assert(buffer != NULL);
+    unsigned char* const base = buffer + ((ALIGN_MAX + 1) - ((size_t)buffer & ALIGN_MAX));
+    {   unsigned long long acc = 14029467366897019727ULL;
+        for (size_t n = 0; n < maxLen + ALIGN_MAX + 1; n++) {
+            acc *= 11400714785074694791ULL;
+            base[n] = (unsigned char)(acc >> 56);
+    }   }
+
+    printf("kernel,hash,length,alignment,gb_per_s,ns_per_hash\n");
+    for (int k = 0; k < NB_KERNELS; k++) {
+        const BH_kernelEntry* const kernel = &g_kernels[k];
+        BMK_benchFn_t const hashfn = use128 ? kernel->xxh3_128b : kernel->xxh3_64b;
+        const char* const hashName = use128 ? "XXH3_128" : "XXH3_64";
+        if ((kernelName != NULL) && strcmp(kernelName, kernel->name)) continue;
+        if (!kernelSupported(kernel)) {
+            fprintf(stderr, "%s : not supported by this cpu, skipped \n", kernel->name);
+            continue;
+        }
+        for (size_t len = minLen; ; len = nextLength(len, maxLen)) {
+            fprintf(stderr, "\r%-7s %8zu bytes ", kernel->name, len);
+            for (int a = 0; a < nbAligns; a++) {
+                double const nbhps = bench_kernel(hashfn, base + aligns[a], len, time_ms, (time_ms + 2) / 3);
+                printf("%s,%s,%zu,%i,%.3f,%.2f\n", kernel->name, hashName, len, aligns[a],
+                        nbhps * (double)len / 1e9, 1e9 / nbhps);
+            }
+            fflush(stdout);
+            if (len >= maxLen) break;
+        }
+        fprintf(stderr, "\r%-7s done %17s\n", kernel->name, "");
+    }
+
+    free(buffer);
+    return 0;
+}
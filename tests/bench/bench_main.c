@@ -118,6 +118,15 @@ static int longCommandWArg(const char** stringPtr, const char* longCommand)
 #ifndef LARGE_SIZELOG_MAX_DEFAULT
 #  define LARGE_SIZELOG_MAX_DEFAULT  27
 #endif
+#ifndef WS_SIZELOG_MIN_DEFAULT
+#  define WS_SIZELOG_MIN_DEFAULT   12   /* 4 KB : L1 */
+#endif
+#ifndef WS_SIZELOG_MAX_DEFAULT
+#  define WS_SIZELOG_MAX_DEFAULT   28   /* 256 MB : DRAM */
+#endif
+#ifndef WS_KEYSIZE_DEFAULT
+#  define WS_KEYSIZE_DEFAULT       16
+#endif
 
 
 static int display_hash_names(void)
@@ -158,6 +167,17 @@ static int help(const char* exename)
     printf("  --maxs=LEN   End length for small size bench (default: %i) \n", SMALL_SIZE_MAX_DEFAULT);
     printf("  --minl=LEN   Starting log2(length) for large size bench (default: %i) \n", LARGE_SIZELOG_MIN_DEFAULT);
     printf("  --maxl=LEN   End log2(length) for large size bench (default: %i) \n", LARGE_SIZELOG_MAX_DEFAULT);
+    printf("  --ws         Working set sweep : each hash reads a different, possibly cold, key \n");
+    printf("  --wsmin=LOG  Starting log2(working set size) (default: %i) \n", WS_SIZELOG_MIN_DEFAULT);
+    printf("  --wsmax=LOG  End log2(working set size) (default: %i) \n", WS_SIZELOG_MAX_DEFAULT);
+    printf("  --wskey=LEN  Key length for the working set sweep (default: %i) \n", WS_KEYSIZE_DEFAULT);
+    printf("  --chase      Visit keys in pointer-chasing order instead of sequentially \n");
+    printf("  --dist=SPEC  Key length distribution, can be repeated : uniform, zipf[:S], \n");
+    printf("               bimodal:A,B[,P] or file:PATH (\"length weight\" lines) \n");
+    printf("  --distmax=LEN  Range [1-LEN] of uniform and zipf (default: %i) \n", SMALL_SIZE_MAX_DEFAULT);
+    printf("  (the default size benchmarks are skipped when only --dist or --ws are requested, \n");
+    printf("   unless --minl, --maxl, --mins or --maxs are provided) \n");
+    printf("  --perf       Also report hardware counters per byte (Linux perf_event_open) \n");
     printf("  [hash]       Optional, bench all available hashes if not provided \n");
     return 0;
 }
@@ -178,6 +198,17 @@ int main(int argc, const char* argv[])
     int largeTest_log_max = LARGE_SIZELOG_MAX_DEFAULT;
     size_t smallTest_size_min = SMALL_SIZE_MIN_DEFAULT;
     size_t smallTest_size_max = SMALL_SIZE_MAX_DEFAULT;
+    int perfCounters = 0;
+    int wsSweep = 0;
+    int wsLog_min = WS_SIZELOG_MIN_DEFAULT;
+    int wsLog_max = WS_SIZELOG_MAX_DEFAULT;
+    size_t wsKeySize = WS_KEYSIZE_DEFAULT;
+    BMK_wsOrder wsOrder = BMK_sequential;
+#define NB_DISTS_MAX 16
+    const char* distSpecs[NB_DISTS_MAX];
+    int nbDists = 0;
+    size_t distMax = SMALL_SIZE_MAX_DEFAULT;
+    int sizeTablesRequested = 0;   /* --minl, --maxl, --mins or --maxs */
 
     int arg_nb;
     for (arg_nb = 1; arg_nb < argc; arg_nb++) {
@@ -185,10 +216,22 @@ int main(int argc, const char* argv[])
         if (isCommand(*arg, "-h")) { assert(argc >= 1); return help(exename); }
         if (isCommand(*arg, "--list")) { return display_hash_names(); }
         if (longCommandWArg(arg, "--n=")) { nb_h_test = readIntFromChar(arg); continue; }  /* hidden command */
-        if (longCommandWArg(arg, "--minl=")) { largeTest_log_min = readIntFromChar(arg); continue; }
-        if (longCommandWArg(arg, "--maxl=")) { largeTest_log_max = readIntFromChar(arg); continue; }
-        if (longCommandWArg(arg, "--mins=")) { smallTest_size_min = (size_t)readIntFromChar(arg); continue; }
-        if (longCommandWArg(arg, "--maxs=")) { smallTest_size_max = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--minl=")) { sizeTablesRequested = 1; largeTest_log_min = readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--maxl=")) { sizeTablesRequested = 1; largeTest_log_max = readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--mins=")) { sizeTablesRequested = 1; smallTest_size_min = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--maxs=")) { sizeTablesRequested = 1; smallTest_size_max = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--wsmin=")) { wsLog_min = readIntFromChar(arg); wsSweep = 1; continue; }
+        if (longCommandWArg(arg, "--wsmax=")) { wsLog_max = readIntFromChar(arg); wsSweep = 1; continue; }
+        if (longCommandWArg(arg, "--wskey=")) { wsKeySize = (size_t)readIntFromChar(arg); wsSweep = 1; continue; }
+        if (isCommand(*arg, "--chase")) { wsOrder = BMK_pointerChase; wsSweep = 1; continue; }
+        if (isCommand(*arg, "--ws")) { wsSweep = 1; continue; }
+        if (longCommandWArg(arg, "--distmax=")) { distMax = (size_t)readIntFromChar(arg); continue; }
+        if (longCommandWArg(arg, "--dist=")) {
+            if (nbDists == NB_DISTS_MAX) return badusage(exename);
+            distSpecs[nbDists++] = *arg;
+            continue;
+        }
+        if (isCommand(*arg, "--perf")) { perfCounters = 1; continue; }
         /* not a command: must be a hash name */
         hashNb = hashID(*arg);
         if (hashNb >= 0) {
@@ -199,12 +242,44 @@ int main(int argc, const char* argv[])
         }
     }
 
+    if (wsSweep && ((wsKeySize == 0) || (wsLog_max > 34))) {
+        printf("wrong working set parameters \n");
+        return 1;
+    }
+
     /* border case (requires (mis)using hidden command `--n=#`) */
     if (hashNb + nb_h_test > NB_HASHES) {
         printf("wrong hash selection \n");
         return 1;
     }
 
+    BMK_lengthDist* dists[NB_DISTS_MAX];
+    for (int d = 0; d < nbDists; d++) {
+        const char* reason = NULL;
+        dists[d] = BMK_lengthDist_create(distSpecs[d], distMax, &reason);
+        if (dists[d] == NULL) {
+            printf("invalid distribution %s : %s \n", distSpecs[d], reason);
+            return 1;
+        }
+    }
+
+    if (perfCounters) {
+        const char* reason = NULL;
+        int const nbCounters = BMK_perf_init(&reason);
+        if (nbCounters == 0) {
+            printf("hardware counters unavailable : %s \n", reason);
+        } else if (nbCounters < BMK_PERF_NB_COUNTERS) {
+            printf("only %i of %i hardware counters available \n", nbCounters, BMK_PERF_NB_COUNTERS);
+        }
+    }
+
+    /* only the requested specialized benchmarks */
+    if (((nbDists > 0) || wsSweep) && !sizeTablesRequested) {
+        largeTest_log_max = largeTest_log_min - 1;
+        smallTest_size_max = 0;
+        smallTest_size_min = 1;
+    }
+
     printf(" ===  benchmarking %i hash functions  === \n", nb_h_test);
     if (largeTest_log_max >= largeTest_log_min) {
         bench_largeInput(hashCandidates+hashNb, nb_h_test, largeTest_log_min, largeTest_log_max);
@@ -215,6 +290,14 @@ int main(int argc, const char* argv[])
         bench_latency_smallInputs(hashCandidates+hashNb, nb_h_test, smallTest_size_min, smallTest_size_max);
         bench_latency_randomInputLength(hashCandidates+hashNb, nb_h_test, smallTest_size_min, smallTest_size_max);
     }
+    if (wsSweep && (wsLog_max >= wsLog_min)) {
+        bench_workingSet(hashCandidates+hashNb, nb_h_test, wsKeySize, wsLog_min, wsLog_max, wsOrder);
+    }
+    for (int d = 0; d < nbDists; d++) {
+        bench_lengthDistribution(hashCandidates+hashNb, nb_h_test, dists[d]);
+        BMK_lengthDist_free(dists[d]);
+    }
 
+    BMK_perf_free();
     return 0;
 }
@@ -114,10 +114,15 @@ BMK_runOutcome_t BMK_benchFunction(BMK_benchParams_t p,
     }   }
 
     /* benchmark */
-    {   UTIL_time_t const clockStart = UTIL_getTime();
+    {   int const withCounters = BMK_perf_isEnabled();
+        BMK_perfSnapshot_t perfStart;
+        UTIL_time_t clockStart;
         size_t dstSize = 0;
         unsigned loopNb, blockNb;
         nbLoops += !nbLoops;   /* minimum nbLoops is 1 */
+        memset(&perfStart, 0, sizeof(perfStart));
+        if (withCounters) perfStart = BMK_perf_read();
+        clockStart = UTIL_getTime();
         if (p.initFn != NULL) p.initFn(p.initPayload);
         for (loopNb = 0; loopNb < nbLoops; loopNb++) {
             for (blockNb = 0; blockNb < p.blockCount; blockNb++) {
@@ -137,8 +142,10 @@ BMK_runOutcome_t BMK_benchFunction(BMK_benchParams_t p,
 
         {   PTime const totalTime = UTIL_clockSpanNano(clockStart);
             BMK_runTime_t rt;
+            memset(&rt, 0, sizeof(rt));
             rt.nanoSecPerRun = (double)totalTime / nbLoops;
             rt.sumOfReturn = dstSize;
+            if (withCounters) rt.counters = BMK_perf_diff(perfStart, BMK_perf_read(), nbLoops);
             return BMK_setValid_runTime(rt);
     }   }
 }
@@ -187,6 +194,7 @@ void BMK_resetTimedFnState(BMK_timedFnState_t* timedFnState, unsigned total_ms,
     timedFnState->timeSpent_ns = 0;
     timedFnState->timeBudget_ns = (PTime)total_ms * TIMELOOP_NANOSEC / 1000;
     timedFnState->runBudget_ns = (PTime)run_ms * TIMELOOP_NANOSEC / 1000;
+    memset(&timedFnState->fastestRun, 0, sizeof(timedFnState->fastestRun));
     timedFnState->fastestRun.nanoSecPerRun = (double)TIMELOOP_NANOSEC * 2000000000;  /* hopefully large enough : must be larger than any potential measurement */
     timedFnState->fastestRun.sumOfReturn = (size_t)(-1LL);
     timedFnState->nbLoops = 1;
@@ -24,6 +24,7 @@ extern "C" {
 
 /* ===  Dependencies  === */
 #include <stddef.h>   /* size_t */
+#include "perfcounters.h"   /* BMK_perfCounts_t */
 
 
 /* ====  Benchmark any function, iterated on a set of blocks  ==== */
@@ -33,6 +34,7 @@ extern "C" {
 typedef struct {
     double nanoSecPerRun;  /* time per iteration (over all blocks) */
     size_t sumOfReturn;         /* sum of return values */
+    BMK_perfCounts_t counters;  /* hardware counters per iteration, when BMK_perf_init() succeeded */
 } BMK_runTime_t;
 
 
@@ -99,6 +101,8 @@ typedef struct {
  *          it will contain :
  *              .sumOfReturn : the sum of all return values of benchFn through all of blocks
  *              .nanoSecPerRun : time per run of benchFn + (time for initFn / nbLoops)
+ *              .counters : hardware counters per run, measured over the same interval;
+ *                          .validMask is 0 when counters are not enabled.
  *          .sumOfReturn is generally intended for functions which return a # of bytes written into dstBuffer,
  *              in which case, this value will be the total amount of bytes written into dstBuffer.
  *
@@ -168,7 +172,7 @@ void BMK_freeTimedFnState(BMK_timedFnState_t* state);
  * It will check if provided buffer is large enough and is correctly aligned,
  * and will return NULL if conditions are not respected.
  */
-#define BMK_TIMEDFNSTATE_SIZE 64
+#define BMK_TIMEDFNSTATE_SIZE 192
 typedef union {
     char never_access_space[BMK_TIMEDFNSTATE_SIZE];
     long long alignment_enforcer;  /* must be aligned on 8-bytes boundaries */
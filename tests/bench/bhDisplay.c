@@ -29,12 +29,55 @@
 
 #include <stdlib.h>   /* rand */
 #include <stdio.h>    /* printf */
+#include <string.h>   /* memcpy */
 #include <assert.h>
 
 #include "benchHash.h"
 #include "bhDisplay.h"
 
 
+/* ===  hardware counters  === */
+
+/* @return: NULL when counters are not enabled, otherwise an array of nb entries */
+static BMK_perfCounts_t* counters_create(size_t nb)
+{
+    if (!BMK_perf_isEnabled()) return NULL;
+    return (BMK_perfCounts_t*)calloc(nb, sizeof(BMK_perfCounts_t));
+}
+
+/* stores counters of one hash, normalized per byte */
+static void counters_store(BMK_perfCounts_t* table, size_t n, BMK_perfCounts_t perHash, double bytesPerHash)
+{
+    if (table == NULL) return;
+    for (int c = 0; c < BMK_PERF_NB_COUNTERS; c++)
+        perHash.count[c] /= bytesPerHash;
+    table[n] = perHash;
+}
+
+/* displays one row per counter, below the throughput row of the same hash */
+static void counters_display(const char* name, BMK_perfCounts_t* table, size_t nb)
+{
+    unsigned const ipcMask = (1U << BMK_PERF_CYCLES) | (1U << BMK_PERF_INSTRUCTIONS);
+    if (table == NULL) return;
+    for (int c = 0; c < BMK_PERF_NB_COUNTERS; c++) {
+        printf("%s %s/B", name, BMK_perf_name((BMK_perfCounter_e)c));
+        for (size_t n = 0; n < nb; n++) {
+            if (table[n].validMask & (1U << c)) printf(",%8.4f", table[n].count[c]);
+            else printf(",     n/a");
+        }
+        printf("\n");
+    }
+    printf("%s IPC", name);
+    for (size_t n = 0; n < nb; n++) {
+        if (((table[n].validMask & ipcMask) == ipcMask) && (table[n].count[BMK_PERF_CYCLES] > 0))
+            printf(",%8.2f", table[n].count[BMK_PERF_INSTRUCTIONS] / table[n].count[BMK_PERF_CYCLES]);
+        else printf(",     n/a");
+    }
+    printf("\n");
+    free(table);
+}
+
+
 /* ===  benchmark large input  === */
 
 #define MB_UNIT           1000000
@@ -42,15 +85,20 @@
 #define BENCH_LARGE_TOTAL_MS 1010
 static void bench_oneHash_largeInput(Bench_Entry hashDesc, int minlog, int maxlog)
 {
+    BMK_perfCounts_t* const counters = counters_create((size_t)(maxlog - minlog + 1));
     printf("%-7s", hashDesc.name);
     for (int sizelog=minlog; sizelog<=maxlog; sizelog++) {
         size_t const inputSize = (size_t)1 << sizelog;
+        BMK_perfCounts_t perHash;
         double const nbhps = bench_hash(hashDesc.hash, BMK_throughput,
                                         inputSize, BMK_fixedSize,
-                                        BENCH_LARGE_TOTAL_MS, BENCH_LARGE_ITER_MS);
+                                        BENCH_LARGE_TOTAL_MS, BENCH_LARGE_ITER_MS,
+                                        &perHash);
+        counters_store(counters, (size_t)(sizelog - minlog), perHash, (double)inputSize);
         printf(",%6.0f", nbhps * inputSize / MB_UNIT); fflush(NULL);
     }
     printf("\n");
+    counters_display(hashDesc.name, counters, (size_t)(maxlog - minlog + 1));
 }
 
 void bench_largeInput(Bench_Entry const* hashDescTable, int nbHashes, int minlog, int maxlog)
@@ -72,14 +120,19 @@ void bench_largeInput(Bench_Entry const* hashDescTable, int nbHashes, int minlog
 #define BENCH_SMALL_TOTAL_MS  490
 static void bench_throughput_oneHash_smallInputs(Bench_Entry hashDesc, size_t sizeMin, size_t sizeMax)
 {
+    BMK_perfCounts_t* const counters = counters_create(sizeMax + 1 - sizeMin);
     printf("%-7s", hashDesc.name);
     for (size_t s=sizeMin; s<sizeMax+1; s++) {
+        BMK_perfCounts_t perHash;
         double const nbhps = bench_hash(hashDesc.hash, BMK_throughput,
                                         s, BMK_fixedSize,
-                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS);
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, s - sizeMin, perHash, (double)s);
         printf(",%10.0f", nbhps); fflush(NULL);
     }
     printf("\n");
+    counters_display(hashDesc.name, counters, sizeMax + 1 - sizeMin);
 }
 
 void bench_throughput_smallInputs(Bench_Entry const* hashDescTable, int nbHashes, size_t sizeMin, size_t sizeMax)
@@ -96,14 +149,19 @@ void bench_throughput_smallInputs(Bench_Entry const* hashDescTable, int nbHashes
 
 static void bench_latency_oneHash_smallInputs(Bench_Entry hashDesc, size_t size_min, size_t size_max)
 {
+    BMK_perfCounts_t* const counters = counters_create(size_max + 1 - size_min);
     printf("%-7s", hashDesc.name);
     for (size_t s=size_min; s<size_max+1; s++) {
+        BMK_perfCounts_t perHash;
         double const nbhps = bench_hash(hashDesc.hash, BMK_latency,
                                         s, BMK_fixedSize,
-                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS);
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, s - size_min, perHash, (double)s);
         printf(",%10.0f", nbhps); fflush(NULL);
     }
     printf("\n");
+    counters_display(hashDesc.name, counters, size_max + 1 - size_min);
 }
 
 void bench_latency_smallInputs(Bench_Entry const* hashDescTable, int nbHashes, size_t size_min, size_t size_max)
@@ -118,15 +176,20 @@ void bench_latency_smallInputs(Bench_Entry const* hashDescTable, int nbHashes, s
 
 static void bench_randomInputLength_withOneHash(Bench_Entry hashDesc, size_t size_min, size_t size_max)
 {
+    BMK_perfCounts_t* const counters = counters_create(size_max + 1 - size_min);
     printf("%-7s", hashDesc.name);
     for (size_t s=size_min; s<size_max+1; s++) {
+        BMK_perfCounts_t perHash;
         srand((unsigned)s);   /* ensure random sequence of length will be the same for a given s */
         double const nbhps = bench_hash(hashDesc.hash, BMK_throughput,
                                         s, BMK_randomSize,
-                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS);
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, s - size_min, perHash, (double)(s+1) / 2);
         printf(",%10.0f", nbhps); fflush(NULL);
     }
     printf("\n");
+    counters_display(hashDesc.name, counters, size_max + 1 - size_min);
 }
 
 void bench_throughput_randomInputLength(Bench_Entry const* hashDescTable, int nbHashes, size_t size_min, size_t size_max)
@@ -141,15 +204,20 @@ void bench_throughput_randomInputLength(Bench_Entry const* hashDescTable, int nb
 
 static void bench_latency_oneHash_randomInputLength(Bench_Entry hashDesc, size_t size_min, size_t size_max)
 {
+    BMK_perfCounts_t* const counters = counters_create(size_max + 1 - size_min);
     printf("%-7s", hashDesc.name);
     for (size_t s=size_min; s<size_max+1; s++) {
+        BMK_perfCounts_t perHash;
         srand((unsigned)s);   /* ensure random sequence of length will be the same for a given s */
         double const nbhps = bench_hash(hashDesc.hash, BMK_latency,
                                         s, BMK_randomSize,
-                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS);
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, s - size_min, perHash, (double)(s+1) / 2);
         printf(",%10.0f", nbhps); fflush(NULL);
     }
     printf("\n");
+    counters_display(hashDesc.name, counters, size_max + 1 - size_min);
 }
 
 void bench_latency_randomInputLength(Bench_Entry const* hashDescTable, int nbHashes, size_t size_min, size_t size_max)
@@ -158,3 +226,123 @@ void bench_latency_randomInputLength(Bench_Entry const* hashDescTable, int nbHas
     for (int i=0; i<nbHashes; i++)
         bench_latency_oneHash_randomInputLength(hashDescTable[i], size_min, size_max);
 }
+
+
+/* ===   Working set sweep   === */
+
+/* informative baseline : same key walk as the hashes, copying each key */
+static size_t baseline_memcpy(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload)
+{
+    (void)customPayload;
+    assert(dstCapacity >= srcSize);
+    memcpy(dst, src, srcSize);
+    return ((const unsigned char*)dst)[srcSize-1];
+}
+
+#define BENCH_WS_ITER_MS   170
+#define BENCH_WS_TOTAL_MS  490
+/* @return: MB/s of key bytes, for each working set size, stored into `speeds` */
+static void bench_workingSet_oneHash(Bench_Entry hashDesc, size_t keySize,
+                                     int wsLogMin, int wsLogMax, BMK_wsOrder order,
+                                     double* speeds)
+{
+    BMK_perfCounts_t* const counters = counters_create((size_t)(wsLogMax - wsLogMin + 1));
+    printf("%-7s", hashDesc.name);
+    for (int wsLog = wsLogMin; wsLog <= wsLogMax; wsLog++) {
+        BMK_perfCounts_t perHash;
+        double const nbhps = bench_hash_workingSet(hashDesc.hash,
+                                        keySize, (size_t)1 << wsLog, order,
+                                        BENCH_WS_TOTAL_MS, BENCH_WS_ITER_MS,
+                                        &perHash);
+        counters_store(counters, (size_t)(wsLog - wsLogMin), perHash, (double)keySize);
+        speeds[wsLog - wsLogMin] = nbhps * keySize / MB_UNIT;
+        printf(",%8.0f", speeds[wsLog - wsLogMin]); fflush(NULL);
+    }
+    printf("\n");
+    counters_display(hashDesc.name, counters, (size_t)(wsLogMax - wsLogMin + 1));
+}
+
+void bench_workingSet(Bench_Entry const* hashDescTable, int nbHashes, size_t keySize,
+                      int wsLogMin, int wsLogMax, BMK_wsOrder order)
+{
+    /* hash == NULL : bench_hash_workingSet() only touches each cache line of each key */
+    static Bench_Entry const touch = { "touch", NULL };
+    static Bench_Entry const copy = { "memcpy", baseline_memcpy };
+    int const nbSizes = wsLogMax - wsLogMin + 1;
+    double* const bound = (double*)calloc((size_t)nbSizes, sizeof(double));
+    double* const touchAfter = (double*)calloc((size_t)nbSizes, sizeof(double));
+    double* const speeds = (double*)calloc((size_t)nbSizes * (size_t)(nbHashes + 1), sizeof(double));
+    assert(wsLogMin >= 0);
+    assert(wsLogMax <  40);
+    assert(bound != NULL && touchAfter != NULL && speeds != NULL);
+
+    printf("Working set sweep : %zu-byte keys, %s order, MB/s of key bytes and %% of touch baseline \n",
+            keySize, (order == BMK_pointerChase) ? "pointer-chasing" : "sequential");
+    printf("%-7s", "wsLog");
+    for (int wsLog = wsLogMin; wsLog <= wsLogMax; wsLog++) printf(",%8i", wsLog);
+    printf("\n");
+
+    /* touch runs before and after the hashes, the fastest run is the bound */
+    bench_workingSet_oneHash(touch, keySize, wsLogMin, wsLogMax, order, bound);
+    bench_workingSet_oneHash(copy, keySize, wsLogMin, wsLogMax, order, speeds + (size_t)nbHashes * (size_t)nbSizes);
+    for (int i=0; i<nbHashes; i++)
+        bench_workingSet_oneHash(hashDescTable[i], keySize, wsLogMin, wsLogMax, order, speeds + (size_t)i * (size_t)nbSizes);
+    bench_workingSet_oneHash(touch, keySize, wsLogMin, wsLogMax, order, touchAfter);
+    for (int n = 0; n < nbSizes; n++)
+        if (touchAfter[n] > bound[n]) bound[n] = touchAfter[n];
+
+    for (int i=0; i<nbHashes; i++) {
+        const double* const hashSpeeds = speeds + (size_t)i * (size_t)nbSizes;
+        int beaten = 0;
+        printf("%s %%", hashDescTable[i].name);
+        for (int n = 0; n < nbSizes; n++) {
+            printf(",%7.1f%%", 100. * hashSpeeds[n] / bound[n]);
+            beaten |= (hashSpeeds[n] > bound[n]);
+        }
+        printf("\n");
+        if (beaten)
+            printf("warning : %s is faster than the touch baseline, results are unreliable (noisy host ?) \n",
+                    hashDescTable[i].name);
+    }
+
+    free(speeds);
+    free(touchAfter);
+    free(bound);
+}
+
+
+/* ===   Key length distributions   === */
+
+/* long enough that branch predictors can't learn the sequence of lengths */
+#define DIST_NB_LENGTHS  16384
+#define DIST_SEED        0x1F2E3D4C5B6A7988ULL
+
+void bench_lengthDistribution(Bench_Entry const* hashDescTable, int nbHashes, const BMK_lengthDist* dist)
+{
+    size_t* const lengths = (size_t*)malloc(DIST_NB_LENGTHS * sizeof(*lengths));
+    const char* const tag = BMK_lengthDist_name(dist);
+    double const mean = BMK_lengthDist_mean(dist);
+    assert(lengths != NULL);
+    BMK_lengthDist_generate(dist, lengths, DIST_NB_LENGTHS, DIST_SEED);
+
+    printf("Key lengths drawn from %s (mean %.1f bytes) : hashes/s in throughput and latency modes \n", tag, mean);
+    for (int i=0; i<nbHashes; i++) {
+        BMK_perfCounts_t* const counters = counters_create(2);
+        BMK_perfCounts_t perHash;
+        printf("%-7s,%s", hashDescTable[i].name, tag);
+        double const nbhps = bench_hash_lengths(hashDescTable[i].hash, BMK_throughput,
+                                        lengths, DIST_NB_LENGTHS,
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, 0, perHash, mean);
+        printf(",%10.0f", nbhps); fflush(NULL);
+        double const nbhpsLatency = bench_hash_lengths(hashDescTable[i].hash, BMK_latency,
+                                        lengths, DIST_NB_LENGTHS,
+                                        BENCH_SMALL_TOTAL_MS, BENCH_SMALL_ITER_MS,
+                                        &perHash);
+        counters_store(counters, 1, perHash, mean);
+        printf(",%10.0f\n", nbhpsLatency);
+        counters_display(hashDescTable[i].name, counters, 2);
+    }
+    free(lengths);
+}
@@ -34,7 +34,9 @@ extern "C" {
 
 /* ===  Dependencies  === */
 
-#include "benchfn.h"   /* BMK_benchFn_t */
+#include "benchfn.h"     /* BMK_benchFn_t */
+#include "benchHash.h"   /* BMK_wsOrder */
+#include "keyLengths.h"  /* BMK_lengthDist */
 
 
 /* ===  Declarations  === */
@@ -52,6 +54,15 @@ void bench_throughput_randomInputLength(Bench_Entry const* hashDescTable, int nb
 void bench_latency_smallInputs(Bench_Entry const* hashDescTable, int nbHashes, size_t sizeMin, size_t sizeMax);
 void bench_latency_randomInputLength(Bench_Entry const* hashDescTable, int nbHashes, size_t sizeMin, size_t sizeMax);
 
+/* each hash reads a different key from a working set of 2^wsLog bytes,
+ * compared with reading and copying the same keys in the same order */
+void bench_workingSet(Bench_Entry const* hashDescTable, int nbHashes, size_t keySize,
+                      int wsLogMin, int wsLogMax, BMK_wsOrder order);
+
+/* throughput and latency for key lengths drawn from `dist`,
+ * each result row is tagged with the distribution's name */
+void bench_lengthDistribution(Bench_Entry const* hashDescTable, int nbHashes, const BMK_lengthDist* dist);
+
 
 
 #if defined (__cplusplus)
@@ -0,0 +1,58 @@
+/*
+*  XXH3 entry points for one XXH_VECTOR variant, compiled once per variant
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+#ifndef BH_KERNEL
+#  error "BH_KERNEL must be defined : this file is compiled once per XXH_VECTOR variant, see Makefile"
+#endif
+
+
+/* ===  Dependencies  === */
+
+#define XXH_INLINE_ALL   /* all symbols are static : variants can be linked together */
+#include "xxhash.h"
+#include "bhKernels.h"
+
+
+/* ===  Entry points  === */
+
+#define BH_CAT3_(a, b, c) a##b##c
+#define BH_CAT3(a, b, c)  BH_CAT3_(a, b, c)
+#define BH_FN(f)          BH_CAT3(bhKernel_, BH_KERNEL, f)
+
+size_t BH_FN(_XXH3_64b)(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload)
+{
+    (void)dst; (void)dstCapacity; (void)customPayload;
+    return (size_t) XXH3_64bits(src, srcSize);
+}
+
+size_t BH_FN(_XXH3_128b)(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload)
+{
+    (void)dst; (void)dstCapacity; (void)customPayload;
+    return (size_t) XXH3_128bits(src, srcSize).low64;
+}
+
+int BH_FN(_vector)(void) { return XXH_VECTOR; }
@@ -0,0 +1,65 @@
+/*
+*  XXH3 kernels built for one XXH_VECTOR variant each
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+#ifndef BH_KERNELS_H_302871
+#define BH_KERNELS_H_302871
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+
+/* ===  Dependencies  === */
+
+#include <stddef.h>   /* size_t */
+
+
+/* ===  Declarations  === */
+
+/* bhKernel.c is compiled once per XXH_VECTOR variant (see Makefile),
+ * with -DBH_KERNEL=name, producing bhKernel_name_XXH3_64b() and bhKernel_name_XXH3_128b().
+ * Each object is built with XXH_INLINE_ALL, so variants don't share any symbol.
+ * Only variants listed in the Makefile for the target architecture are linked. */
+#define BH_DECLARE_KERNEL(k)                                                                 \
+    size_t bhKernel_##k##_XXH3_64b(const void* src, size_t srcSize,                          \
+                                   void* dst, size_t dstCapacity, void* customPayload);      \
+    size_t bhKernel_##k##_XXH3_128b(const void* src, size_t srcSize,                         \
+                                    void* dst, size_t dstCapacity, void* customPayload);     \
+    int bhKernel_##k##_vector(void);   /* XXH_VECTOR value actually compiled */
+
+BH_DECLARE_KERNEL(scalar)
+BH_DECLARE_KERNEL(sse2)
+BH_DECLARE_KERNEL(avx2)
+BH_DECLARE_KERNEL(avx512)
+BH_DECLARE_KERNEL(neon)
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif   /* BH_KERNELS_H_302871 */
@@ -0,0 +1,227 @@
+/*
+*  Key length distributions for the hash benchmark program
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+
+/* ===  Dependencies  === */
+
+#include <stdlib.h>   /* malloc, strtod, strtoul */
+#include <stdio.h>    /* fopen, snprintf */
+#include <string.h>   /* strncmp */
+#include <math.h>     /* pow */
+
+#include "keyLengths.h"
+
+
+/* ===  Distributions  === */
+
+struct BMK_lengthDist_s {
+    char name[64];
+    size_t nbEntries;
+    size_t* lengths;   /* nbEntries lengths */
+    double* cdf;       /* cumulative probabilities, cdf[nbEntries-1] == 1.0 */
+    double mean;
+};
+
+void BMK_lengthDist_free(BMK_lengthDist* dist)
+{
+    if (dist == NULL) return;
+    free(dist->lengths);
+    free(dist->cdf);
+    free(dist);
+}
+
+static BMK_lengthDist* BMK_lengthDist_alloc(size_t nbEntries)
+{
+    BMK_lengthDist* const dist = (BMK_lengthDist*)calloc(1, sizeof(*dist));
+    if (dist == NULL) return NULL;
+    dist->nbEntries = nbEntries;
+    dist->lengths = (size_t*)calloc(nbEntries, sizeof(*dist->lengths));
+    dist->cdf = (double*)calloc(nbEntries, sizeof(*dist->cdf));
+    if (dist->lengths == NULL || dist->cdf == NULL) {
+        BMK_lengthDist_free(dist);
+        return NULL;
+    }
+    return dist;
+}
+
+/* turns weights stored into cdf[] into cumulative probabilities.
+ * @return 0 on success, 1 if total weight is null */
+static int BMK_lengthDist_normalize(BMK_lengthDist* dist)
+{
+    double total = 0, cumul = 0, mean = 0;
+    for (size_t n = 0; n < dist->nbEntries; n++) total += dist->cdf[n];
+    if (!(total > 0)) return 1;
+    for (size_t n = 0; n < dist->nbEntries; n++) {
+        mean += (double)dist->lengths[n] * dist->cdf[n] / total;
+        cumul += dist->cdf[n];
+        dist->cdf[n] = cumul / total;
+    }
+    dist->cdf[dist->nbEntries - 1] = 1.0;   /* absorb rounding errors */
+    dist->mean = mean;
+    return 0;
+}
+
+/* weights : 1 / len^s, on [1-maxLength] */
+static BMK_lengthDist* BMK_lengthDist_zipf(double s, size_t maxLength)
+{
+    BMK_lengthDist* const dist = BMK_lengthDist_alloc(maxLength);
+    if (dist == NULL) return NULL;
+    for (size_t n = 0; n < maxLength; n++) {
+        dist->lengths[n] = n + 1;
+        dist->cdf[n] = 1.0 / pow((double)(n + 1), s);
+    }
+    return dist;
+}
+
+static BMK_lengthDist* BMK_lengthDist_bimodal(size_t lenA, size_t lenB, double percentA)
+{
+    BMK_lengthDist* const dist = BMK_lengthDist_alloc(2);
+    if (dist == NULL) return NULL;
+    dist->lengths[0] = lenA; dist->cdf[0] = percentA;
+    dist->lengths[1] = lenB; dist->cdf[1] = 100. - percentA;
+    return dist;
+}
+
+#define HISTOGRAM_ENTRIES_MAX 65536
+static BMK_lengthDist* BMK_lengthDist_loadFile(const char* path, const char** errorMsg)
+{
+    FILE* const f = fopen(path, "r");
+    BMK_lengthDist* dist;
+    const char* error = NULL;
+    size_t nb = 0;
+    char line[256];
+
+    if (f == NULL) { *errorMsg = "cannot open histogram file"; return NULL; }
+    dist = BMK_lengthDist_alloc(HISTOGRAM_ENTRIES_MAX);
+    if (dist == NULL) { fclose(f); *errorMsg = "not enough memory"; return NULL; }
+
+    while ((error == NULL) && (fgets(line, sizeof(line), f) != NULL)) {
+        char* p = line;
+        char* end;
+        unsigned long length;
+        double weight;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0) continue;
+        length = strtoul(p, &end, 10);
+        if (end == p) { error = "histogram line does not start with a length"; continue; }
+        p = end;
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        weight = strtod(p, &end);
+        if (end == p || weight < 0) { error = "histogram line without a valid weight"; continue; }
+        if (length == 0 || weight == 0) continue;
+        if (nb == HISTOGRAM_ENTRIES_MAX) { error = "too many histogram lines"; continue; }
+        dist->lengths[nb] = (size_t)length;
+        dist->cdf[nb] = weight;
+        nb++;
+    }
+    fclose(f);
+    if ((error == NULL) && (nb == 0)) error = "empty histogram";
+    if (error != NULL) {
+        *errorMsg = error;
+        BMK_lengthDist_free(dist);
+        return NULL;
+    }
+    dist->nbEntries = nb;
+    return dist;
+}
+
+BMK_lengthDist* BMK_lengthDist_create(const char* spec, size_t maxLength, const char** errorMsg)
+{
+    const char* dummy;
+    BMK_lengthDist* dist = NULL;
+    if (errorMsg == NULL) errorMsg = &dummy;
+    *errorMsg = "unknown distribution";
+    if (maxLength == 0) maxLength = 1;
+
+    if (!strcmp(spec, "uniform")) {
+        dist = BMK_lengthDist_zipf(0., maxLength);
+        if (dist) snprintf(dist->name, sizeof(dist->name), "uniform[1-%zu]", maxLength);
+    } else if (!strncmp(spec, "zipf", 4) && (spec[4] == 0 || spec[4] == ':')) {
+        double const s = spec[4] ? strtod(spec + 5, NULL) : 1.0;
+        if (!(s > 0)) { *errorMsg = "zipf exponent must be > 0"; return NULL; }
+        dist = BMK_lengthDist_zipf(s, maxLength);
+        if (dist) snprintf(dist->name, sizeof(dist->name), "zipf:%.2f[1-%zu]", s, maxLength);
+    } else if (!strncmp(spec, "bimodal:", 8)) {
+        char* p;
+        unsigned long const lenA = strtoul(spec + 8, &p, 10);
+        unsigned long lenB;
+        double percentA = 50.;
+        if (*p != ',') { *errorMsg = "bimodal expects 2 lengths : bimodal:A,B[,P]"; return NULL; }
+        lenB = strtoul(p + 1, &p, 10);
+        if (*p == ',') percentA = strtod(p + 1, NULL);
+        if (lenA == 0 || lenB == 0) { *errorMsg = "bimodal lengths must be > 0"; return NULL; }
+        if (!(percentA >= 0 && percentA <= 100)) { *errorMsg = "bimodal probability must be within [0-100]"; return NULL; }
+        dist = BMK_lengthDist_bimodal((size_t)lenA, (size_t)lenB, percentA);
+        if (dist) snprintf(dist->name, sizeof(dist->name), "bimodal:%lu,%lu,%.0f%%", lenA, lenB, percentA);
+    } else if (!strncmp(spec, "file:", 5)) {
+        const char* const base = strrchr(spec + 5, '/');
+        dist = BMK_lengthDist_loadFile(spec + 5, errorMsg);
+        if (dist == NULL) return NULL;
+        snprintf(dist->name, sizeof(dist->name), "file:%s", base ? base + 1 : spec + 5);
+    } else {
+        return NULL;
+    }
+
+    if (dist == NULL) { *errorMsg = "not enough memory"; return NULL; }
+    if (BMK_lengthDist_normalize(dist)) {
+        *errorMsg = "distribution has no weight";
+        BMK_lengthDist_free(dist);
+        return NULL;
+    }
+    return dist;
+}
+
+const char* BMK_lengthDist_name(const BMK_lengthDist* dist) { return dist->name; }
+
+double BMK_lengthDist_mean(const BMK_lengthDist* dist) { return dist->mean; }
+
+
+/* ===  Generation  === */
+
+/* splitmix64 : fast, and good enough to be unpredictable for branch predictors */
+static unsigned long long BMK_nextRandom(unsigned long long* state)
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void BMK_lengthDist_generate(const BMK_lengthDist* dist, size_t* lengths, size_t nb, unsigned long long seed)
+{
+    unsigned long long state = seed;
+    for (size_t i = 0; i < nb; i++) {
+        double const u = (double)(BMK_nextRandom(&state) >> 11) * (1.0 / 9007199254740992.0);   /* [0,1) */
+        /* first entry with cdf > u */
+        size_t lo = 0, hi = dist->nbEntries - 1;
+        while (lo < hi) {
+            size_t const mid = (lo + hi) / 2;
+            if (dist->cdf[mid] > u) hi = mid; else lo = mid + 1;
+        }
+        lengths[i] = dist->lengths[lo];
+    }
+}
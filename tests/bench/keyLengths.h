@@ -0,0 +1,71 @@
+/*
+*  Key length distributions for the hash benchmark program
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+#ifndef KEY_LENGTHS_H_718203
+#define KEY_LENGTHS_H_718203
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+
+/* ===  Dependencies  === */
+
+#include <stddef.h>   /* size_t */
+
+
+/* ===  Declarations  === */
+
+/* A distribution of key lengths, drawn from its cumulative histogram.
+ * Supported specifications :
+ *   uniform            : every length in [1-maxLength] is equally likely
+ *   zipf[:S]           : P(len) ~ 1 / len^S, on [1-maxLength] (default S = 1.0)
+ *   bimodal:A,B[,P]    : length A with probability P% (default 50), length B otherwise
+ *   file:PATH          : histogram read from PATH, one "length weight" pair per line,
+ *                        '#' starts a comment
+ */
+typedef struct BMK_lengthDist_s BMK_lengthDist;
+
+/* @return : NULL on error, with a short reason in *errorMsg (if not NULL) */
+BMK_lengthDist* BMK_lengthDist_create(const char* spec, size_t maxLength, const char** errorMsg);
+void BMK_lengthDist_free(BMK_lengthDist* dist);
+
+/* tag identifying the distribution in results, such as "zipf:1.00[1-127]" */
+const char* BMK_lengthDist_name(const BMK_lengthDist* dist);
+double BMK_lengthDist_mean(const BMK_lengthDist* dist);
+
+/* BMK_lengthDist_generate() :
+ * Fills lengths[0..nb-1] with lengths drawn from dist.
+ * Uses its own PRNG : a given seed always generates the same sequence. */
+void BMK_lengthDist_generate(const BMK_lengthDist* dist, size_t* lengths, size_t nb, unsigned long long seed);
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif   /* KEY_LENGTHS_H_718203 */
@@ -0,0 +1,189 @@
+/*
+*  Hardware performance counters for the hash benchmark program
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+
+/* ===  Dependencies  === */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* syscall() */
+#endif
+
+#include <string.h>   /* memset */
+#include "perfcounters.h"
+
+
+static const char* const g_perfNames[BMK_PERF_NB_COUNTERS] = {
+    "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses", "uops"
+};
+
+const char* BMK_perf_name(BMK_perfCounter_e counter)
+{
+    if ((unsigned)counter >= BMK_PERF_NB_COUNTERS) return "unknown";
+    return g_perfNames[counter];
+}
+
+BMK_perfCounts_t BMK_perf_diff(BMK_perfSnapshot_t start, BMK_perfSnapshot_t end, double divisor)
+{
+    BMK_perfCounts_t r;
+    memset(&r, 0, sizeof(r));
+    if (divisor <= 0) divisor = 1;
+    for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++) {
+        unsigned long long const enabled = end.enabled[n] - start.enabled[n];
+        unsigned long long const running = end.running[n] - start.running[n];
+        double count = (double)(end.value[n] - start.value[n]);
+        if (running == 0) continue;   /* not available, or never scheduled */
+        if (running < enabled) count *= (double)enabled / (double)running;   /* multiplexed */
+        r.count[n] = count / divisor;
+        r.validMask |= 1U << n;
+    }
+    return r;
+}
+
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <unistd.h>             /* syscall, read, close */
+#include <sys/syscall.h>        /* __NR_perf_event_open */
+#include <linux/perf_event.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  include <cpuid.h>            /* __get_cpuid */
+#endif
+
+static int g_perfFds[BMK_PERF_NB_COUNTERS] = { -1, -1, -1, -1, -1, -1 };
+static int g_perfEnabled = 0;
+
+/* There is no generic uops event : use the vendor's raw encoding, when known.
+ * @return 0 when unknown */
+static unsigned long long BMK_perf_uopsConfig(void)
+{
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+        if (ebx == 0x756e6547 /* "Genu" */ && edx == 0x49656e69 /* "ineI" */)
+            return 0x010E;   /* UOPS_ISSUED.ANY */
+        if (ebx == 0x68747541 /* "Auth" */ && edx == 0x69746e65 /* "enti" */)
+            return 0x00C1;   /* EX_RET_OPS : retired macro-ops */
+    }
+#endif
+    return 0;
+}
+
+static int BMK_perf_open(unsigned type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    /* user space only : allowed up to perf_event_paranoid == 2 */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1 /* no group */, 0);
+}
+
+int BMK_perf_init(const char** errorMsg)
+{
+    unsigned long long const uops = BMK_perf_uopsConfig();
+    int nbOpened = 0;
+    int firstErrno = 0;
+
+    BMK_perf_free();
+    g_perfFds[BMK_PERF_CYCLES]        = BMK_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    if (g_perfFds[BMK_PERF_CYCLES] < 0) firstErrno = errno;
+    g_perfFds[BMK_PERF_INSTRUCTIONS]  = BMK_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    g_perfFds[BMK_PERF_BRANCH_MISSES] = BMK_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    g_perfFds[BMK_PERF_L1D_MISSES]    = BMK_perf_open(PERF_TYPE_HW_CACHE,
+                                            PERF_COUNT_HW_CACHE_L1D
+                                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    g_perfFds[BMK_PERF_LLC_MISSES]    = BMK_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    g_perfFds[BMK_PERF_UOPS]          = uops ? BMK_perf_open(PERF_TYPE_RAW, uops) : -1;
+
+    for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++)
+        nbOpened += (g_perfFds[n] >= 0);
+    g_perfEnabled = (nbOpened > 0);
+
+    if (!g_perfEnabled && errorMsg != NULL) {
+        switch (firstErrno) {
+        case EACCES:
+        case EPERM:  *errorMsg = "access denied (see /proc/sys/kernel/perf_event_paranoid)"; break;
+        case ENOSYS: *errorMsg = "perf_event_open() not supported by this kernel"; break;
+        case ENOENT:
+        case EOPNOTSUPP: *errorMsg = "no hardware counter exposed (virtual machine ?)"; break;
+        default:     *errorMsg = "perf_event_open() failed"; break;
+    }   }
+    return nbOpened;
+}
+
+void BMK_perf_free(void)
+{
+    for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++) {
+        if (g_perfFds[n] >= 0) close(g_perfFds[n]);
+        g_perfFds[n] = -1;
+    }
+    g_perfEnabled = 0;
+}
+
+int BMK_perf_isEnabled(void) { return g_perfEnabled; }
+
+BMK_perfSnapshot_t BMK_perf_read(void)
+{
+    BMK_perfSnapshot_t s;
+    memset(&s, 0, sizeof(s));
+    for (int n = 0; n < BMK_PERF_NB_COUNTERS; n++) {
+        unsigned long long buf[3];   /* value, time_enabled, time_running */
+        if (g_perfFds[n] < 0) continue;
+        if (read(g_perfFds[n], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) continue;
+        s.value[n] = buf[0];
+        s.enabled[n] = buf[1];
+        s.running[n] = buf[2];
+    }
+    return s;
+}
+
+#else   /* !__linux__ */
+
+int BMK_perf_init(const char** errorMsg)
+{
+    if (errorMsg != NULL) *errorMsg = "hardware counters are only supported on Linux";
+    return 0;
+}
+
+void BMK_perf_free(void) {}
+
+int BMK_perf_isEnabled(void) { return 0; }
+
+BMK_perfSnapshot_t BMK_perf_read(void)
+{
+    BMK_perfSnapshot_t s;
+    memset(&s, 0, sizeof(s));
+    return s;
+}
+
+#endif   /* __linux__ */
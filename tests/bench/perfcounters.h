@@ -0,0 +1,89 @@
+/*
+*  Hardware performance counters for the hash benchmark program
+*  Part of the xxHash project
+*  Copyright (C) 2019-2021 Yann Collet
+*
+*  GPL v2 License
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License along
+*  with this program; if not, write to the Free Software Foundation, Inc.,
+*  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*
+*  You can contact the author at:
+*  - xxHash homepage: https://www.xxhash.com
+*  - xxHash source repository: https://github.com/Cyan4973/xxHash
+*/
+
+
+#ifndef PERF_COUNTERS_H_540917
+#define PERF_COUNTERS_H_540917
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+
+/* ===  Declarations  === */
+
+/* Counters collected around each benchmark run.
+ * Only Linux (perf_event_open) is supported;
+ * on other systems, or when the kernel refuses access
+ * (containers, /proc/sys/kernel/perf_event_paranoid),
+ * no counter is available and benchmarks run as usual. */
+typedef enum {
+    BMK_PERF_CYCLES,
+    BMK_PERF_INSTRUCTIONS,
+    BMK_PERF_BRANCH_MISSES,
+    BMK_PERF_L1D_MISSES,
+    BMK_PERF_LLC_MISSES,
+    BMK_PERF_UOPS,
+    BMK_PERF_NB_COUNTERS
+} BMK_perfCounter_e;
+
+typedef struct {
+    double count[BMK_PERF_NB_COUNTERS];
+    unsigned validMask;   /* bit n set when count[n] was measured */
+} BMK_perfCounts_t;
+
+/* raw counter values, only meaningful as input of BMK_perf_diff() */
+typedef struct {
+    unsigned long long value[BMK_PERF_NB_COUNTERS];
+    unsigned long long enabled[BMK_PERF_NB_COUNTERS];
+    unsigned long long running[BMK_PERF_NB_COUNTERS];
+} BMK_perfSnapshot_t;
+
+/* BMK_perf_init() :
+ * Opens all counters this system lets us read.
+ * @return : nb of available counters, 0 if none.
+ * When 0, a short reason is written into errorMsg (if not NULL). */
+int BMK_perf_init(const char** errorMsg);
+void BMK_perf_free(void);
+
+/* @return 1 when BMK_perf_init() succeeded in opening at least one counter */
+int BMK_perf_isEnabled(void);
+
+const char* BMK_perf_name(BMK_perfCounter_e counter);
+
+BMK_perfSnapshot_t BMK_perf_read(void);
+
+/* BMK_perf_diff() :
+ * @return : counts elapsed between start and end, divided by `divisor`.
+ * Counts are scaled up when the kernel multiplexed a counter. */
+BMK_perfCounts_t BMK_perf_diff(BMK_perfSnapshot_t start, BMK_perfSnapshot_t end, double divisor);
+
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif   /* PERF_COUNTERS_H_540917 */
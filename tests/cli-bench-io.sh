@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+cat ../xxhash.h ../xxhash.h ../xxhash.h > ./.test.data
+
+# Every strategy reports a speed, or why it couldn't run; -q hides progress lines
+./xxhsum --bench-io -q -i1 ./.test.data 2> ./.test.out
+grep -q "\.test\.data : $(wc -c < ./.test.data | tr -d ' ') bytes" ./.test.out
+for strategy in "fread 4 KB" "fread 64 KB" "fread 1024 KB" "mmap" "O_DIRECT 1024 KB" "fread 1024 KB x 4 threads"; do
+    grep -q "^$strategy  *: \(cold .*warm .*MB/s\|n/a\)" ./.test.out
+done
+
+# -B selects a single block size, -T the number of threads
+./xxhsum --bench-io -q -i1 -B3000 -T3 ./.test.data 2> ./.test.out
+grep -q "^fread 3000 B  *: " ./.test.out
+grep -q "^O_DIRECT 4 KB  *: " ./.test.out
+grep -q "^fread 3000 B x 3 threads  *: " ./.test.out
+! grep -q "fread 64 KB" ./.test.out
+
+# -T1 is kept, not replaced by the default
+./xxhsum --bench-io -q -i1 -B3000 -T1 ./.test.data 2> ./.test.out
+grep -q "^fread 3000 B x 1 thread  *: " ./.test.out
+
+# Empty files are skipped
+: > ./.test.empty
+./xxhsum --bench-io -i1 ./.test.empty 2>&1 | grep -q "Skipping"
+
+# Errors
+! ./xxhsum --bench-io
+! ./xxhsum --bench-io -i1 ./.test.missing
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
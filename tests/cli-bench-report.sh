@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+
+# CSV: host description, then one line per benchmarked variant
+./xxhsum -b1,5 -i1 -B4K --format=csv > ./.test.csv 2> /dev/null
+for key in xxhsum compiler arch host os cpu cycle_counter_ghz iterations; do grep -q "^# $key=." ./.test.csv; done
+grep -q "^id,name,size,hashes_per_s,mb_per_s,median_hashes_per_s,cycles_per_byte,rounds,noise$" ./.test.csv
+grep -q "^1,XXH32,4096,[0-9.]*,[0-9.]*,[0-9.]*,[0-9.]*,[0-9]*,[0-9.]*$" ./.test.csv
+grep -q "^5,XXH3_64b,4096," ./.test.csv
+test "$(grep -c "^[0-9]" ./.test.csv)" -eq 2
+
+# JSON
+./xxhsum -b1,5 -i1 -B4K --format=json > ./.test.json 2> /dev/null
+grep -q '"name": "XXH3_64b", "size": 4096,' ./.test.json
+if command -v python3 > /dev/null; then python3 -m json.tool ./.test.json > /dev/null; fi
+
+# Baselines, compared by median speed: 10x faster fails, 10x slower passes
+awk -F, 'BEGIN { OFS = "," } /^[0-9]/ { $6 = $6 * 10 } { print }' ./.test.csv > ./.test.fast
+awk -F, 'BEGIN { OFS = "," } /^[0-9]/ { $6 = $6 / 10 } { print }' ./.test.csv > ./.test.slow
+! ./xxhsum -b1,5 -i1 -B4K --baseline=./.test.fast 2> ./.test.out
+grep -q "XXH3_64b .* vs baseline .* SLOWER" ./.test.out
+./xxhsum -b1,5 -i1 -B4K --baseline=./.test.slow 2> ./.test.out
+! grep -q "SLOWER" ./.test.out
+# Results absent from the baseline are reported, not compared
+./xxhsum -b3 -i1 -B4K --baseline=./.test.fast 2> ./.test.out
+grep -q "not in baseline" ./.test.out
+# Columns are found by the header: files without median nor cycles are accepted,
+# and compared by their fastest speed
+awk -F, 'BEGIN { OFS = "," } !/^#/ { print $1, $2, $3, ($1 ~ /^[0-9]/ ? $4 / 10 : $4), $5, $8, $9 }' ./.test.csv > ./.test.old
+grep -q "^id,name,size,hashes_per_s,mb_per_s,rounds,noise$" ./.test.old
+./xxhsum -b1,5 -i1 -B4K --baseline=./.test.old 2> ./.test.out
+grep -q "XXH3_64b .* vs baseline" ./.test.out
+
+# Errors
+! ./xxhsum -b -i1 --format=xml
+! ./xxhsum --format=csv ../xxhash.h
+! ./xxhsum -b -i1 --baseline=./.test.missing
+echo "garbage" > ./.test.bad
+! ./xxhsum -b -i1 --baseline=./.test.bad
+grep -v "^id," ./.test.csv > ./.test.bad
+! ./xxhsum -b -i1 --baseline=./.test.bad
+! ./xxhsum --bench-io -i1 --format=csv ../xxhash.h
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
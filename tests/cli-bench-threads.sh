@@ -0,0 +1,33 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+
+# One line per variant and number of threads; -q hides progress lines
+./xxhsum -q -b1,5 -i1 -B1M --threads=1,2,3 2> ./.test.out
+for id in " 1#XXH32" " 5#XXH3_64b"; do
+    grep -q "^$id  *:   1 thread  -> .* GB/s, .* GB/s per thread, 100.0 %" ./.test.out
+    grep -q "^$id  *:   2 threads -> .* GB/s per thread" ./.test.out
+    grep -q "^$id  *:   3 threads -> .* GB/s per thread" ./.test.out
+done
+test "$(grep -c "GB/s per thread" ./.test.out)" -eq 6
+
+# -T runs a single number of threads, 0 is one per core; pinning may be unavailable
+./xxhsum -q -b5 -i1 -B1M -T0 --pin 2> ./.test.out
+test "$(grep -c "GB/s per thread" ./.test.out)" -eq 1
+
+# Errors
+! ./xxhsum -b -i1 --threads=1,2 ../xxhash.h
+! ./xxhsum --threads=1,2 ../xxhash.h
+! ./xxhsum --pin ../xxhash.h
+! ./xxhsum -b -i1 --pin
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Manifest with enough lines to keep several workers busy
+rm -rf ./.test.dir
+mkdir -p ./.test.dir
+for i in $(seq 1 40); do
+    head -c $((i * 997)) Makefile > ./.test.dir/file$i
+done
+./xxhsum ./.test.dir/file* > ./.test.xxh
+./xxhsum -H2 ./.test.dir/file* >> ./.test.xxh
+
+# All OK: same report with and without threads
+./xxhsum -c ./.test.xxh > ./.test.out1
+./xxhsum -c -T4 ./.test.xxh > ./.test.out4
+cmp ./.test.out1 ./.test.out4
+test "$(grep -c ': OK$' ./.test.out4)" -eq 80
+
+# One modified file, one missing file
+echo modified >> ./.test.dir/file7
+rm ./.test.dir/file23
+! ./xxhsum -c ./.test.xxh > ./.test.out1
+! ./xxhsum -c -T4 ./.test.xxh > ./.test.out4
+cmp ./.test.out1 ./.test.out4
+grep -q 'file7: FAILED' ./.test.out4
+grep -q "Could not open or read '.*file23'" ./.test.out4
+
+# --quiet only keeps failures, in manifest order
+! ./xxhsum -c -q -T4 ./.test.xxh > ./.test.out4
+grep -v ': OK$' ./.test.out1 | cmp - ./.test.out4
+
+# --status prints nothing, and still fails
+! ./xxhsum -c --status -T4 ./.test.xxh > ./.test.out4
+test ! -s ./.test.out4
+
+# --ignore-missing
+! ./xxhsum -c --ignore-missing -T4 ./.test.xxh > ./.test.out4
+! grep -q 'file23' ./.test.out4
+./xxhsum ./.test.dir/file* > ./.test.xxh
+rm ./.test.dir/file1
+./xxhsum -c --ignore-missing --status -T4 ./.test.xxh
+
+
+# Cleanup
+rm -rf ./.test.dir
+( rm ./.test.* ) || true
+
+echo OK
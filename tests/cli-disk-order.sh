@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.d
+for n in $(seq 1 40); do
+    head -c $((n * 3000)) Makefile > "./.test.d/f$n"
+done
+./xxhsum -H2 ./.test.d/* | sort -r > ./.test.sums
+echo "0123456789abcdef0123456789abcdef  ./.test.d/missing" >> ./.test.sums
+./xxhsum -H2 ./.test.d/f1 >> ./.test.sums
+echo changed > ./.test.d/f7
+
+# Batches are read by position, but reported in list order
+! ./xxhsum -c ./.test.sums > ./.test.ref
+! ./xxhsum -c --disk-order=16 ./.test.sums > ./.test.out
+diff ./.test.ref ./.test.out
+! ./xxhsum -c --disk-order=3 -T4 ./.test.sums > ./.test.out
+diff ./.test.ref ./.test.out
+! ./xxhsum -c --disk-order ./.test.sums > ./.test.out
+diff ./.test.ref ./.test.out
+
+# or as soon as they are verified: same results, in another order
+! ./xxhsum -c --disk-order=16 --completion-order -T4 ./.test.sums > ./.test.out
+diff <(sort ./.test.ref) <(sort ./.test.out)
+grep -q 'f7: FAILED' ./.test.out
+grep -q 'missing' ./.test.out
+
+# Also for binary indexes, and --status
+./xxhsum -H2 --index=./.test.xsi ./.test.d/f1*
+./xxhsum -c --disk-order=4 --completion-order ./.test.xsi > ./.test.out
+test "$(grep -c ': OK$' ./.test.out)" -eq 11
+./xxhsum -c --status --disk-order=4 ./.test.xsi
+! ./xxhsum -c --status --disk-order=4 ./.test.sums
+
+# Errors
+! ./xxhsum --disk-order ./.test.d/f1
+! ./xxhsum -c --completion-order ./.test.sums
+! ./xxhsum -c --disk-order=0 ./.test.sums
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
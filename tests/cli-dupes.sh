@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Tree with duplicates, and a file differing from them out of the samples
+rm -rf ./.test.dupes
+mkdir -p ./.test.dupes/sub
+seq 1 6000 > ./.test.dupes/a
+cp ./.test.dupes/a ./.test.dupes/b
+cp ./.test.dupes/a ./.test.dupes/sub/c
+cp ./.test.dupes/a ./.test.dupes/differs
+printf '\001' | dd of=./.test.dupes/differs bs=1 seek=20000 conv=notrunc
+ln ./.test.dupes/a ./.test.dupes/hardlink
+echo small > ./.test.dupes/small1
+echo small > ./.test.dupes/small2
+echo other > ./.test.dupes/other
+touch ./.test.dupes/empty1 ./.test.dupes/empty2
+seq 1 400 | head -c 1000 > ./.test.dupes/unique
+
+A_HASH=$(./xxhsum -H2 ./.test.dupes/a | cut -d ' ' -f 1)
+SMALL_HASH=$(./xxhsum -H2 ./.test.dupes/small1 | cut -d ' ' -f 1)
+
+# Groups by decreasing size, separated by an empty line, in path order.
+# Hard links and empty files are ignored.
+./xxhsum --dupes -r ./.test.dupes > ./.test.out 2> ./.test.err
+printf '%s\n' "$A_HASH  ./.test.dupes/a" "$A_HASH  ./.test.dupes/b" "$A_HASH  ./.test.dupes/sub/c" \
+              "" "$SMALL_HASH  ./.test.dupes/small1" "$SMALL_HASH  ./.test.dupes/small2" > ./.test.expected
+cmp ./.test.out ./.test.expected
+
+# Only same-size files are sampled, and only fingerprint collisions read entirely
+grep -q "11 files, 7 sampled, 4 read past the samples, 3 duplicates in 2 groups" ./.test.err
+
+# Same result with threads
+./xxhsum --dupes -r -T4 ./.test.dupes 2> /dev/null | cmp - ./.test.expected
+
+# Output can be verified with -c
+./xxhsum -c ./.test.out
+
+# Explicit files, listed twice
+./xxhsum --dupes ./.test.dupes/a ./.test.dupes/differs ./.test.dupes/a 2> /dev/null > ./.test.out
+test ! -s ./.test.out
+
+# Errors
+! ./xxhsum --dupes ./.test.dupes/a ./.test.dupes/missing 2> /dev/null
+! ./xxhsum --dupes ./.test.dupes 2> /dev/null
+! ./xxhsum --dupes < ./.test.dupes/a
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
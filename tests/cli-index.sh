@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.d/sub
+for n in 1 2 3 4 5 6 7 8; do
+    echo "content $n" > "./.test.d/f$n"
+done
+cp Makefile ./.test.d/sub/
+
+# An index built while hashing, or converted from text lines, is the same
+./xxhsum -H2 -r ./.test.d > ./.test.txt
+./xxhsum -H2 -r --index=./.test.xsi ./.test.d
+./xxhsum --convert=./.test.conv ./.test.txt
+cmp ./.test.xsi ./.test.conv
+head -c 8 ./.test.xsi | grep -q XXHINDEX
+./xxhsum -c ./.test.xsi > ./.test.out
+test "$(grep -c ': OK$' ./.test.out)" -eq 9
+./xxhsum -T4 --index=./.test.dup.xsi ./.test.d/f1 ./.test.d/f2 ./.test.d/f1
+./xxhsum -c ./.test.dup.xsi | grep -c ': OK$' | grep -qx 2
+
+# Text manifests which can't be read twice, larger than a stdio buffer
+for n in $(seq 1 100); do cat ./.test.txt; done > ./.test.big.txt
+./xxhsum -c <(cat ./.test.txt) | grep -c ': OK$' | grep -qx 9
+cat ./.test.big.txt | ./xxhsum -c /dev/stdin | grep -c ': OK$' | grep -qx 900
+
+# --only looks up the requested files, and nothing else
+echo changed > ./.test.d/f3
+./xxhsum -c --only=./.test.d/f1 --only=./.test.d/sub/Makefile ./.test.xsi > ./.test.out
+test "$(wc -l < ./.test.out)" -eq 2
+! ./xxhsum -c --only=./.test.d/f3 ./.test.xsi > ./.test.out
+grep -q 'f3: FAILED' ./.test.out
+! ./xxhsum -c --only=./.test.d/f1 --only=./.test.d/none ./.test.xsi > ./.test.out
+grep -q "'./.test.d/none' is not listed" ./.test.out
+./xxhsum -c --status --only=./.test.d/f2 ./.test.xsi
+! ./xxhsum -c --status --only=./.test.d/none ./.test.xsi
+! ./xxhsum -c ./.test.xsi > ./.test.out
+grep -q 'f3: FAILED' ./.test.out
+
+# Errors
+! ./xxhsum -c --only=./.test.d/f1 ./.test.txt
+! ./xxhsum --only=./.test.d/f1 ./.test.d/f1
+! ./xxhsum -H1,2 --index=./.test.x ./.test.d/f1
+printf 'XXH3_0123  ./.test.d/f1\n' | { ! ./xxhsum --convert=./.test.x; }
+./xxhsum -H1 ./.test.d/f1 >> ./.test.txt
+! ./xxhsum --convert=./.test.x ./.test.txt
+test ! -e ./.test.x
+head -c 40 ./.test.xsi > ./.test.bad
+! ./xxhsum -c ./.test.bad
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
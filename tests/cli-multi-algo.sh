@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Two small files, generated so that results do not depend on the tree
+rm -rf ./.test.files
+mkdir ./.test.files
+seq 1 1000 > ./.test.files/one
+seq 1 3000 > ./.test.files/two
+
+# -H1,2 is the same as -H1 followed by -H2, interleaved per file
+./xxhsum -H1 ./.test.files/one ./.test.files/two > ./.test.h1
+./xxhsum -H2 ./.test.files/one ./.test.files/two > ./.test.h2
+./xxhsum -H1,2 ./.test.files/one ./.test.files/two > ./.test.h12
+test "$(wc -l < ./.test.h12)" -eq 4
+sed -n '1p' ./.test.h1  >  ./.test.expected
+sed -n '1p' ./.test.h2  >> ./.test.expected
+sed -n '2p' ./.test.h1  >> ./.test.expected
+sed -n '2p' ./.test.h2  >> ./.test.expected
+cmp ./.test.expected ./.test.h12
+
+# all algorithms, any notation, duplicates ignored
+./xxhsum -H0,64,128,3,1 --tag ./.test.files/one > ./.test.all
+test "$(wc -l < ./.test.all)" -eq 4
+./xxhsum -c ./.test.all
+./xxhsum -c -T4 ./.test.h12
+
+# stdin is read once for all algorithms, when hashing and when checking
+./xxhsum -H3,0 < ./.test.files/two > ./.test.stdin
+test "$(wc -l < ./.test.stdin)" -eq 2
+./xxhsum -c ./.test.stdin < ./.test.files/two
+
+# a wrong hash is reported on its own line
+awk 'NR == 2 { $0 = (substr($0, 1, 1) == "0" ? "1" : "0") substr($0, 2) } { print }' ./.test.h12 > ./.test.bad
+! ./xxhsum -c ./.test.bad > ./.test.out
+test "$(grep -c ': FAILED$' ./.test.out)" -eq 1
+test "$(grep -c ': OK$' ./.test.out)" -eq 3
+
+# invalid lists
+! ./xxhsum -H1, ./.test.files/one
+! ./xxhsum -H1,5 ./.test.files/one
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Digests of piped input must be identical to reading the file,
+# for sizes around the pipe block size
+rm -f ./.test.*
+for i in $(seq 1 300); do cat Makefile >> ./.test.data; done
+for size in 1 65535 65536 262143 262144 262145 1048576 1048577; do
+    head -c $size ./.test.data > ./.test.in
+    ./xxhsum -H0,1,2,3 ./.test.in | sed 's/  .*//' > ./.test.file
+    cat ./.test.in | ./xxhsum -H0,1,2,3 | sed 's/  .*//' | cmp - ./.test.file
+done
+
+
+# Cleanup
+( rm ./.test.* ) || true
+
+echo OK
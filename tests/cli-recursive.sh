@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Build a small tree, with a special file and a link loop
+rm -rf ./.test.dir
+mkdir -p ./.test.dir/a/b ./.test.dir/c
+cp Makefile ./.test.dir/
+cp Makefile ./.test.dir/a/one
+cp cli-recursive.sh ./.test.dir/a/b/two
+cp cli-comment-line.sh ./.test.dir/c/three
+ln -s .. ./.test.dir/a/b/loop
+mkfifo ./.test.dir/c/fifo || true
+
+# Without -r, a directory is an error
+! ./xxhsum ./.test.dir
+
+# -r lists every regular file once
+./xxhsum -r ./.test.dir > ./.test.xxh
+test "$(wc -l < ./.test.xxh)" -eq 4
+./xxhsum --check ./.test.xxh
+
+# --sort output doesn't depend on the number of threads
+./xxhsum -r --sort ./.test.dir > ./.test.sorted1.xxh
+./xxhsum -r --sort -T4 ./.test.dir > ./.test.sorted4.xxh
+./xxhsum --recursive --sort --threads=0 ./.test.dir > ./.test.sorted0.xxh
+cmp ./.test.sorted1.xxh ./.test.sorted4.xxh
+cmp ./.test.sorted1.xxh ./.test.sorted0.xxh
+sort ./.test.xxh | cmp - <(sort ./.test.sorted4.xxh)
+
+# Explicit files keep their order with multiple threads
+./xxhsum Makefile cli-recursive.sh cli-comment-line.sh > ./.test.list1.xxh
+./xxhsum -T3 Makefile cli-recursive.sh cli-comment-line.sh > ./.test.list3.xxh
+cmp ./.test.list1.xxh ./.test.list3.xxh
+
+
+# Cleanup
+rm -rf ./.test.dir
+( rm ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,56 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Some data, 100 KiB + a partial block
+rm -f ./.test.*
+for i in $(seq 1 30); do cat Makefile >> ./.test.data; done
+head -c $((100 * 1024 + 100)) ./.test.data > ./.test.old
+cp ./.test.old ./.test.new
+printf 'CHANGED' | dd of=./.test.new bs=1 seek=$((10 * 1024 + 5)) conv=notrunc
+printf 'CHANGED' | dd of=./.test.new bs=1 seek=$((11 * 1024 + 5)) conv=notrunc
+printf 'CHANGED' | dd of=./.test.new bs=1 seek=$((50 * 1024)) conv=notrunc
+
+# Signature: header, one digest per block, file size
+./xxhsum --chunk-size=1K -H3 ./.test.old > ./.test.old.sig
+test "$(wc -l < ./.test.old.sig)" -eq $((1 + 101 + 1))
+head -n 1 ./.test.old.sig | grep -q '^#xxhsum-signature XXH3 1024 '
+tail -n 1 ./.test.old.sig | grep -q "^#end $((100 * 1024 + 100))$"
+
+# Same signature with threads, or from stdin
+./xxhsum --chunk-size=1K -H3 -T4 ./.test.old | cmp - ./.test.old.sig
+./xxhsum --chunk-size=1K -H3 < ./.test.old | tail -n +2 | cmp - <(tail -n +2 ./.test.old.sig)
+
+# Changed ranges, with adjacent blocks merged
+./xxhsum --chunk-size=1K -H3 -T3 ./.test.new > ./.test.new.sig
+./xxhsum --compare-signature ./.test.old.sig ./.test.new.sig > ./.test.ranges
+printf '%s\n' "10240 2048" "51200 1024" | cmp - ./.test.ranges
+
+# Identical files: nothing to resync
+./xxhsum --compare-signature ./.test.old.sig ./.test.old.sig > ./.test.ranges
+test ! -s ./.test.ranges
+
+# Appended data: the partial block and the tail differ
+cp ./.test.old ./.test.longer
+head -c 3000 Makefile >> ./.test.longer
+./xxhsum --chunk-size=1K -H2 ./.test.old > ./.test.old128.sig
+./xxhsum --chunk-size=1K -H2 ./.test.longer > ./.test.longer.sig
+./xxhsum --compare-signature ./.test.old128.sig ./.test.longer.sig > ./.test.ranges
+echo "$((100 * 1024)) 3100" | cmp - ./.test.ranges
+
+# Errors: different algorithms, truncated signature, bad usage
+! ./xxhsum --compare-signature ./.test.old.sig ./.test.old128.sig
+head -n 5 ./.test.old.sig > ./.test.truncated.sig
+! ./xxhsum --compare-signature ./.test.old.sig ./.test.truncated.sig
+! ./xxhsum --compare-signature ./.test.old.sig
+! ./xxhsum --chunk-size=0 ./.test.old
+! ./xxhsum --chunk-size=1K -H1,2 ./.test.old
+
+
+# Cleanup
+( rm ./.test.* ) || true
+
+echo OK
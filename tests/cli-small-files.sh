@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.d
+
+# Around the size below which files are read at once
+for size in 0 1 15 16 17 240 241 16383 16384 16385 65536 100000; do
+    head -c $size ../xxhash.h > "./.test.d/f$size"
+done
+
+# Same digests as when streamed from stdin, with every algorithm
+for f in ./.test.d/*; do
+    for H in 0 1 2 3; do
+        test "$(./xxhsum -H$H "$f" | cut -d' ' -f1)" = "$(./xxhsum -H$H < "$f" | cut -d' ' -f1)"
+        test "$(./xxhsum --little-endian -H$H "$f" | cut -d' ' -f1)" = "$(./xxhsum --little-endian -H$H < "$f" | cut -d' ' -f1)"
+    done
+done
+./xxhsum -H0,1,2,3 -T4 -r ./.test.d > ./.test.sums
+./xxhsum -c --strict ./.test.sums
+
+# Directories and missing files
+! ./xxhsum ./.test.d 2> ./.test.err
+grep -q 'Is a directory' ./.test.err
+! ./xxhsum ./.test.d/missing 2> ./.test.err
+grep -q 'Could not open' ./.test.err
+
+# Pipes are still read as streams
+head -c 1000 ../xxhash.h | ./xxhsum -H3 /dev/stdin | cut -d' ' -f1 > ./.test.out
+head -c 1000 ../xxhash.h | ./xxhsum -H3 | cut -d' ' -f1 | diff - ./.test.out
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
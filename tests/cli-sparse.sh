@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Digests of sparse files must be identical to a dense read (through a pipe)
+check_sparse() {
+    ./xxhsum -H0,1,2,3 "$1" | sed 's/  .*//' > ./.test.sparse
+    cat "$1" | ./xxhsum -H0,1,2,3 | sed 's/  .*//' | cmp - ./.test.sparse
+    ./xxhsum -H2 "$1" > ./.test.xxh128
+    ./xxhsum -c ./.test.xxh128
+}
+
+rm -f ./.test.*
+
+# Only holes
+dd if=/dev/null of=./.test.holes bs=1 seek=$((16 * 1024 * 1024))
+check_sparse ./.test.holes
+
+# Data in the middle, at unaligned offsets, and a trailing hole
+dd if=/dev/null of=./.test.middle bs=1 seek=$((32 * 1024 * 1024))
+printf 'hello' | dd of=./.test.middle bs=1 seek=1000001 conv=notrunc
+cat Makefile | dd of=./.test.middle bs=1 seek=$((20 * 1024 * 1024 + 7)) conv=notrunc
+check_sparse ./.test.middle
+
+# Leading hole, data up to the end
+dd if=/dev/null of=./.test.end bs=1 seek=$((8 * 1024 * 1024))
+cat Makefile >> ./.test.end
+check_sparse ./.test.end
+
+
+# Cleanup
+( rm ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.state
+cat Makefile Makefile Makefile > ./.test.log
+head -c 100 Makefile > ./.test.small
+: > ./.test.empty
+
+# First run: same checksums, one state per file
+./xxhsum -H0,1,2,3 --state-dir=./.test.state ./.test.log ./.test.small ./.test.empty > ./.test.out
+./xxhsum -H0,1,2,3 ./.test.log ./.test.small ./.test.empty | diff - ./.test.out
+test "$(ls ./.test.state | wc -l)" -eq 3
+
+# Appended files are resumed, several times
+for n in 1 2 3; do
+    head -c $((n * 70000)) ../xxhash.h >> ./.test.log
+    echo "line $n" >> ./.test.small
+    echo "line $n" >> ./.test.empty
+    ./xxhsum -H0,1,2,3 --state-dir=./.test.state ./.test.log ./.test.small ./.test.empty > ./.test.out
+    ./xxhsum -H0,1,2,3 ./.test.log ./.test.small ./.test.empty | diff - ./.test.out
+done
+
+# Unchanged files
+./xxhsum -H0,1,2,3 --state-dir=./.test.state ./.test.log | diff - <(./xxhsum -H0,1,2,3 ./.test.log)
+
+# Files modified before their end, truncated, or replaced: hashed again
+printf 'X' | dd of=./.test.log bs=1 seek=100 conv=notrunc 2>/dev/null
+echo more >> ./.test.log
+./xxhsum -H3 --state-dir=./.test.state ./.test.log | diff - <(./xxhsum -H3 ./.test.log)
+head -c 50 Makefile > ./.test.small
+./xxhsum -H3 --state-dir=./.test.state ./.test.small | diff - <(./xxhsum -H3 ./.test.small)
+cp ./.test.small ./.test.new && cat Makefile >> ./.test.new && mv ./.test.new ./.test.small
+./xxhsum -H3 --state-dir=./.test.state ./.test.small | diff - <(./xxhsum -H3 ./.test.small)
+
+# Another algorithm: hashed again
+echo tail >> ./.test.log
+./xxhsum -H1 --state-dir=./.test.state ./.test.log | diff - <(./xxhsum -H1 ./.test.log)
+
+# Damaged states are ignored: a corrupted byte in the state, then garbage
+./xxhsum -H0,1,2,3 --state-dir=./.test.state ./.test.log > /dev/null
+for f in ./.test.state/*; do
+    printf '\377' | dd of="$f" bs=1 seek=$(( $(wc -c < "$f") - 300 )) conv=notrunc 2>/dev/null
+done
+echo tail >> ./.test.log
+./xxhsum -H0,1,2,3 --state-dir=./.test.state ./.test.log | diff - <(./xxhsum -H0,1,2,3 ./.test.log)
+
+for f in ./.test.state/*; do echo garbage > "$f"; done
+echo tail >> ./.test.log
+./xxhsum -H2 --state-dir=./.test.state ./.test.log | diff - <(./xxhsum -H2 ./.test.log)
+
+# Errors
+! ./xxhsum --state-dir=./.test.missing ./.test.log
+! ./xxhsum --state-dir=./.test.state --dupes ./.test.log
+! ./xxhsum -c --state-dir=./.test.state ./.test.out
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.d
+: > ./.test.d/empty
+head -c 100 ../xxhash.h > ./.test.d/small
+head -c 20000 ../xxhash.h > ./.test.d/medium
+cat ../xxhash.h ../xxhash.h > ./.test.d/large
+total=$(cat ./.test.d/* | wc -c)
+
+# Checksums are unchanged, statistics go to stderr
+./xxhsum -H0,1,2,3 -r --sort ./.test.d > ./.test.ref
+./xxhsum -H0,1,2,3 -r --sort --stats ./.test.d > ./.test.out 2> ./.test.stats
+diff ./.test.ref ./.test.out
+grep -q "xxhsum: 4 files (0 from cache), " ./.test.stats
+for algo in XXH32 XXH64 XXH128 XXH3; do grep -q "^xxhsum: $algo " ./.test.stats; done
+grep -q "^xxhsum: empty  *1 files" ./.test.stats
+grep -q "^xxhsum: < 1 KB  *1 files" ./.test.stats
+
+# JSON
+./xxhsum -H2 -T2 -r --stats=json ./.test.d > /dev/null 2> ./.test.json
+grep -q "\"files\": 4, \"cached_files\": 0, \"bytes\": $total," ./.test.json
+grep -q '"name": "XXH128", "bytes": '"$total"',' ./.test.json
+grep -q '{"below": 1, "files": 1, "bytes": 0}' ./.test.json
+if command -v python3 > /dev/null; then python3 -m json.tool ./.test.json > /dev/null; fi
+
+# Files are counted by size, not by bytes read: a resumed file only reads its end
+mkdir ./.test.state
+cat ../xxhash.h ../xxhash.h > ./.test.grow
+./xxhsum --state-dir=./.test.state ./.test.grow > /dev/null
+echo tail >> ./.test.grow
+size=$(wc -c < ./.test.grow | tr -d ' ')
+./xxhsum --state-dir=./.test.state --stats=json ./.test.grow > /dev/null 2> ./.test.json
+grep -q '"files": 1, "bytes": '"$size"'}' ./.test.json
+! grep -q "\"bytes\": $size," ./.test.json
+
+# Verification, and stdin
+./xxhsum -c --stats=json ./.test.ref > /dev/null 2> ./.test.json
+grep -q "\"files\": 4, \"cached_files\": 0, \"bytes\": $total," ./.test.json
+./xxhsum --stats=json < ./.test.d/medium > /dev/null 2> ./.test.json
+grep -q '"files": 1, "cached_files": 0, "bytes": 20000,' ./.test.json
+
+# Errors
+! ./xxhsum --stats --dupes ./.test.d/small
+! ./xxhsum --stats --tree-hash ./.test.d
+! ./xxhsum --stats=xml ./.test.d/small
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+# Tree with a long path, a long name, a link, an empty file and a directory
+rm -rf ./.test.*
+LONG_DIR=./.test.tree/some/long/directory/path/that/exceeds/one/hundred/characters/in/total/length/for/sure
+LONG_NAME=$(printf 'n%.0s' $(seq 1 120))
+mkdir -p "$LONG_DIR" ./.test.tree/empty_dir
+for i in $(seq 1 100); do cat Makefile >> ./.test.tree/big; done
+cp Makefile "$LONG_DIR/"
+echo short > "./.test.tree/$LONG_NAME"
+touch ./.test.tree/empty
+ln -s big ./.test.tree/link
+
+# Checksum lines of the files, as hashed on disk
+( cd ./.test.tree && find . -type f | sort | sed 's|^\./||' | xargs ../xxhsum -H0,2 ) > ./.test.expected
+
+for format in gnu posix ustar; do
+    if [ $format = ustar ]; then
+        # ustar can't store long names
+        rm "./.test.tree/$LONG_NAME"
+        ( cd ./.test.tree && find . -type f | sort | sed 's|^\./||' | xargs ../xxhsum -H0,2 ) > ./.test.expected
+    fi
+    ( cd ./.test.tree && tar --format=$format -cf ../.test.tar $(ls -A) )
+
+    # from a file, and from a pipe
+    ./xxhsum --tar -H0,2 ./.test.tar > ./.test.out
+    sort ./.test.out | cmp - <(sort ./.test.expected)
+    cat ./.test.tar | ./xxhsum --tar -H0,2 | cmp - ./.test.out
+
+    # the manifest verifies the extracted tree
+    ( cd ./.test.tree && ../xxhsum -c ../.test.out )
+done
+
+# Truncated or invalid archives
+head -c 1500 ./.test.tar > ./.test.truncated
+! ./xxhsum --tar ./.test.truncated
+! ./xxhsum --tar Makefile
+! ./xxhsum --tar -r ./.test.tar
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
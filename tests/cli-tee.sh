@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+rm -f ./.test.*
+for i in $(seq 1 300); do cat Makefile >> ./.test.data; done
+./xxhsum -H0,1,2,3 - < ./.test.data > ./.test.expected
+
+# Pipe to pipe: forwarded data is intact, checksum lines go to stderr
+cat ./.test.data | ./xxhsum --tee -H0,1,2,3 2> ./.test.digest | cat > ./.test.out
+cmp ./.test.data ./.test.out
+cmp ./.test.expected ./.test.digest
+
+# File to file, checksum lines into a file, which -c can verify with the same stdin
+./xxhsum --tee=./.test.digest -H2 < ./.test.data > ./.test.out
+cmp ./.test.data ./.test.out
+./xxhsum -c ./.test.digest < ./.test.data
+
+# --tag is honored
+head -c 1000 ./.test.data | ./xxhsum --tee --tag -H3 2>&1 > /dev/null | grep -q '^XXH3 (stdin) = '
+
+# Empty input
+./xxhsum --tee -H1 < /dev/null 2> ./.test.digest > ./.test.out
+test ! -s ./.test.out
+grep -q '^ef46db3751d8e999  stdin$' ./.test.digest
+
+# Errors
+! ./xxhsum --tee ./.test.data < ./.test.data > /dev/null
+! ./xxhsum --tee -r < ./.test.data > /dev/null
+! ./xxhsum --tee=./.test.missing/digest < ./.test.data > /dev/null
+
+
+# Cleanup
+( rm ./.test.* ) || true
+
+echo OK
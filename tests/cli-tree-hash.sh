@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+
+root_digest() {
+    ./xxhsum --tree-hash "$@" | cut -d ' ' -f 1
+}
+
+# Two identical replicas
+rm -rf ./.test.*
+mkdir -p ./.test.r1/a/b ./.test.r1/c ./.test.r1/empty
+cp Makefile ./.test.r1/a/b/
+cp cli-tree-hash.sh ./.test.r1/c/
+echo top > ./.test.r1/top
+ln -s top ./.test.r1/link_to_file
+cp -a ./.test.r1 ./.test.r2
+
+# Same root wherever the tree is, whatever the number of threads
+REF=$(root_digest ./.test.r1)
+test "$(root_digest ./.test.r2)" = "$REF"
+test "$(root_digest -T4 ./.test.r2)" = "$REF"
+./xxhsum --tree-hash -T1 --tree-index=./.test.i1 ./.test.r1
+./xxhsum --tree-hash -T4 --tree-index=./.test.i4 ./.test.r1
+cmp ./.test.i1 ./.test.i4
+test "$(wc -l < ./.test.i1)" -eq 5
+
+# A change is located by comparing the indexes
+echo more >> ./.test.r2/c/cli-tree-hash.sh
+./xxhsum --tree-hash --tree-index=./.test.i2 ./.test.r2
+diff ./.test.i1 ./.test.i2 | grep '^>' > ./.test.diff || true
+test "$(wc -l < ./.test.diff)" -eq 2
+grep -q '  \.$' ./.test.diff
+grep -q '  c$' ./.test.diff
+test "$(root_digest ./.test.r2)" != "$REF"
+
+# Names, modes and empty directories are part of the digest
+rm -rf ./.test.r2 && cp -a ./.test.r1 ./.test.r2
+mv ./.test.r2/top ./.test.r2/top2
+test "$(root_digest ./.test.r2)" != "$REF"
+rm -rf ./.test.r2 && cp -a ./.test.r1 ./.test.r2
+chmod 600 ./.test.r2/top
+test "$(root_digest ./.test.r2)" != "$REF"
+rm -rf ./.test.r2 && cp -a ./.test.r1 ./.test.r2
+mkdir ./.test.r2/empty/sub
+test "$(root_digest ./.test.r2)" != "$REF"
+
+# With a cache, unchanged files are not read again
+./xxhsum --tree-hash --cache=file:./.test.cache ./.test.r1 > /dev/null
+test "$(root_digest --cache=file:./.test.cache ./.test.r1)" = "$REF"
+
+# Errors
+! ./xxhsum --tree-hash Makefile
+! ./xxhsum --tree-index=./.test.i1 ./.test.r1
+! ./xxhsum --tree-hash --tree-index=./.test.i1 ./.test.r1 ./.test.r2
+
+
+# Cleanup
+( rm -rf ./.test.* ) || true
+
+echo OK
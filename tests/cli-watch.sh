@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# Exit immediately if any command fails.
+# https://stackoverflow.com/a/2871034
+set -euxo pipefail
+
+# --watch relies on inotify
+if [ "$(uname)" != "Linux" ]; then
+    echo "SKIP: --watch is only supported on Linux"
+    exit 0
+fi
+
+
+rm -rf ./.test.*
+mkdir -p ./.test.d/sub
+echo a > ./.test.d/a
+echo b > ./.test.d/sub/b
+head -c 100000 Makefile > ./.test.d/sub/big
+
+./xxhsum -H2 -T2 --watch --manifest=./.test.d/manifest --debounce=50 ./.test.d 2> ./.test.log &
+WATCHER=$!
+trap 'kill $WATCHER 2>/dev/null || true' EXIT
+
+# Waits until the manifest lists the tree as it is now, the manifest excepted
+converged() {
+    for i in $(seq 1 100); do
+        if ./xxhsum -H2 -r --sort ./.test.d | grep -v '/manifest$' > ./.test.ref \
+           && [ -f ./.test.d/manifest ] && diff -q ./.test.ref ./.test.d/manifest > /dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    diff ./.test.ref ./.test.d/manifest
+    return 1
+}
+
+# First pass
+converged
+./xxhsum -c --status ./.test.d/manifest
+
+# Files changed, created, removed, renamed
+echo aa > ./.test.d/a
+echo c > ./.test.d/c
+rm ./.test.d/sub/b
+mv ./.test.d/sub/big ./.test.d/big
+converged
+
+# Directories created, renamed, removed
+mkdir -p ./.test.d/new/deep
+echo x > ./.test.d/new/deep/x
+mv ./.test.d/sub ./.test.d/sub2
+echo y > ./.test.d/sub2/y
+converged
+rm -rf ./.test.d/new
+converged
+grep -v -q '/new/' ./.test.d/manifest
+
+# The watcher is still running, without errors
+kill -0 $WATCHER
+test ! -s ./.test.log
+
+# Errors
+! ./xxhsum --watch ./.test.d
+! ./xxhsum --watch --manifest=./.test.m ./.test.d ./.test.d/sub2
+! ./xxhsum --watch --manifest=./.test.m --dupes ./.test.d
+! ./xxhsum --manifest=./.test.m ./.test.d/a
+! ./xxhsum --debounce=10 ./.test.d/a
+! ./xxhsum -c --watch --manifest=./.test.m ./.test.d/manifest
+
+
+# Cleanup
+kill $WATCHER
+wait $WATCHER || true
+( rm -rf ./.test.* ) || true
+
+echo OK